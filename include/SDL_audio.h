@@ -65,6 +65,8 @@ extern "C" {
  *     This function usually runs in a separate thread, and so you should
  *     protect data structures that it accesses by calling SDL_LockAudio()
  *     and SDL_UnlockAudio() in your code.
+ *     If it is NULL, the application feeds the device with SDL_QueueAudio()
+ *     instead.
  * - 'desired->userdata' is passed as the first parameter to your callback
  *     function.
  *
@@ -106,6 +108,21 @@ typedef struct SDL_AudioSpec {
 #define AUDIO_U16	AUDIO_U16LSB
 #define AUDIO_S16	AUDIO_S16LSB
 
+/**
+ *  @name 32-bit sample formats
+ *  These are only understood by SDL_MixAudioFormat() and
+ *  SDL_MixAudioMulti(), for mixing at a higher precision than the
+ *  audio device plays.
+ */
+/*@{*/
+#define AUDIO_S32LSB	0x8020	/**< Signed 32-bit samples */
+#define AUDIO_S32MSB	0x9020	/**< As above, but big-endian byte order */
+#define AUDIO_F32LSB	0x8120	/**< 32-bit floating point samples */
+#define AUDIO_F32MSB	0x9120	/**< As above, but big-endian byte order */
+#define AUDIO_S32	AUDIO_S32LSB
+#define AUDIO_F32	AUDIO_F32LSB
+/*@}*/
+
 /**
  *  @name Native audio byte ordering
  */
@@ -113,9 +130,13 @@ typedef struct SDL_AudioSpec {
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define AUDIO_U16SYS	AUDIO_U16LSB
 #define AUDIO_S16SYS	AUDIO_S16LSB
+#define AUDIO_S32SYS	AUDIO_S32LSB
+#define AUDIO_F32SYS	AUDIO_F32LSB
 #else
 #define AUDIO_U16SYS	AUDIO_U16MSB
 #define AUDIO_S16SYS	AUDIO_S16MSB
+#define AUDIO_S32SYS	AUDIO_S32MSB
+#define AUDIO_F32SYS	AUDIO_F32MSB
 #endif
 /*@}*/
 
@@ -173,6 +194,12 @@ extern DECLSPEC char * SDLCALL SDL_AudioDriverName(char *namebuf, int maxlen);
  * may modify the requested size of the audio buffer, you should allocate
  * any local mixing buffers after you open the audio device.
  *
+ * Setting the SDL_AUDIO_LOW_LATENCY environment variable to 1 asks the
+ * audio driver to keep no more audio queued than SDL_AUDIO_PERIODS
+ * buffers of 'samples' sample frames (2 by default), and to write each one
+ * as soon as the device has room for it.  Only the ALSA and PulseAudio
+ * drivers support this so far.
+ *
  * @sa SDL_AudioSpec
  */
 extern DECLSPEC int SDLCALL SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained);
@@ -183,9 +210,48 @@ typedef enum {
 	SDL_AUDIO_PAUSED
 } SDL_audiostatus;
 
+/**
+ * @name Queued Audio
+ * When the audio device was opened with a NULL callback, the application
+ * pushes audio data to it with SDL_QueueAudio() instead of being called
+ * for it.  The data is in the format that was asked for in SDL_OpenAudio()
+ * and plays once the device is unpaused.  SDL_QueueAudio() must not be
+ * called from several threads at once, but doesn't block the audio thread.
+ */
+/*@{*/
+/**
+ * Queue 'len' bytes of audio data to play.
+ * This function returns 0, or -1 if the device wasn't opened for queued
+ * audio or there isn't room for all of the data, in which case none of it
+ * is queued.  The queue holds at least a second of audio, or the number of
+ * bytes in the SDL_AUDIO_QUEUE_SIZE environment variable.
+ */
+extern DECLSPEC int SDLCALL SDL_QueueAudio(const void *data, Uint32 len);
+
+/** Get the number of bytes of queued audio that haven't been played yet */
+extern DECLSPEC Uint32 SDLCALL SDL_GetQueuedAudioSize(void);
+
+/** Drop all the queued audio that hasn't been played yet */
+extern DECLSPEC void SDLCALL SDL_ClearQueuedAudio(void);
+
+/**
+ * Get the number of times playback of queued audio has run dry while the
+ * device was unpaused, and silence had to be played instead.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetAudioUnderruns(void);
+/*@}*/
+
 /** Get the current audio state */
 extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioStatus(void);
 
+/**
+ * Get the time in microseconds between the audio callback filling a buffer
+ * and that buffer reaching the speaker, as last measured by the audio
+ * driver.  This returns -1 if the audio device isn't open or the driver
+ * can't measure it.
+ */
+extern DECLSPEC int SDLCALL SDL_GetAudioLatency(void);
+
 /**
  * This function pauses and unpauses the audio callback processing.
  * It should be called with a parameter of 0 after opening the audio
@@ -246,6 +312,62 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/**
+ * @name Audio Streams
+ * An audio stream converts audio data from one format, number of channels
+ * and rate to another, like SDL_AudioCVT, but a piece at a time.  Data of
+ * any length can be put in, and converted data taken out into a buffer of
+ * any size, with all of the conversion done in a single pass as it is taken
+ * out.  The stream keeps the state needed to carry on smoothly from one
+ * piece to the next, so it suits audio that is generated as it plays.
+ * Rates may be any positive values, and up to 8 channels are supported.
+ */
+/*@{*/
+typedef struct SDL_AudioStream SDL_AudioStream;
+
+/**
+ * Create a stream that converts audio from the source format, number of
+ * channels and rate to the destination ones.
+ * @return The new stream, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+/**
+ * Add 'len' bytes of audio in the source format to the stream.
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream,
+						const void *buf, int len);
+
+/**
+ * Take up to 'len' bytes of converted audio out of the stream.
+ * Only whole sample frames are written, and the resampler needs some
+ * input beyond the position it is converting, so less may be available
+ * than has been put in until SDL_AudioStreamFlush() is called.
+ * @return The number of bytes written to 'buf'.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream,
+						void *buf, int len);
+
+/** Get the number of converted bytes that can be taken out now */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+
+/**
+ * Mark the end of the input, letting all of it be converted.
+ * Putting more data in afterwards starts a new piece of audio, after
+ * a short gap.
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+
+/** Drop all of the data in the stream, and start again */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+/*@}*/
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -257,6 +379,22 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * This works like SDL_MixAudio(), but mixes audio of the given format
+ * instead of the playing audio format, so it can be used without an audio
+ * device open.  It also takes the 32-bit integer and floating point
+ * formats.  Floating point samples are clipped to the range -1.0 to 1.0.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioFormat(Uint8 *dst, const Uint8 *src, Uint16 format, Uint32 len, int volume);
+
+/**
+ * This mixes 'numsrcs' audio buffers into 'dst' in one pass, each with its
+ * own volume, as if SDL_MixAudioFormat() was called for each of them, except
+ * that the sum is only clipped at the end.  This is both faster and more
+ * accurate than mixing the sources one at a time.
+ */
+extern DECLSPEC void SDLCALL SDL_MixAudioMulti(Uint8 *dst, const Uint8 * const *srcs, const int *volumes, int numsrcs, Uint16 format, Uint32 len);
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
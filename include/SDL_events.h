@@ -289,12 +289,32 @@ extern DECLSPEC int SDLCALL SDL_PollEvent(SDL_Event *event);
  */
 extern DECLSPEC int SDLCALL SDL_WaitEvent(SDL_Event *event);
 
+/** Waits until the specified timeout (in milliseconds) for the next available
+ *  event, returning 1, or 0 if the timeout elapsed or there was an error
+ *  while waiting for events.  If 'event' is not NULL, the next event is
+ *  removed from the queue and stored in that area.
+ */
+extern DECLSPEC int SDLCALL SDL_WaitEventTimeout(SDL_Event *event, int timeout);
+
 /** Add an event to the event queue.
  *  This function returns 0 on success, or -1 if the event queue was full
  *  or there was some other error.
  */
 extern DECLSPEC int SDLCALL SDL_PushEvent(SDL_Event *event);
 
+/** Add several events to the event queue at once, in order.
+ *  This function returns the number of events added, which is less than
+ *  'numevents' if the event queue filled up, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_PushEvents(SDL_Event *events, int numevents);
+
+/** Get statistics about the event queue: the number of events currently
+ *  queued, the most that have been queued at once, and the number dropped
+ *  because the queue was full.  Any of the pointers may be NULL.
+ *  The counters are reset when the event loop is restarted.
+ */
+extern DECLSPEC void SDLCALL SDL_GetEventQueueStats(int *queued, int *highwater, Uint32 *dropped);
+
 /** @name Event Filtering */
 /*@{*/
 typedef int (SDLCALL *SDL_EventFilter)(const SDL_Event *event);
@@ -51,6 +51,24 @@ extern DECLSPEC Uint32 SDLCALL SDL_GetTicks(void);
 /** Wait a specified number of milliseconds before returning */
 extern DECLSPEC void SDLCALL SDL_Delay(Uint32 ms);
 
+/**
+ * Get the current value of the high resolution counter, which counts
+ * SDL_GetPerformanceFrequency() units per second.  Only the difference
+ * between two values is meaningful.  On UNIX it is based on a monotonic
+ * clock, so it doesn't jump when the wall clock time is changed.
+ */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceCounter(void);
+
+/** Get the count per second of the high resolution counter */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceFrequency(void);
+
+/**
+ * Wait a specified number of nanoseconds before returning.  The actual
+ * resolution depends on the platform; where only millisecond sleeps
+ * are available, the delay is rounded up to the next millisecond.
+ */
+extern DECLSPEC void SDLCALL SDL_DelayNS(Uint64 ns);
+
 /** Function prototype for the timer callback function */
 typedef Uint32 (SDLCALL *SDL_TimerCallback)(Uint32 interval);
 
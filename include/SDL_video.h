@@ -494,6 +494,10 @@ extern DECLSPEC int SDLCALL SDL_SetPalette(SDL_Surface *surface, int flags,
 
 /**
  * Maps an RGB triple to an opaque pixel value for a given pixel format
+ *
+ * For palettized formats this is the index of the nearest palette colour.
+ * Palette entries written directly in 'format->palette->colors' are taken
+ * into account, but blits only see such changes after SDL_SetColors().
  */
 extern DECLSPEC Uint32 SDLCALL SDL_MapRGB
 (const SDL_PixelFormat * const format,
@@ -586,6 +590,17 @@ extern DECLSPEC void SDLCALL SDL_FreeSurface(SDL_Surface *surface);
 extern DECLSPEC int SDLCALL SDL_LockSurface(SDL_Surface *surface);
 extern DECLSPEC void SDLCALL SDL_UnlockSurface(SDL_Surface *surface);
 
+/**
+ * SDL_LockSurfaceRect() locks a surface like SDL_LockSurface(), but with
+ * the promise that only the pixels inside 'rect' will be written until it
+ * is unlocked.  A NULL 'rect' means the whole surface.
+ *
+ * RLE accelerated surfaces then only encode the changed rows again when
+ * they are unlocked, instead of the whole surface.
+ */
+extern DECLSPEC int SDLCALL SDL_LockSurfaceRect(SDL_Surface *surface,
+						const SDL_Rect *rect);
+
 /**
  * Load a surface from a seekable SDL data source (memory or file.)
  * If 'freesrc' is non-zero, the source will be closed after being read.
@@ -761,6 +776,21 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 			(SDL_Surface *src, SDL_Rect *srcrect,
 			 SDL_Surface *dst, SDL_Rect *dstrect);
 
+/**
+ * Performs SDL_BlitSurface() for each of 'numrects' rectangle pairs,
+ * validating the blit mapping and locking the surfaces only once for
+ * the whole batch.  This is much faster than individual calls when
+ * blitting many small rectangles, e.g. tiles from one atlas surface.
+ *
+ * If 'srcrects' is NULL, the entire source surface is blitted at each
+ * destination position.  As with SDL_BlitSurface(), the clipped
+ * rectangles are saved back in 'dstrects'.
+ * Returns 0 on success, or -1 (-2 if video memory was lost) on error.
+ */
+extern DECLSPEC int SDLCALL SDL_BlitSurfaceBatch
+			(SDL_Surface *src, const SDL_Rect *srcrects,
+			 SDL_Surface *dst, SDL_Rect *dstrects, int numrects);
+
 /**
  * This function performs a fast fill of the given rectangle with 'color'
  * The given rectangle is clipped to the destination surface clip area
@@ -817,6 +847,19 @@ extern DECLSPEC SDL_Overlay * SDLCALL SDL_CreateYUVOverlay(int width, int height
 extern DECLSPEC int SDLCALL SDL_LockYUVOverlay(SDL_Overlay *overlay);
 extern DECLSPEC void SDLCALL SDL_UnlockYUVOverlay(SDL_Overlay *overlay);
 
+/** Make a software overlay read its planes from memory owned by the
+ *  caller, such as a decoder's frame pool, instead of its own pixels.
+ *  pixels and pitches hold one entry per overlay plane, and each pitch
+ *  must be at least as long as the plane's rows.  The memory must stay
+ *  valid until the planes are replaced or the overlay is freed.  Pass
+ *  NULL pixels to switch back to the overlay's own planes.
+ *
+ *  @return 0 on success, or -1 if the planes are invalid or the overlay
+ *  is hardware accelerated.
+ */
+extern DECLSPEC int SDLCALL SDL_SetYUVOverlayPlanes(SDL_Overlay *overlay,
+				Uint8 **pixels, const Uint16 *pitches);
+
 /** Blit a video overlay to the display surface.
  *  The contents of the video surface underneath the blit destination are
  *  not defined.  
@@ -948,6 +991,29 @@ extern DECLSPEC SDL_GrabMode SDLCALL SDL_WM_GrabInput(SDL_GrabMode mode);
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                                     SDL_Surface *dst, SDL_Rect *dstrect);
 
+/** Filters for SDL_SoftStretchFiltered() */
+typedef enum {
+	SDL_STRETCH_NEAREST,	/**< nearest neighbour, no filtering */
+	SDL_STRETCH_BILINEAR,	/**< bilinear interpolation, for enlarging */
+	SDL_STRETCH_AREA	/**< area averaging, for shrinking */
+} SDL_StretchFilter;
+
+/**
+ * Performs a filtered scaling blit from 'srcrect' of 'src' to 'dstrect'
+ * of 'dst'.  If either rectangle is NULL, the whole surface is used.
+ * The rectangles are not clipped and must lie within their surfaces.
+ *
+ * Unlike SDL_SoftStretch(), the surfaces may have different formats, as
+ * long as both are 16, 24 or 32 bits per pixel.  Colorkey and surface
+ * alpha are ignored; the source alpha channel, if any, is scaled along
+ * with the color channels.
+ *
+ * Returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                                    SDL_Surface *dst, SDL_Rect *dstrect,
+                                    SDL_StretchFilter filter);
+
 #define SDL_REFRESH_DEFAULT 0
 
 /*
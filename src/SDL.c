@@ -42,6 +42,14 @@ extern void SDL_JoystickQuit(void);
 extern int  SDL_CDROMInit(void);
 extern void SDL_CDROMQuit(void);
 #endif
+#if !SDL_VIDEO_DISABLED
+extern int  SDL_BlitThreadsInit(void);
+extern void SDL_BlitThreadsQuit(void);
+extern void SDL_StretchInit(void);
+extern void SDL_StretchQuit(void);
+extern void SDL_InitInverseMaps(void);
+extern void SDL_FreeInverseMaps(void);
+#endif
 #if !SDL_TIMERS_DISABLED
 extern void SDL_StartTicks(void);
 extern int  SDL_TimerInit(void);
@@ -57,6 +65,9 @@ static Uint32 SDL_initialized = 0;
 #if !SDL_TIMERS_DISABLED
 static Uint32 ticks_started = 0;
 #endif
+#if !SDL_VIDEO_DISABLED
+static Uint32 blitters_started = 0;
+#endif
 
 #ifdef CHECK_LEAKS
 int surfaces_allocated = 0;
@@ -84,6 +95,15 @@ int SDL_InitSubSystem(Uint32 flags)
 #endif
 
 #if !SDL_VIDEO_DISABLED
+	/* Start the software blitter threads and create the locks of the
+	   stretch code and colour map caches before any blit can race us */
+	if ( ! blitters_started ) {
+		SDL_BlitThreadsInit();
+		SDL_StretchInit();
+		SDL_InitInverseMaps();
+		blitters_started = 1;
+	}
+
 	/* Initialize the video/event subsystem */
 	if ( (flags & SDL_INIT_VIDEO) && !(SDL_initialized & SDL_INIT_VIDEO) ) {
 		if ( SDL_VideoInit(SDL_getenv("SDL_VIDEODRIVER"),
@@ -221,6 +241,15 @@ void SDL_Quit(void)
 #endif
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 
+#if !SDL_VIDEO_DISABLED
+	/* Stop the software blitter threads and drop cached stretch code
+	   and colour maps */
+	SDL_BlitThreadsQuit();
+	SDL_StretchQuit();
+	SDL_FreeInverseMaps();
+	blitters_started = 0;
+#endif
+
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : CHECK_LEAKS\n"); fflush(stdout);
@@ -121,14 +121,105 @@ SDL_AudioDevice *current_audio = NULL;
 int SDL_AudioInit(const char *driver_name);
 void SDL_AudioQuit(void);
 
+/* Atomic operations for the SDL_QueueAudio() ring buffer, which has one
+   producer (the application) and one consumer (the audio thread).
+   Without them the two sides are serialized by the mixer lock.
+ */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define SDL_AUDIOQ_LOCKFREE
+#define SDL_AudioQ_CAS(p, o, n)		__sync_bool_compare_and_swap(p, o, n)
+#define SDL_AudioQ_Barrier()		__sync_synchronize()
+#else
+#define SDL_AudioQ_CAS(p, o, n)		((*(p) == (o)) ? (*(p) = (n), 1) : 0)
+#define SDL_AudioQ_Barrier()
+#endif
+
+/* The largest ring buffer SDL_AUDIO_QUEUE_SIZE can ask for, in bytes */
+#define SDL_AUDIO_QUEUE_MAX	(64 * 1024 * 1024)
+
+/* The audio callback used when the application queues its audio */
+static void SDLCALL SDL_DrainAudioQueue(void *userdata, Uint8 *stream, int len)
+{
+	SDL_AudioDevice *audio = (SDL_AudioDevice *)userdata;
+	Uint32 head, tail, avail, pos, chunk;
+
+	head = audio->queue_head;
+	tail = audio->queue_tail;
+	SDL_AudioQ_Barrier();
+	avail = head - tail;
+	if ( avail > (Uint32)len ) {
+		avail = (Uint32)len;
+	}
+	pos = tail & (audio->queue_size - 1);
+	chunk = audio->queue_size - pos;
+	if ( chunk > avail ) {
+		chunk = avail;
+	}
+	SDL_memcpy(stream, audio->queue + pos, chunk);
+	SDL_memcpy(stream + chunk, audio->queue, avail - chunk);
+	SDL_AudioQ_Barrier();
+
+	/* SDL_ClearQueuedAudio() may have moved the tail under us */
+	if ( ! SDL_AudioQ_CAS(&audio->queue_tail, tail, tail + avail) ) {
+		avail = 0;
+	}
+	if ( avail < (Uint32)len ) {
+		SDL_memset(stream + avail, audio->spec.silence, len - avail);
+		/* Count the times playback runs dry, not every silent buffer */
+		if ( ! audio->queue_starving ) {
+			audio->queue_starving = 1;
+			++audio->queue_underruns;
+		}
+	} else {
+		audio->queue_starving = 0;
+	}
+}
+
+/* Get a buffer's worth of audio from the application */
+static void SDL_FillAudio(SDL_AudioDevice *audio, Uint8 *stream, int len, int silence)
+{
+	SDL_memset(stream, silence, len);
+
+	if ( ! audio->paused ) {
+#ifdef SDL_AUDIOQ_LOCKFREE
+		if ( audio->queue ) {
+			/* Queued audio doesn't need the mixer lock */
+			audio->spec.callback(audio->spec.userdata, stream, len);
+			return;
+		}
+#endif
+		SDL_mutexP(audio->mixer_lock);
+		audio->spec.callback(audio->spec.userdata, stream, len);
+		SDL_mutexV(audio->mixer_lock);
+	}
+}
+
+/* Fill a device buffer through the audio stream, asking the application
+   for as many buffers as that takes
+ */
+static void SDL_FillConvertedAudio(SDL_AudioDevice *audio, Uint8 *stream, int len, int silence)
+{
+	int done;
+
+	while ( SDL_AudioStreamAvailable(audio->stream) < audio->spec.size ) {
+		SDL_FillAudio(audio, audio->stream_buf, len, silence);
+		if ( SDL_AudioStreamPut(audio->stream, audio->stream_buf, len) < 0 ) {
+			break;
+		}
+	}
+	done = SDL_AudioStreamGet(audio->stream, stream, audio->spec.size);
+	if ( done < (int)audio->spec.size ) {
+		SDL_memset(stream + done, audio->spec.silence,
+		           audio->spec.size - done);
+	}
+}
+
 /* The general mixing thread function */
 int SDLCALL SDL_RunAudio(void *audiop)
 {
 	SDL_AudioDevice *audio = (SDL_AudioDevice *)audiop;
 	Uint8 *stream;
 	int    stream_len;
-	void  *udata;
-	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
 	int    silence;
 
 	/* Perform any thread setup */
@@ -137,11 +228,11 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	}
 	audio->threadid = SDL_ThreadID();
 
-	/* Set up the mixing function */
-	fill  = audio->spec.callback;
-	udata = audio->spec.userdata;
-
-	if ( audio->convert.needed ) {
+	/* Set up the mixing buffer */
+	if ( audio->stream ) {
+		silence = audio->stream_silence;
+		stream_len = audio->stream_len;
+	} else if ( audio->convert.needed ) {
 		if ( audio->convert.src_format == AUDIO_U8 ) {
 			silence = 0x80;
 		} else {
@@ -157,29 +248,19 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	while ( audio->enabled ) {
 
 		/* Fill the current buffer with sound */
-		if ( audio->convert.needed ) {
-			if ( audio->convert.buf ) {
-				stream = audio->convert.buf;
-			} else {
-				continue;
-			}
-		} else {
+		if ( audio->stream ) {
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
 				stream = audio->fake_stream;
 			}
-		}
-
-		SDL_memset(stream, silence, stream_len);
-
-		if ( ! audio->paused ) {
-			SDL_mutexP(audio->mixer_lock);
-			(*fill)(udata, stream, stream_len);
-			SDL_mutexV(audio->mixer_lock);
-		}
+			SDL_FillConvertedAudio(audio, stream, stream_len, silence);
+		} else if ( audio->convert.needed ) {
+			if ( audio->convert.buf == NULL ) {
+				continue;
+			}
+			SDL_FillAudio(audio, audio->convert.buf, stream_len, silence);
 
-		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
+			/* Convert the audio */
 			SDL_ConvertAudio(&audio->convert);
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
@@ -187,6 +268,12 @@ int SDLCALL SDL_RunAudio(void *audiop)
 			}
 			SDL_memcpy(stream, audio->convert.buf,
 			               audio->convert.len_cvt);
+		} else {
+			stream = audio->GetAudioBuf(audio);
+			if ( stream == NULL ) {
+				stream = audio->fake_stream;
+			}
+			SDL_FillAudio(audio, stream, stream_len, silence);
 		}
 
 		/* Ready current buffer for play and change current buffer */
@@ -280,6 +367,7 @@ int SDL_AudioInit(const char *driver_name)
 	if ( current_audio != NULL ) {
 		SDL_AudioQuit();
 	}
+	SDL_InitRateCache();
 
 	/* Select the proper audio driver */
 	audio = NULL;
@@ -451,10 +539,6 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		}
 		desired->samples = power2;
 	}
-	if ( desired->callback == NULL ) {
-		SDL_SetError("SDL_OpenAudio() passed a NULL callback");
-		return(-1);
-	}
 
 #if SDL_THREADS_DISABLED
 	/* Uses interrupt driven audio, without thread */
@@ -473,6 +557,11 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
+	if ( desired->callback == NULL ) {
+		/* The application will use SDL_QueueAudio() */
+		audio->spec.callback = SDL_DrainAudioQueue;
+		audio->spec.userdata = audio;
+	}
 	audio->convert.needed = 0;
 	audio->enabled = 1;
 	audio->paused  = 1;
@@ -501,6 +590,32 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 	/* See if we need to do any conversion */
 	if ( obtained != NULL ) {
 		SDL_memcpy(obtained, &audio->spec, sizeof(audio->spec));
+		/* Don't hand out the queue's own callback */
+		obtained->callback = desired->callback;
+		obtained->userdata = desired->userdata;
+	} else if ( (audio->opened == 1) &&
+		    (desired->freq != audio->spec.freq ||
+		     desired->format != audio->spec.format ||
+		     desired->channels != audio->spec.channels) ) {
+		/* Our audio thread converts the application's buffers as it
+		   writes them to the device, with an audio stream */
+		audio->stream = SDL_NewAudioStream(
+			desired->format, desired->channels, desired->freq,
+			audio->spec.format, audio->spec.channels,
+			audio->spec.freq);
+		if ( audio->stream == NULL ) {
+			SDL_CloseAudio();
+			return(-1);
+		}
+		audio->stream_len = desired->size;
+		audio->stream_format = desired->format;
+		audio->stream_silence = desired->silence;
+		audio->stream_buf = (Uint8 *)SDL_AllocAudioMem(desired->size);
+		if ( audio->stream_buf == NULL ) {
+			SDL_CloseAudio();
+			SDL_OutOfMemory();
+			return(-1);
+		}
 	} else if ( desired->freq != audio->spec.freq ||
 		    desired->format != audio->spec.format ||
 		    desired->channels != audio->spec.channels ) {
@@ -526,6 +641,41 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		}
 	}
 
+	/* Allocate the ring buffer for queued audio, in the format the
+	   application gives us: at least a second of it, or four buffers.
+	 */
+	if ( desired->callback == NULL ) {
+		Uint32 size, want;
+
+		want = (Uint32)desired->freq * desired->channels *
+		       ((desired->format & 0xFF) / 8);
+		env = SDL_getenv("SDL_AUDIO_QUEUE_SIZE");
+		if ( env && (SDL_atoi(env) > 0) ) {
+			want = (Uint32)SDL_atoi(env);
+		}
+		if ( want > SDL_AUDIO_QUEUE_MAX ) {
+			want = SDL_AUDIO_QUEUE_MAX;
+		}
+		if ( want < 4 * desired->size ) {
+			want = 4 * desired->size;
+		}
+		size = 1;
+		while ( size < want ) {
+			size *= 2;
+		}
+		audio->queue = (Uint8 *)SDL_malloc(size);
+		if ( audio->queue == NULL ) {
+			SDL_CloseAudio();
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		audio->queue_size = size;
+		audio->queue_head = 0;
+		audio->queue_tail = 0;
+		audio->queue_underruns = 0;
+		audio->queue_starving = 1;
+	}
+
 	/* Start the audio thread if necessary */
 	switch (audio->opened) {
 		case  1:
@@ -576,6 +726,95 @@ void SDL_PauseAudio (int pause_on)
 	}
 }
 
+int SDL_QueueAudio (const void *data, Uint32 len)
+{
+	SDL_AudioDevice *audio = current_audio;
+	Uint32 head, pos, chunk;
+
+	if ( !audio || !audio->queue ) {
+		SDL_SetError("Audio device wasn't opened for queued audio");
+		return(-1);
+	}
+#ifndef SDL_AUDIOQ_LOCKFREE
+	SDL_LockAudio();
+#endif
+	head = audio->queue_head;
+	if ( len > audio->queue_size - (head - audio->queue_tail) ) {
+#ifndef SDL_AUDIOQ_LOCKFREE
+		SDL_UnlockAudio();
+#endif
+		SDL_SetError("Audio queue is full");
+		return(-1);
+	}
+	pos = head & (audio->queue_size - 1);
+	chunk = audio->queue_size - pos;
+	if ( chunk > len ) {
+		chunk = len;
+	}
+	SDL_memcpy(audio->queue + pos, data, chunk);
+	SDL_memcpy(audio->queue, (const Uint8 *)data + chunk, len - chunk);
+	SDL_AudioQ_Barrier();
+	audio->queue_head = head + len;
+#ifndef SDL_AUDIOQ_LOCKFREE
+	SDL_UnlockAudio();
+#endif
+	return(0);
+}
+
+Uint32 SDL_GetQueuedAudioSize (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+
+	if ( !audio || !audio->queue ) {
+		return(0);
+	}
+	return(audio->queue_head - audio->queue_tail);
+}
+
+void SDL_ClearQueuedAudio (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+	Uint32 tail;
+
+	if ( !audio || !audio->queue ) {
+		return;
+	}
+#ifndef SDL_AUDIOQ_LOCKFREE
+	SDL_LockAudio();
+#endif
+	do {
+		tail = audio->queue_tail;
+	} while ( ! SDL_AudioQ_CAS(&audio->queue_tail, tail, audio->queue_head) );
+#ifndef SDL_AUDIOQ_LOCKFREE
+	SDL_UnlockAudio();
+#endif
+}
+
+Uint32 SDL_GetAudioUnderruns (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+
+	if ( !audio || !audio->queue ) {
+		return(0);
+	}
+	return(audio->queue_underruns);
+}
+
+int SDL_GetAudioLatency (void)
+{
+	SDL_AudioDevice *audio = current_audio;
+
+	if ( !audio || !audio->enabled ) {
+		SDL_SetError("Audio device is not open");
+		return(-1);
+	}
+	if ( !audio->latency ) {
+		SDL_SetError("Audio driver doesn't report its latency");
+		return(-1);
+	}
+	return((int)audio->latency);
+}
+
 void SDL_LockAudio (void)
 {
 	SDL_AudioDevice *audio = current_audio;
@@ -620,6 +859,18 @@ void SDL_AudioQuit(void)
 			SDL_FreeAudioMem(audio->convert.buf);
 
 		}
+		if ( audio->stream != NULL ) {
+			SDL_FreeAudioStream(audio->stream);
+			audio->stream = NULL;
+		}
+		if ( audio->stream_buf != NULL ) {
+			SDL_FreeAudioMem(audio->stream_buf);
+			audio->stream_buf = NULL;
+		}
+		if ( audio->queue != NULL ) {
+			SDL_free(audio->queue);
+			audio->queue = NULL;
+		}
 		if ( audio->opened ) {
 			audio->CloseAudio(audio);
 			audio->opened = 0;
@@ -628,6 +879,7 @@ void SDL_AudioQuit(void)
 		audio->free(audio);
 		current_audio = NULL;
 	}
+	SDL_FreeRateCache();
 }
 
 #define NUM_FORMATS	6
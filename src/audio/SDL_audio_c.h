@@ -33,3 +33,20 @@ extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
+/* Set up and free the streams SDL_ConvertAudio() keeps for resampling */
+extern void SDL_InitRateCache(void);
+extern void SDL_FreeRateCache(void);
+
+
+/* The x86 SIMD audio routines are written with intrinsics and compiled per
+   function for their instruction set, like the SIMD blitters, and chosen
+   at runtime.  NEON is only used when the whole library targets it. */
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && \
+    (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || (__GNUC__ >= 5))
+#define SDL_X86_SIMD_AUDIO	1
+#define SDL_AUDIO_TARGET_SSE2	__attribute__((target("sse2")))
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SDL_NEON_AUDIO	1
+#endif
@@ -24,6 +24,9 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mutex.h"
+#include "SDL_audio_c.h"
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -856,450 +859,808 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
-/* Convert rate up by multiple of 2 */
-void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
+/*
+ * Streaming conversion.
+ *
+ * An audio stream converts format, channels and rate in a single pass
+ * over each frame.  Input is decoded as it's put in, mixed to the
+ * destination channels, and kept as 16 bit samples in a planar history
+ * buffer.  Output is resampled from the history and encoded straight
+ * into the caller's buffer.
+ *
+ * Each output frame is a windowed-sinc filter over the input around its
+ * position, picked from a table of filter phases.  The filter has 32 taps,
+ * and is stretched over as many more as it takes to keep the same
+ * quality when the rate is divided, up to 8 times as many.  The step
+ * between output frames is kept as the exact fraction src_rate/dst_rate,
+ * so there is no drift however long the stream runs.  When the reduced
+ * fraction has no more than RESAMPLE_PHASES steps, every position gets
+ * its own phase, otherwise the nearest phase is used.  The taps are in
+ * 1.15 fixed point, summing to unity gain.  Without a rate change, the
+ * history is copied out as it is.
+ */
+
+#define RESAMPLE_TAPS	32
+#define RESAMPLE_MAXTAPS	(8*RESAMPLE_TAPS)
+#define RESAMPLE_PHASES	256
+#define RESAMPLE_PI	3.14159265358979323846
+
+#define STREAM_MAXCHANNELS	8
+
+struct SDL_AudioStream {
+	Uint16 src_format;
+	Uint16 dst_format;
+	int src_channels;
+	int dst_channels;
+	int src_framesize;
+	int dst_framesize;
+	Sint16 mix[STREAM_MAXCHANNELS][STREAM_MAXCHANNELS];	/* 2.14 */
+	int remix;		/* channels aren't just copied */
+	Uint8 partial[STREAM_MAXCHANNELS*2];	/* incomplete input frame */
+	int partial_len;
+	Uint32 step;		/* whole input frames per output frame */
+	Uint32 step_frac;	/* and the remainder, in 1/den frames */
+	Uint32 den;
+	Uint32 frac;
+	int phases;
+	int ntaps;		/* a multiple of RESAMPLE_TAPS, or 1 */
+	Sint16 *taps;		/* phases * ntaps, NULL without a rate change */
+	Sint16 *history;	/* dst_channels * size, planar */
+	int size;
+	int avail;		/* frames in the history */
+	int pos;		/* first frame of the next output's window */
+	int (*dot)(const Sint16 *x, const Sint16 *h, int n);
+};
+
+/* sin() without needing the math library */
+static double SDL_ResampleSin(double x)
 {
+	double x2, term, sum;
 	int i;
-	Uint8 *src, *dst;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
-#endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt; i; --i ) {
-				src -= 1;
-				dst -= 2;
-				dst[0] = src[0];
-				dst[1] = src[0];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				src -= 2;
-				dst -= 4;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[1];
-			}
-			break;
+	while ( x > RESAMPLE_PI ) {
+		x -= 2*RESAMPLE_PI;
 	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	while ( x < -RESAMPLE_PI ) {
+		x += 2*RESAMPLE_PI;
+	}
+	x2 = x*x;
+	term = sum = x;
+	for ( i = 2; i < 24; i += 2 ) {
+		term *= -x2/(i*(i+1));
+		sum += term;
 	}
+	return sum;
 }
 
+static double SDL_ResampleCos(double x)
+{
+	return SDL_ResampleSin(x + RESAMPLE_PI/2);
+}
 
-/* Convert rate up by multiple of 2, for stereo */
-void SDLCALL SDL_RateMUL2_c2(SDL_AudioCVT *cvt, Uint16 format)
+/* Fill in the taps for 'phases' evenly spaced positions between two input
+   frames, low-pass filtering at 'cutoff' of the input Nyquist frequency.
+ */
+static void SDL_ResampleTaps(Sint16 *taps, int phases, int ntaps, double cutoff)
 {
-	int i;
-	Uint8 *src, *dst;
+	double h[RESAMPLE_MAXTAPS];
+	int p, i, sum, peak;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
-#endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				src -= 2;
-				dst -= 4;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[1];
+	for ( p = 0; p < phases; ++p ) {
+		double total = 0.0;
+
+		for ( i = 0; i < ntaps; ++i ) {
+			double x = (i - (ntaps/2 - 1)) - (double)p/phases;
+			double t = (x + ntaps/2) / ntaps;
+			double w = 0.42 - 0.5*SDL_ResampleCos(2*RESAMPLE_PI*t)
+			                + 0.08*SDL_ResampleCos(4*RESAMPLE_PI*t);
+
+			if ( x == 0.0 ) {
+				h[i] = w;
+			} else {
+				x *= RESAMPLE_PI * cutoff;
+				h[i] = w * SDL_ResampleSin(x) / x;
 			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				src -= 4;
-				dst -= 8;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[0];
-				dst[5] = src[1];
-				dst[6] = src[2];
-				dst[7] = src[3];
+			total += h[i];
+		}
+		/* Normalize, putting the rounding error on the largest tap */
+		sum = 0;
+		peak = 0;
+		for ( i = 0; i < ntaps; ++i ) {
+			double v = h[i] * 32768.0 / total;
+
+			taps[i] = (Sint16)(v < 0.0 ? v - 0.5 : v + 0.5);
+			sum += taps[i];
+			if ( taps[i] > taps[peak] ) {
+				peak = i;
 			}
-			break;
+		}
+		taps[peak] += (Sint16)(32768 - sum);
+		taps += ntaps;
 	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+}
+
+static int SDL_ResampleDot(const Sint16 *x, const Sint16 *h, int n)
+{
+	int i, acc = 0;
+
+	for ( i = 0; i < n; ++i ) {
+		acc += x[i] * h[i];
 	}
+	return acc;
 }
 
-/* Convert rate up by multiple of 2, for quad */
-void SDLCALL SDL_RateMUL2_c4(SDL_AudioCVT *cvt, Uint16 format)
+#if SDL_X86_SIMD_AUDIO
+#include <emmintrin.h>
+
+SDL_AUDIO_TARGET_SSE2
+static int SDL_ResampleDotSSE2(const Sint16 *x, const Sint16 *h, int n)
 {
+	const __m128i *xv = (const __m128i *)x;
+	const __m128i *hv = (const __m128i *)h;
+	__m128i acc;
 	int i;
-	Uint8 *src, *dst;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
-#endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				src -= 4;
-				dst -= 8;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[0];
-				dst[5] = src[1];
-				dst[6] = src[2];
-				dst[7] = src[3];
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				src -= 8;
-				dst -= 16;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[0];
-				dst[9] = src[1];
-				dst[10] = src[2];
-				dst[11] = src[3];
-				dst[12] = src[4];
-				dst[13] = src[5];
-				dst[14] = src[6];
-				dst[15] = src[7];
-			}
-			break;
-	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	acc = _mm_madd_epi16(_mm_loadu_si128(xv), _mm_loadu_si128(hv));
+	for ( i = 1; i < n/8; ++i ) {
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128(xv+i),
+		                                        _mm_loadu_si128(hv+i)));
 	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1,0,3,2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2,3,0,1)));
+	return _mm_cvtsi128_si32(acc);
 }
+#endif /* SDL_X86_SIMD_AUDIO */
 
+#if SDL_NEON_AUDIO
+#include <arm_neon.h>
 
-/* Convert rate up by multiple of 2, for 5.1 */
-void SDLCALL SDL_RateMUL2_c6(SDL_AudioCVT *cvt, Uint16 format)
+static int SDL_ResampleDotNEON(const Sint16 *x, const Sint16 *h, int n)
 {
+	int32x4_t acc;
+	int32x2_t sum;
 	int i;
-	Uint8 *src, *dst;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * 2\n");
-#endif
-	src = cvt->buf+cvt->len_cvt;
-	dst = cvt->buf+cvt->len_cvt*2;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/6; i; --i ) {
-				src -= 6;
-				dst -= 12;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[0];
-				dst[7] = src[1];
-				dst[8] = src[2];
-				dst[9] = src[3];
-				dst[10] = src[4];
-				dst[11] = src[5];
+	acc = vmull_s16(vld1_s16(x), vld1_s16(h));
+	for ( i = 4; i < n; i += 4 ) {
+		acc = vmlal_s16(acc, vld1_s16(x+i), vld1_s16(h+i));
+	}
+	sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	return vget_lane_s32(vpadd_s32(sum, sum), 0);
+}
+#endif /* SDL_NEON_AUDIO */
+
+/* Work out how each destination channel is made from the source channels,
+   following the same steps as the SDL_BuildAudioCVT() channel filters.
+ */
+static int SDL_StreamChannels(SDL_AudioStream *stream, int src, int dst)
+{
+	double m[STREAM_MAXCHANNELS][STREAM_MAXCHANNELS];
+	double t[STREAM_MAXCHANNELS][STREAM_MAXCHANNELS];
+	int n = src;
+	int i, j;
+
+	SDL_memset(m, 0, sizeof(m));
+	SDL_memset(t, 0, sizeof(t));
+	for ( i = 0; i < src; ++i ) {
+		m[i][i] = 1.0;
+	}
+#define SDL_StreamMix(c, a, wa, b, wb) \
+	for ( j = 0; j < src; ++j ) t[c][j] = wa*m[a][j] + wb*m[b][j]
+	if ( src != dst ) {
+		if ( (n == 1) && (dst > 1) ) {
+			SDL_StreamMix(0, 0, 1.0, 0, 0.0);
+			SDL_StreamMix(1, 0, 1.0, 0, 0.0);
+			SDL_memcpy(m, t, sizeof(m));
+			n = 2;
+		}
+		if ( (n == 2) && (dst == 6 || dst == 4) ) {
+			/* Front, rear as the difference, and center */
+			SDL_StreamMix(2, 0, 0.5, 1, -0.5);
+			SDL_StreamMix(3, 1, 0.5, 0, -0.5);
+			SDL_StreamMix(4, 0, 0.5, 1, 0.5);
+			SDL_StreamMix(5, 0, 0.5, 1, 0.5);
+			SDL_memcpy(m[2], t[2], 4*sizeof(m[0]));
+			n = dst;
+		}
+		while ( (n*2) <= dst ) {
+			for ( i = 0; i < n; ++i ) {
+				SDL_StreamMix(2*i, i, 1.0, i, 0.0);
+				SDL_StreamMix(2*i+1, i, 1.0, i, 0.0);
 			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/12; i; --i ) {
-				src -= 12;
-				dst -= 24;
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[8];
-				dst[9] = src[9];
-				dst[10] = src[10];
-				dst[11] = src[11];
-				dst[12] = src[0];
-				dst[13] = src[1];
-				dst[14] = src[2];
-				dst[15] = src[3];
-				dst[16] = src[4];
-				dst[17] = src[5];
-				dst[18] = src[6];
-				dst[19] = src[7];
-				dst[20] = src[8];
-				dst[21] = src[9];
-				dst[22] = src[10];
-				dst[23] = src[11];
+			n *= 2;
+			SDL_memcpy(m, t, n*sizeof(m[0]));
+		}
+		if ( (n == 6) && (dst <= 2) ) {
+			n = 2;
+		}
+		if ( (n == 6) && (dst == 4) ) {
+			n = 4;
+		}
+		while ( ((n%2) == 0) && ((n/2) >= dst) ) {
+			for ( i = 0; i < n/2; ++i ) {
+				SDL_StreamMix(i, 2*i, 0.5, 2*i+1, 0.5);
 			}
-			break;
+			n /= 2;
+			SDL_memcpy(m, t, n*sizeof(m[0]));
+		}
 	}
-	cvt->len_cvt *= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+#undef SDL_StreamMix
+	if ( n != dst ) {
+		SDL_SetError("Unsupported audio channel conversion");
+		return(-1);
+	}
+	stream->remix = (src != dst);
+	for ( i = 0; i < dst; ++i ) {
+		for ( j = 0; j < src; ++j ) {
+			stream->mix[i][j] = (Sint16)(m[i][j] * 16384.0);
+		}
 	}
+	return(0);
 }
 
-/* Convert rate down by multiple of 2 */
-void SDLCALL SDL_RateDIV2(SDL_AudioCVT *cvt, Uint16 format)
+SDL_AudioStream *SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
 {
-	int i;
-	Uint8 *src, *dst;
+	SDL_AudioStream *stream;
+	Uint32 a, b, t;
+	double cutoff;
+
+	if ( (src_channels == 0) || (src_channels > STREAM_MAXCHANNELS) ||
+	     (dst_channels == 0) || (dst_channels > STREAM_MAXCHANNELS) ) {
+		SDL_SetError("Unsupported number of audio channels");
+		return(NULL);
+	}
+	if ( (src_rate <= 0) || (dst_rate <= 0) ) {
+		SDL_SetError("Invalid audio rate conversion");
+		return(NULL);
+	}
+	stream = (SDL_AudioStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src_format = src_format;
+	stream->dst_format = dst_format;
+	stream->src_channels = src_channels;
+	stream->dst_channels = dst_channels;
+	stream->src_framesize = src_channels * ((src_format & 0xFF) / 8);
+	stream->dst_framesize = dst_channels * ((dst_format & 0xFF) / 8);
+	if ( SDL_StreamChannels(stream, src_channels, dst_channels) < 0 ) {
+		SDL_free(stream);
+		return(NULL);
+	}
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
-#endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/2; i; --i ) {
-				dst[0] = src[0];
-				src += 2;
-				dst += 1;
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				src += 4;
-				dst += 2;
+	/* Reduce src_rate/dst_rate to lowest terms */
+	a = src_rate;
+	b = dst_rate;
+	while ( b ) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	stream->den = dst_rate / a;
+	stream->step = (src_rate / a) / stream->den;
+	stream->step_frac = (src_rate / a) % stream->den;
+	stream->ntaps = 1;
+
+	if ( src_rate != dst_rate ) {
+		if ( stream->den <= RESAMPLE_PHASES ) {
+			stream->phases = stream->den;
+		} else {
+			stream->phases = RESAMPLE_PHASES;
+		}
+
+		/* Keep a little below Nyquist, of the output rate if lower */
+		cutoff = 0.85;
+		stream->ntaps = RESAMPLE_TAPS;
+		if ( src_rate > dst_rate ) {
+			cutoff = cutoff * dst_rate / src_rate;
+			stream->ntaps *= (src_rate + dst_rate - 1) / dst_rate;
+			if ( stream->ntaps > RESAMPLE_MAXTAPS ) {
+				stream->ntaps = RESAMPLE_MAXTAPS;
 			}
-			break;
+		}
+		stream->taps = (Sint16 *)SDL_malloc(stream->phases *
+					stream->ntaps * sizeof(Sint16));
+		if ( stream->taps == NULL ) {
+			SDL_FreeAudioStream(stream);
+			SDL_OutOfMemory();
+			return(NULL);
+		}
+		SDL_ResampleTaps(stream->taps, stream->phases,
+					stream->ntaps, cutoff);
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+
+	stream->size = 2 * stream->ntaps;
+	stream->history = (Sint16 *)SDL_malloc(dst_channels *
+				stream->size * sizeof(Sint16));
+	if ( stream->history == NULL ) {
+		SDL_FreeAudioStream(stream);
+		SDL_OutOfMemory();
+		return(NULL);
 	}
+	SDL_AudioStreamClear(stream);
+
+	stream->dot = SDL_ResampleDot;
+#if SDL_X86_SIMD_AUDIO
+	if ( SDL_HasSSE2() ) {
+		stream->dot = SDL_ResampleDotSSE2;
+	}
+#endif
+#if SDL_NEON_AUDIO
+	stream->dot = SDL_ResampleDotNEON;
+#endif
+	return(stream);
 }
 
+/* Make room for 'frames' more frames of history */
+static int SDL_StreamGrow(SDL_AudioStream *stream, int frames)
+{
+	Sint16 *history;
+	int size, c;
+
+	if ( stream->avail + frames <= stream->size ) {
+		return(0);
+	}
+	size = 2 * (stream->avail + frames);
+	history = (Sint16 *)SDL_malloc(stream->dst_channels *
+					size * sizeof(Sint16));
+	if ( history == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	for ( c = 0; c < stream->dst_channels; ++c ) {
+		SDL_memcpy(history + c*size, stream->history + c*stream->size,
+		           stream->avail * sizeof(Sint16));
+	}
+	SDL_free(stream->history);
+	stream->history = history;
+	stream->size = size;
+	return(0);
+}
 
-/* Convert rate down by multiple of 2, for stereo */
-void SDLCALL SDL_RateDIV2_c2(SDL_AudioCVT *cvt, Uint16 format)
+/* Decode whole input frames into the history, mixing the channels */
+static void SDL_StreamLoad(SDL_AudioStream *stream, const Uint8 *in, int frames)
 {
-	int i;
-	Uint8 *src, *dst;
+	Uint16 format = stream->src_format;
+	int channels = stream->src_channels;
+	int bytes = (format & 0xFF) / 8;
+	Uint16 flip = (format & 0x8000) ? 0 : 0x8000;
+	int big = (format & 0x1000);
+	int size = stream->size;
+	Sint16 *dst = stream->history + stream->avail;
+	int s[STREAM_MAXCHANNELS];
+	int i, c, j;
+
+	for ( i = 0; i < frames; ++i ) {
+		for ( c = 0; c < channels; ++c ) {
+			if ( bytes == 1 ) {
+				s[c] = (Sint16)((in[0] << 8) ^ flip);
+			} else if ( big ) {
+				s[c] = (Sint16)(((in[0] << 8) | in[1]) ^ flip);
+			} else {
+				s[c] = (Sint16)(((in[1] << 8) | in[0]) ^ flip);
+			}
+			in += bytes;
+		}
+		if ( stream->remix ) {
+			for ( c = 0; c < stream->dst_channels; ++c ) {
+				int v = 0;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
-#endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/4; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				src += 4;
-				dst += 2;
+				for ( j = 0; j < channels; ++j ) {
+					v += s[j] * stream->mix[c][j];
+				}
+				v >>= 14;
+				if ( v > 32767 ) {
+					v = 32767;
+				} else if ( v < -32768 ) {
+					v = -32768;
+				}
+				dst[c*size] = (Sint16)v;
 			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				src += 8;
-				dst += 4;
+		} else {
+			for ( c = 0; c < channels; ++c ) {
+				dst[c*size] = (Sint16)s[c];
 			}
+		}
+		++dst;
+	}
+	stream->avail += frames;
+}
+
+int SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+	const Uint8 *in = (const Uint8 *)buf;
+	int framesize = stream->src_framesize;
+	int frames;
+
+	if ( len <= 0 ) {
+		return(0);
+	}
+	if ( SDL_StreamGrow(stream, (stream->partial_len + len) / framesize) < 0 ) {
+		return(-1);
+	}
+
+	/* Finish off a frame left over from last time */
+	if ( stream->partial_len ) {
+		int n = framesize - stream->partial_len;
+
+		if ( n > len ) {
+			n = len;
+		}
+		SDL_memcpy(stream->partial + stream->partial_len, in, n);
+		stream->partial_len += n;
+		in += n;
+		len -= n;
+		if ( stream->partial_len < framesize ) {
+			return(0);
+		}
+		SDL_StreamLoad(stream, stream->partial, 1);
+		stream->partial_len = 0;
+	}
+
+	frames = len / framesize;
+	SDL_StreamLoad(stream, in, frames);
+	len -= frames * framesize;
+	if ( len ) {
+		SDL_memcpy(stream->partial, in + frames * framesize, len);
+		stream->partial_len = len;
+	}
+	return(0);
+}
+
+int SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+	Uint8 *out = (Uint8 *)buf;
+	Uint16 format = stream->dst_format;
+	int channels = stream->dst_channels;
+	int bytes = (format & 0xFF) / 8;
+	Uint16 flip = (format & 0x8000) ? 0 : 0x8000;
+	int big = (format & 0x1000);
+	int ntaps = stream->ntaps;
+	int maxframes = len / stream->dst_framesize;
+	int frames, used, c;
+
+	for ( frames = 0; frames < maxframes; ++frames ) {
+		const Sint16 *history = stream->history + stream->pos;
+		const Sint16 *taps = NULL;
+
+		if ( stream->pos + ntaps > stream->avail ) {
 			break;
+		}
+		if ( stream->taps == NULL ) {
+			/* No rate change */
+		} else if ( stream->phases == stream->den ) {
+			taps = stream->taps + stream->frac * ntaps;
+		} else {
+			taps = stream->taps + (stream->frac *
+				RESAMPLE_PHASES / stream->den) * ntaps;
+		}
+		for ( c = 0; c < channels; ++c ) {
+			int v;
+
+			if ( taps ) {
+				v = stream->dot(history, taps, ntaps);
+				v = (v + 16384) >> 15;
+				if ( v > 32767 ) {
+					v = 32767;
+				} else if ( v < -32768 ) {
+					v = -32768;
+				}
+			} else {
+				v = *history;
+			}
+			history += stream->size;
+
+			v ^= flip;
+			if ( bytes == 1 ) {
+				*out++ = (Uint8)(v >> 8);
+			} else if ( big ) {
+				*out++ = (Uint8)(v >> 8);
+				*out++ = (Uint8)v;
+			} else {
+				*out++ = (Uint8)v;
+				*out++ = (Uint8)(v >> 8);
+			}
+		}
+		stream->pos += stream->step;
+		stream->frac += stream->step_frac;
+		if ( stream->frac >= stream->den ) {
+			stream->frac -= stream->den;
+			++stream->pos;
+		}
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+
+	/* Drop the history that no output window will need again */
+	used = stream->pos;
+	if ( used > stream->avail ) {
+		used = stream->avail;
 	}
+	if ( used > 0 ) {
+		for ( c = 0; c < channels; ++c ) {
+			Sint16 *h = stream->history + c*stream->size;
+			SDL_memmove(h, h + used,
+			    (stream->avail - used) * sizeof(Sint16));
+		}
+		stream->avail -= used;
+		stream->pos -= used;
+	}
+	return(frames * stream->dst_framesize);
 }
 
+int SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+	double room, step;
+	int frames;
+
+	/* Count the output windows that start early enough to fit in the
+	   history so far, measuring in 1/den frames */
+	room = (double)(stream->avail - stream->ntaps + 1) * stream->den -
+	       ((double)stream->pos * stream->den + stream->frac);
+	if ( room <= 0.0 ) {
+		return(0);
+	}
+	step = (double)stream->step * stream->den + stream->step_frac;
+	frames = (int)((room - 1.0) / step) + 1;
+	return(frames * stream->dst_framesize);
+}
 
-/* Convert rate down by multiple of 2, for quad */
-void SDLCALL SDL_RateDIV2_c4(SDL_AudioCVT *cvt, Uint16 format)
+int SDL_AudioStreamFlush(SDL_AudioStream *stream)
 {
-	int i;
-	Uint8 *src, *dst;
+	int half = stream->ntaps/2;
+	int c;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
-#endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/8; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				src += 8;
-				dst += 4;
-			}
-			break;
-		case 16:
-			for ( i=cvt->len_cvt/16; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				src += 16;
-				dst += 8;
-			}
-			break;
+	/* An incomplete frame can't be converted */
+	stream->partial_len = 0;
+
+	if ( stream->taps == NULL ) {
+		return(0);
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	if ( SDL_StreamGrow(stream, half) < 0 ) {
+		return(-1);
+	}
+	for ( c = 0; c < stream->dst_channels; ++c ) {
+		SDL_memset(stream->history + c*stream->size + stream->avail,
+		           0, half * sizeof(Sint16));
 	}
+	stream->avail += half;
+	return(0);
 }
 
-/* Convert rate down by multiple of 2, for 5.1 */
-void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
+void SDL_AudioStreamClear(SDL_AudioStream *stream)
 {
-	int i;
-	Uint8 *src, *dst;
+	stream->partial_len = 0;
+	stream->pos = 0;
+	stream->frac = 0;
+	stream->avail = 0;
+	if ( stream->taps ) {
+		/* Start with silence before the first frame, centering the
+		   filter on it.  Nothing past it is read before it's written. */
+		int c;
+
+		stream->avail = stream->ntaps/2 - 1;
+		for ( c = 0; c < stream->dst_channels; ++c ) {
+			SDL_memset(stream->history + c*stream->size, 0,
+			           stream->avail * sizeof(Sint16));
+		}
+	}
+}
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate / 2\n");
-#endif
-	src = cvt->buf;
-	dst = cvt->buf;
-	switch (format & 0xFF) {
-		case 8:
-			for ( i=cvt->len_cvt/12; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				src += 12;
-				dst += 6;
-			}
+void SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		if ( stream->taps ) {
+			SDL_free(stream->taps);
+		}
+		if ( stream->history ) {
+			SDL_free(stream->history);
+		}
+		SDL_free(stream);
+	}
+}
+
+/* Recover src_rate/dst_rate in lowest terms from cvt->rate_incr */
+static void SDL_RateFraction(double ratio, int *num, int *den)
+{
+	Uint32 p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+	double x = ratio;
+
+	for ( ;; ) {
+		Uint32 a = (Uint32)x;
+		Uint32 p2 = a*p1 + p0;
+		Uint32 q2 = a*q1 + q0;
+
+		if ( q2 > 0x100000 ) {
 			break;
-		case 16:
-			for ( i=cvt->len_cvt/24; i; --i ) {
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-				dst[4] = src[4];
-				dst[5] = src[5];
-				dst[6] = src[6];
-				dst[7] = src[7];
-				dst[8] = src[8];
-				dst[9] = src[9];
-				dst[10] = src[10];
-				dst[11] = src[11];
-				src += 24;
-				dst += 12;
-			}
+		}
+		p0 = p1; q0 = q1;
+		p1 = p2; q1 = q2;
+		if ( (x - a) < 1e-9 ) {
 			break;
+		}
+		x = 1.0 / (x - a);
 	}
-	cvt->len_cvt /= 2;
-	if ( cvt->filters[++cvt->filter_index] ) {
-		cvt->filters[cvt->filter_index](cvt, format);
+	*num = (int)p1;
+	*den = (int)q1;
+}
+
+/*
+ * The streams SDL_ConvertAudio() resamples with are kept in a small cache,
+ * by rate pair, sample format and channels, so the filter taps are worked
+ * out once and not on every call.  A stream is used by one conversion at
+ * a time; a conversion that finds it busy makes a stream of its own.  The
+ * cache is set up by SDL_AudioInit(), until then every conversion makes
+ * its own stream.
+ */
+#define RATE_CACHE_SIZE	4
+
+typedef struct {
+	SDL_AudioStream *stream;	/* NULL if the entry is unused */
+	double rate_incr;
+	int src_rate;
+	int dst_rate;
+	Uint16 format;
+	int channels;
+	int busy;
+	Uint32 stamp;			/* last use, for replacement */
+} SDL_RateCacheEntry;
+
+static SDL_RateCacheEntry rate_cache[RATE_CACHE_SIZE];
+static Uint32 rate_cache_stamp = 0;
+static SDL_mutex *rate_cache_lock = NULL;
+
+void SDL_InitRateCache(void)
+{
+	if ( !rate_cache_lock ) {
+		rate_cache_lock = SDL_CreateMutex();
 	}
 }
 
-/* Very slow rate conversion routine */
-void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
+void SDL_FreeRateCache(void)
 {
-	double ipos;
-	int i, clen;
+	int i;
 
-#ifdef DEBUG_CONVERT
-	fprintf(stderr, "Converting audio rate * %4.4f\n", 1.0/cvt->rate_incr);
-#endif
-	clen = (int)((double)cvt->len_cvt / cvt->rate_incr);
-	if ( cvt->rate_incr > 1.0 ) {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf;
-				ipos = 0.0;
-				for ( i=clen; i; --i ) {
-					*output = cvt->buf[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
-				}
-			}
-			break;
+	for ( i = 0; i < RATE_CACHE_SIZE; ++i ) {
+		SDL_FreeAudioStream(rate_cache[i].stream);
+		rate_cache[i].stream = NULL;
+		rate_cache[i].busy = 0;
+	}
+	if ( rate_cache_lock ) {
+		SDL_DestroyMutex(rate_cache_lock);
+		rate_cache_lock = NULL;
+	}
+}
 
-			case 16: {
-				Uint16 *output;
+/* Find (or make) a cached stream for a conversion, returning its entry
+   marked busy, or -1 if there's no cache or every entry is busy */
+static int SDL_GetRateStream(double rate_incr, Uint16 format, int channels)
+{
+	SDL_RateCacheEntry *entry;
+	SDL_AudioStream *stream;
+	int i, slot = -1;
 
-				clen &= ~1;
-				output = (Uint16 *)cvt->buf;
-				ipos = 0.0;
-				for ( i=clen/2; i; --i ) {
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
-					ipos += cvt->rate_incr;
-					output += 1;
-				}
-			}
-			break;
+	if ( !rate_cache_lock ) {
+		return(-1);
+	}
+	SDL_mutexP(rate_cache_lock);
+	for ( i = 0; i < RATE_CACHE_SIZE; ++i ) {
+		entry = &rate_cache[i];
+		if ( entry->busy ) {
+			continue;
 		}
-	} else {
-		switch (format & 0xFF) {
-			case 8: {
-				Uint8 *output;
-
-				output = cvt->buf+clen;
-				ipos = (double)cvt->len_cvt;
-				for ( i=clen; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output = cvt->buf[(int)ipos];
-				}
-			}
-			break;
+		if ( entry->stream && (entry->rate_incr == rate_incr) &&
+		     (entry->format == format) && (entry->channels == channels) ) {
+			entry->busy = 1;
+			entry->stamp = ++rate_cache_stamp;
+			SDL_mutexV(rate_cache_lock);
+			SDL_AudioStreamClear(entry->stream);
+			return(i);
+		}
+		if ( (slot < 0) || !entry->stream ||
+		     (rate_cache[slot].stream &&
+		      entry->stamp < rate_cache[slot].stamp) ) {
+			slot = i;
+		}
+	}
+	if ( slot < 0 ) {
+		SDL_mutexV(rate_cache_lock);
+		return(-1);
+	}
 
-			case 16: {
-				Uint16 *output;
+	/* Replace the least recently used entry, working out the taps
+	   without holding up other conversions */
+	entry = &rate_cache[slot];
+	stream = entry->stream;
+	entry->stream = NULL;
+	entry->busy = 1;
+	SDL_mutexV(rate_cache_lock);
+
+	SDL_FreeAudioStream(stream);
+	SDL_RateFraction(rate_incr, &entry->src_rate, &entry->dst_rate);
+	stream = SDL_NewAudioStream(format, channels, entry->src_rate,
+				format, channels, entry->dst_rate);
+
+	SDL_mutexP(rate_cache_lock);
+	entry->stream = stream;
+	entry->rate_incr = rate_incr;
+	entry->format = format;
+	entry->channels = channels;
+	entry->stamp = ++rate_cache_stamp;
+	if ( stream == NULL ) {
+		entry->busy = 0;
+		slot = -1;
+	}
+	SDL_mutexV(rate_cache_lock);
+	return(slot);
+}
 
-				clen &= ~1;
-				output = (Uint16 *)(cvt->buf+clen);
-				ipos = (double)cvt->len_cvt/2;
-				for ( i=clen/2; i; --i ) {
-					ipos -= cvt->rate_incr;
-					output -= 1;
-					*output=((Uint16 *)cvt->buf)[(int)ipos];
-				}
-			}
-			break;
+static void SDL_ReleaseRateStream(int slot)
+{
+	SDL_mutexP(rate_cache_lock);
+	rate_cache[slot].busy = 0;
+	SDL_mutexV(rate_cache_lock);
+}
+
+/* Convert the whole buffer to the new rate in one go */
+static void SDL_RateSinc(SDL_AudioCVT *cvt, Uint16 format, int channels)
+{
+	SDL_AudioStream *stream;
+	int slot, src_rate, dst_rate, clen;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio rate * %4.4f\n", 1.0/cvt->rate_incr);
+#endif
+	slot = SDL_GetRateStream(cvt->rate_incr, format, channels);
+	if ( slot >= 0 ) {
+		stream = rate_cache[slot].stream;
+		src_rate = rate_cache[slot].src_rate;
+		dst_rate = rate_cache[slot].dst_rate;
+	} else {
+		SDL_RateFraction(cvt->rate_incr, &src_rate, &dst_rate);
+		stream = SDL_NewAudioStream(format, channels, src_rate,
+						format, channels, dst_rate);
+	}
+	if ( stream != NULL ) {
+		clen = (int)((double)(cvt->len_cvt / stream->src_framesize) *
+				dst_rate / src_rate) * stream->dst_framesize;
+		if ( (SDL_AudioStreamPut(stream, cvt->buf, cvt->len_cvt) == 0) &&
+		     (SDL_AudioStreamFlush(stream) == 0) ) {
+			cvt->len_cvt = SDL_AudioStreamGet(stream, cvt->buf, clen);
+		}
+		if ( slot >= 0 ) {
+			SDL_ReleaseRateStream(slot);
+		} else {
+			SDL_FreeAudioStream(stream);
 		}
 	}
-	cvt->len_cvt = clen;
 	if ( cvt->filters[++cvt->filter_index] ) {
 		cvt->filters[cvt->filter_index](cvt, format);
 	}
 }
 
+void SDLCALL SDL_RateSinc_c1(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RateSinc(cvt, format, 1);
+}
+
+void SDLCALL SDL_RateSinc_c2(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RateSinc(cvt, format, 2);
+}
+
+void SDLCALL SDL_RateSinc_c4(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RateSinc(cvt, format, 4);
+}
+
+void SDLCALL SDL_RateSinc_c6(SDL_AudioCVT *cvt, Uint16 format)
+{
+	SDL_RateSinc(cvt, format, 6);
+}
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1435,66 +1796,19 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 
 	/* Do rate conversion */
 	cvt->rate_incr = 0.0;
-	if ( (src_rate/100) != (dst_rate/100) ) {
-		Uint32 hi_rate, lo_rate;
-		int len_mult;
-		double len_ratio;
-		void (SDLCALL *rate_cvt)(SDL_AudioCVT *cvt, Uint16 format);
-
-		if ( src_rate > dst_rate ) {
-			hi_rate = src_rate;
-			lo_rate = dst_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateDIV2; break;
-				case 2: rate_cvt = SDL_RateDIV2_c2; break;
-				case 4: rate_cvt = SDL_RateDIV2_c4; break;
-				case 6: rate_cvt = SDL_RateDIV2_c6; break;
-				default: return -1;
-			}
-			len_mult = 1;
-			len_ratio = 0.5;
-		} else {
-			hi_rate = dst_rate;
-			lo_rate = src_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateMUL2; break;
-				case 2: rate_cvt = SDL_RateMUL2_c2; break;
-				case 4: rate_cvt = SDL_RateMUL2_c4; break;
-				case 6: rate_cvt = SDL_RateMUL2_c6; break;
-				default: return -1;
-			}
-			len_mult = 2;
-			len_ratio = 2.0;
-		}
-		/* If hi_rate = lo_rate*2^x then conversion is easy */
-		while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
-			cvt->filters[cvt->filter_index++] = rate_cvt;
-			cvt->len_mult *= len_mult;
-			lo_rate *= 2;
-			cvt->len_ratio *= len_ratio;
-		}
-		/* We may need a slow conversion here to finish up */
-		if ( (lo_rate/100) != (hi_rate/100) ) {
-#if 1
-			/* The problem with this is that if the input buffer is
-			   say 1K, and the conversion rate is say 1.1, then the
-			   output buffer is 1.1K, which may not be an acceptable
-			   buffer size for the audio driver (not a power of 2)
-			*/
-			/* For now, punt and hope the rate distortion isn't great.
-			*/
-#else
-			if ( src_rate < dst_rate ) {
-				cvt->rate_incr = (double)lo_rate/hi_rate;
-				cvt->len_mult *= 2;
-				cvt->len_ratio /= cvt->rate_incr;
-			} else {
-				cvt->rate_incr = (double)hi_rate/lo_rate;
-				cvt->len_ratio *= cvt->rate_incr;
-			}
-			cvt->filters[cvt->filter_index++] = SDL_RateSLOW;
-#endif
+	if ( src_rate != dst_rate ) {
+		switch (src_channels) {
+			case 1: cvt->filters[cvt->filter_index++] = SDL_RateSinc_c1; break;
+			case 2: cvt->filters[cvt->filter_index++] = SDL_RateSinc_c2; break;
+			case 4: cvt->filters[cvt->filter_index++] = SDL_RateSinc_c4; break;
+			case 6: cvt->filters[cvt->filter_index++] = SDL_RateSinc_c6; break;
+			default: return -1;
+		}
+		cvt->rate_incr = (double)src_rate/dst_rate;
+		if ( src_rate < dst_rate ) {
+			cvt->len_mult *= (dst_rate + src_rate - 1) / src_rate;
 		}
+		cvt->len_ratio /= cvt->rate_incr;
 	}
 
 	/* Set up the filter information */
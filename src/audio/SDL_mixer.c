@@ -27,6 +27,7 @@
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_sysaudio.h"
+#include "SDL_audio_c.h"
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
@@ -90,15 +91,455 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
+/* A 32-bit sample scaled like ADJUST_VOLUME, without overflowing */
+#define ADJUST_VOLUME_S32(s, v)	\
+	(s = (s/SDL_MIX_MAXVOLUME)*v + ((s%SDL_MIX_MAXVOLUME)*v)/SDL_MIX_MAXVOLUME)
+
+/*
+ * The SIMD mixers give exactly the same results as the scalar code: the
+ * volume scale truncates toward zero, and the 16 and 32-bit sums saturate.
+ * Each mixes whole vectors and returns the number of samples it did,
+ * leaving the rest to the scalar loop.
+ */
+#if SDL_X86_SIMD_AUDIO
+#include <emmintrin.h>
+
+/* Swap the bytes of each 16 or 32-bit sample */
+#define SWAP16_SSE2(x)	_mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8))
+#define SWAP32_SSE2(x)	_mm_shufflehi_epi16(_mm_shufflelo_epi16(SWAP16_SSE2(x), \
+				_MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1))
+
+/* Scale eight 16-bit samples to 32 bits, dividing by 128 toward zero */
+SDL_AUDIO_TARGET_SSE2
+static __inline__ void ScaleS16_SSE2(__m128i s, __m128i vol, __m128i *lo, __m128i *hi)
+{
+	const __m128i bias = _mm_set1_epi32(SDL_MIX_MAXVOLUME-1);
+	__m128i pl = _mm_mullo_epi16(s, vol);
+	__m128i ph = _mm_mulhi_epi16(s, vol);
+	__m128i p0 = _mm_unpacklo_epi16(pl, ph);
+	__m128i p1 = _mm_unpackhi_epi16(pl, ph);
+
+	p0 = _mm_add_epi32(p0, _mm_and_si128(_mm_srai_epi32(p0, 31), bias));
+	p1 = _mm_add_epi32(p1, _mm_and_si128(_mm_srai_epi32(p1, 31), bias));
+	*lo = _mm_srai_epi32(p0, 7);
+	*hi = _mm_srai_epi32(p1, 7);
+}
+
+/* Scale four 32-bit samples, exactly, through double precision */
+SDL_AUDIO_TARGET_SSE2
+static __inline__ __m128i ScaleS32_SSE2(__m128i s, __m128d scale)
+{
+	__m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(s), scale);
+	__m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(s,
+					_MM_SHUFFLE(1,0,3,2))), scale);
+
+	return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixS16_SSE2(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i = 0; i + 8 <= samples; i += 8 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + 2*i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 2*i));
+
+		if ( swap ) {
+			s = SWAP16_SSE2(s);
+			d = SWAP16_SSE2(d);
+		}
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			__m128i lo, hi;
+			ScaleS16_SSE2(s, vol, &lo, &hi);
+			s = _mm_packs_epi32(lo, hi);
+		}
+		d = _mm_adds_epi16(d, s);
+		if ( swap ) {
+			d = SWAP16_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 2*i), d);
+	}
+	return i;
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixS32_SSE2(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+	const __m128d scale = _mm_set1_pd((double)volume / SDL_MIX_MAXVOLUME);
+	const __m128i max = _mm_set1_epi32(0x7FFFFFFF);
+	Uint32 i;
+
+	for ( i = 0; i + 4 <= samples; i += 4 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + 4*i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 4*i));
+		__m128i sum, ovf;
+
+		if ( swap ) {
+			s = SWAP32_SSE2(s);
+			d = SWAP32_SSE2(d);
+		}
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			s = ScaleS32_SSE2(s, scale);
+		}
+		/* Saturate where both addends have the sign the sum lacks */
+		sum = _mm_add_epi32(d, s);
+		ovf = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(d, sum),
+		                                   _mm_xor_si128(s, sum)), 31);
+		d = _mm_or_si128(_mm_andnot_si128(ovf, sum), _mm_and_si128(ovf,
+		        _mm_xor_si128(_mm_srai_epi32(d, 31), max)));
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 4*i), d);
+	}
+	return i;
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixF32_SSE2(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+	const __m128 scale = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	const __m128 max = _mm_set1_ps(1.0f);
+	const __m128 min = _mm_set1_ps(-1.0f);
+	Uint32 i;
+
+	for ( i = 0; i + 4 <= samples; i += 4 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + 4*i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 4*i));
+		__m128 m;
+
+		if ( swap ) {
+			s = SWAP32_SSE2(s);
+			d = SWAP32_SSE2(d);
+		}
+		m = _mm_add_ps(_mm_castsi128_ps(d),
+		               _mm_mul_ps(_mm_castsi128_ps(s), scale));
+		d = _mm_castps_si128(_mm_max_ps(_mm_min_ps(m, max), min));
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 4*i), d);
+	}
+	return i;
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixMultiS16_SSE2(Uint8 *dst, const Uint8 * const *srcs, const int *volumes, int numsrcs, Uint32 samples, int swap)
+{
+	Uint32 i;
+	int n;
+
+	for ( i = 0; i + 8 <= samples; i += 8 ) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 2*i));
+		__m128i lo, hi;
+
+		if ( swap ) {
+			d = SWAP16_SSE2(d);
+		}
+		lo = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+		hi = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+		for ( n = 0; n < numsrcs; ++n ) {
+			__m128i s, slo, shi;
+
+			if ( volumes[n] == 0 ) {
+				continue;
+			}
+			s = _mm_loadu_si128((const __m128i *)(srcs[n] + 2*i));
+			if ( swap ) {
+				s = SWAP16_SSE2(s);
+			}
+			if ( volumes[n] == SDL_MIX_MAXVOLUME ) {
+				slo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+				shi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+			} else {
+				ScaleS16_SSE2(s, _mm_set1_epi16((short)volumes[n]),
+				              &slo, &shi);
+			}
+			lo = _mm_add_epi32(lo, slo);
+			hi = _mm_add_epi32(hi, shi);
+		}
+		d = _mm_packs_epi32(lo, hi);
+		if ( swap ) {
+			d = SWAP16_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 2*i), d);
+	}
+	return i;
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixMultiS32_SSE2(Uint8 *dst, const Uint8 * const *srcs, const int *volumes, int numsrcs, Uint32 samples, int swap)
+{
+	const __m128d max = _mm_set1_pd(2147483647.0);
+	const __m128d min = _mm_set1_pd(-2147483648.0);
+	Uint32 i;
+	int n;
+
+	for ( i = 0; i + 4 <= samples; i += 4 ) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 4*i));
+		__m128d lo, hi;
+
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		lo = _mm_cvtepi32_pd(d);
+		hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(d, _MM_SHUFFLE(1,0,3,2)));
+		for ( n = 0; n < numsrcs; ++n ) {
+			__m128i s;
+
+			if ( volumes[n] == 0 ) {
+				continue;
+			}
+			s = _mm_loadu_si128((const __m128i *)(srcs[n] + 4*i));
+			if ( swap ) {
+				s = SWAP32_SSE2(s);
+			}
+			if ( volumes[n] != SDL_MIX_MAXVOLUME ) {
+				s = ScaleS32_SSE2(s, _mm_set1_pd(
+				    (double)volumes[n] / SDL_MIX_MAXVOLUME));
+			}
+			lo = _mm_add_pd(lo, _mm_cvtepi32_pd(s));
+			hi = _mm_add_pd(hi, _mm_cvtepi32_pd(
+				_mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2))));
+		}
+		lo = _mm_max_pd(_mm_min_pd(lo, max), min);
+		hi = _mm_max_pd(_mm_min_pd(hi, max), min);
+		d = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 4*i), d);
+	}
+	return i;
+}
+
+SDL_AUDIO_TARGET_SSE2
+static Uint32 MixMultiF32_SSE2(Uint8 *dst, const Uint8 * const *srcs, const int *volumes, int numsrcs, Uint32 samples, int swap)
+{
+	const __m128 max = _mm_set1_ps(1.0f);
+	const __m128 min = _mm_set1_ps(-1.0f);
+	Uint32 i;
+	int n;
+
+	for ( i = 0; i + 4 <= samples; i += 4 ) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + 4*i));
+		__m128 m;
+
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		m = _mm_castsi128_ps(d);
+		for ( n = 0; n < numsrcs; ++n ) {
+			__m128i s;
+
+			if ( volumes[n] == 0 ) {
+				continue;
+			}
+			s = _mm_loadu_si128((const __m128i *)(srcs[n] + 4*i));
+			if ( swap ) {
+				s = SWAP32_SSE2(s);
+			}
+			m = _mm_add_ps(m, _mm_mul_ps(_mm_castsi128_ps(s),
+			    _mm_set1_ps((float)volumes[n] / SDL_MIX_MAXVOLUME)));
+		}
+		d = _mm_castps_si128(_mm_max_ps(_mm_min_ps(m, max), min));
+		if ( swap ) {
+			d = SWAP32_SSE2(d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + 4*i), d);
+	}
+	return i;
+}
+#endif /* SDL_X86_SIMD_AUDIO */
+
+#if SDL_NEON_AUDIO
+#include <arm_neon.h>
+
+static Uint32 MixS16_NEON(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+	const int16x4_t vol = vdup_n_s16((int16_t)volume);
+	const int32x4_t bias = vdupq_n_s32(SDL_MIX_MAXVOLUME-1);
+	Uint32 i;
+
+	for ( i = 0; i + 8 <= samples; i += 8 ) {
+		uint8x16_t sb = vld1q_u8(src + 2*i);
+		uint8x16_t db = vld1q_u8(dst + 2*i);
+		int16x8_t s, d;
+
+		if ( swap ) {
+			sb = vrev16q_u8(sb);
+			db = vrev16q_u8(db);
+		}
+		s = vreinterpretq_s16_u8(sb);
+		d = vreinterpretq_s16_u8(db);
+		if ( volume != SDL_MIX_MAXVOLUME ) {
+			int32x4_t lo = vmull_s16(vget_low_s16(s), vol);
+			int32x4_t hi = vmull_s16(vget_high_s16(s), vol);
+
+			lo = vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), bias));
+			hi = vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), bias));
+			s = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 7)),
+			                 vqmovn_s32(vshrq_n_s32(hi, 7)));
+		}
+		db = vreinterpretq_u8_s16(vqaddq_s16(d, s));
+		if ( swap ) {
+			db = vrev16q_u8(db);
+		}
+		vst1q_u8(dst + 2*i, db);
+	}
+	return i;
+}
+
+static Uint32 MixF32_NEON(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+	const float scale = (float)volume / SDL_MIX_MAXVOLUME;
+	const float32x4_t max = vdupq_n_f32(1.0f);
+	const float32x4_t min = vdupq_n_f32(-1.0f);
+	Uint32 i;
+
+	for ( i = 0; i + 4 <= samples; i += 4 ) {
+		uint8x16_t sb = vld1q_u8(src + 4*i);
+		uint8x16_t db = vld1q_u8(dst + 4*i);
+		float32x4_t m;
+
+		if ( swap ) {
+			sb = vrev32q_u8(sb);
+			db = vrev32q_u8(db);
+		}
+		m = vaddq_f32(vreinterpretq_f32_u8(db),
+		              vmulq_n_f32(vreinterpretq_f32_u8(sb), scale));
+		db = vreinterpretq_u8_f32(vmaxq_f32(vminq_f32(m, max), min));
+		if ( swap ) {
+			db = vrev32q_u8(db);
+		}
+		vst1q_u8(dst + 4*i, db);
+	}
+	return i;
+}
+#endif /* SDL_NEON_AUDIO */
+
+/* Mix what whole vectors of samples we can, returning how many */
+static Uint32 MixS16_SIMD(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+#if SDL_X86_SIMD_AUDIO
+	if ( SDL_HasSSE2() ) {
+		return MixS16_SSE2(dst, src, samples, volume, swap);
+	}
+#endif
+#if SDL_NEON_AUDIO
+	return MixS16_NEON(dst, src, samples, volume, swap);
+#else
+	return 0;
+#endif
+}
+
+static Uint32 MixS32_SIMD(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+#if SDL_X86_SIMD_AUDIO
+	if ( SDL_HasSSE2() ) {
+		return MixS32_SSE2(dst, src, samples, volume, swap);
+	}
+#endif
+	return 0;
+}
+
+static Uint32 MixF32_SIMD(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int swap)
+{
+#if SDL_X86_SIMD_AUDIO
+	if ( SDL_HasSSE2() ) {
+		return MixF32_SSE2(dst, src, samples, volume, swap);
+	}
+#endif
+#if SDL_NEON_AUDIO
+	return MixF32_NEON(dst, src, samples, volume, swap);
+#else
+	return 0;
+#endif
+}
+
+/* Read and write 32-bit samples of either byte order */
+static __inline__ Uint32 GetSample32(const Uint8 *p, int msb)
+{
+	if ( msb ) {
+		return ((Uint32)p[0]<<24)|((Uint32)p[1]<<16)|((Uint32)p[2]<<8)|p[3];
+	}
+	return ((Uint32)p[3]<<24)|((Uint32)p[2]<<16)|((Uint32)p[1]<<8)|p[0];
+}
+
+static __inline__ void PutSample32(Uint8 *p, Uint32 v, int msb)
+{
+	if ( msb ) {
+		p[0] = (Uint8)(v>>24); p[1] = (Uint8)(v>>16);
+		p[2] = (Uint8)(v>>8); p[3] = (Uint8)v;
+	} else {
+		p[3] = (Uint8)(v>>24); p[2] = (Uint8)(v>>16);
+		p[1] = (Uint8)(v>>8); p[0] = (Uint8)v;
+	}
+}
+
+typedef union {
+	Uint32 u;
+	float f;
+} SDL_MixFloat;
+
+static void MixS32(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int msb)
+{
+	const Sint32 max_audioval = 0x7FFFFFFF;
+	const Sint32 min_audioval = -max_audioval - 1;
+	Uint32 i;
+
+	i = MixS32_SIMD(dst, src, samples, volume,
+	                (msb != (SDL_BYTEORDER == SDL_BIG_ENDIAN)));
+	for ( ; i < samples; ++i ) {
+		Sint32 src1 = (Sint32)GetSample32(src + 4*i, msb);
+		Sint32 dst_sample = (Sint32)GetSample32(dst + 4*i, msb);
+
+		ADJUST_VOLUME_S32(src1, volume);
+		if ( src1 > 0 && dst_sample > max_audioval - src1 ) {
+			dst_sample = max_audioval;
+		} else
+		if ( src1 < 0 && dst_sample < min_audioval - src1 ) {
+			dst_sample = min_audioval;
+		} else {
+			dst_sample += src1;
+		}
+		PutSample32(dst + 4*i, (Uint32)dst_sample, msb);
+	}
+}
+
+static void MixF32(Uint8 *dst, const Uint8 *src, Uint32 samples, int volume, int msb)
+{
+	const float scale = (float)volume / SDL_MIX_MAXVOLUME;
+	SDL_MixFloat src1, dst_sample;
+	Uint32 i;
+
+	i = MixF32_SIMD(dst, src, samples, volume,
+	                (msb != (SDL_BYTEORDER == SDL_BIG_ENDIAN)));
+	for ( ; i < samples; ++i ) {
+		src1.u = GetSample32(src + 4*i, msb);
+		dst_sample.u = GetSample32(dst + 4*i, msb);
+		dst_sample.f += src1.f * scale;
+		if ( dst_sample.f > 1.0f ) {
+			dst_sample.f = 1.0f;
+		} else
+		if ( dst_sample.f < -1.0f ) {
+			dst_sample.f = -1.0f;
+		}
+		PutSample32(dst + 4*i, dst_sample.u, msb);
+	}
+}
+
 void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
 
-	if ( volume == 0 ) {
-		return;
-	}
 	/* Mix the user-level audio format */
 	if ( current_audio ) {
+		if ( current_audio->stream ) {
+			format = current_audio->stream_format;
+		} else
 		if ( current_audio->convert.needed ) {
 			format = current_audio->convert.src_format;
 		} else {
@@ -108,6 +549,14 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
   		/* HACK HACK HACK */
 		format = AUDIO_S16;
 	}
+	SDL_MixAudioFormat(dst, src, format, len, volume);
+}
+
+void SDL_MixAudioFormat (Uint8 *dst, const Uint8 *src, Uint16 format, Uint32 len, int volume)
+{
+	if ( volume == 0 ) {
+		return;
+	}
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -198,11 +647,17 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 #else
 			{
 			Sint16 src1, src2;
+			Uint32 done;
 			int dst_sample;
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
 			len /= 2;
+			done = MixS16_SIMD(dst, src, len, volume,
+			                   (AUDIO_S16SYS != AUDIO_S16LSB));
+			src += 2*done;
+			dst += 2*done;
+			len -= done;
 			while ( len-- ) {
 				src1 = ((src[1])<<8|src[0]);
 				ADJUST_VOLUME(src1, volume);
@@ -230,11 +685,17 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			SDL_MixAudio_m68k_S16MSB((short*)dst,(short*)src,(unsigned long)len,(long)volume);
 #else
 			Sint16 src1, src2;
+			Uint32 done;
 			int dst_sample;
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
 			len /= 2;
+			done = MixS16_SIMD(dst, src, len, volume,
+			                   (AUDIO_S16SYS != AUDIO_S16MSB));
+			src += 2*done;
+			dst += 2*done;
+			len -= done;
 			while ( len-- ) {
 				src1 = ((src[0])<<8|src[1]);
 				ADJUST_VOLUME(src1, volume);
@@ -256,9 +717,188 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		}
 		break;
 
+		case AUDIO_S32LSB:
+		case AUDIO_S32MSB:
+			MixS32(dst, src, len/4, volume, (format == AUDIO_S32MSB));
+		break;
+
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB:
+			MixF32(dst, src, len/4, volume, (format == AUDIO_F32MSB));
+		break;
+
 		default: /* If this happens... FIXME! */
 			SDL_SetError("SDL_MixAudio(): unknown audio format");
 			return;
 	}
 }
 
+void SDL_MixAudioMulti (Uint8 *dst, const Uint8 * const *srcs, const int *volumes, int numsrcs, Uint16 format, Uint32 len)
+{
+	Uint32 i = 0;
+	int n, msb, swap;
+
+	/* Like SDL_MixAudioFormat(), leave the buffer alone if all are silent */
+	for ( n = 0; n < numsrcs; ++n ) {
+		if ( volumes[n] ) {
+			break;
+		}
+	}
+	if ( n == numsrcs ) {
+		return;
+	}
+	msb = ((format & 0x1000) != 0);
+	swap = (msb != (SDL_BYTEORDER == SDL_BIG_ENDIAN));
+
+	/* Each source is added at full precision and the sum clipped once */
+	switch (format) {
+		case AUDIO_U8: {
+			const int max_audioval = 0xFE;
+			int dst_sample;
+
+			for ( ; i < len; ++i ) {
+				dst_sample = dst[i];
+				for ( n = 0; n < numsrcs; ++n ) {
+					if ( volumes[n] ) {
+						dst_sample += ((srcs[n][i]-128)*volumes[n])/SDL_MIX_MAXVOLUME;
+					}
+				}
+				if ( dst_sample > max_audioval ) {
+					dst_sample = max_audioval;
+				} else
+				if ( dst_sample < 0 ) {
+					dst_sample = 0;
+				}
+				dst[i] = dst_sample;
+			}
+		}
+		break;
+
+		case AUDIO_S8: {
+			const int max_audioval = ((1<<(8-1))-1);
+			const int min_audioval = -(1<<(8-1));
+			Sint8 *dst8 = (Sint8 *)dst;
+			int dst_sample;
+
+			for ( ; i < len; ++i ) {
+				dst_sample = dst8[i];
+				for ( n = 0; n < numsrcs; ++n ) {
+					if ( volumes[n] ) {
+						dst_sample += (((Sint8 *)srcs[n])[i]*volumes[n])/SDL_MIX_MAXVOLUME;
+					}
+				}
+				if ( dst_sample > max_audioval ) {
+					dst_sample = max_audioval;
+				} else
+				if ( dst_sample < min_audioval ) {
+					dst_sample = min_audioval;
+				}
+				dst8[i] = dst_sample;
+			}
+		}
+		break;
+
+		case AUDIO_S16LSB:
+		case AUDIO_S16MSB: {
+			const int max_audioval = ((1<<(16-1))-1);
+			const int min_audioval = -(1<<(16-1));
+			int hi = msb ? 0 : 1;
+			int dst_sample;
+			Sint16 src1;
+
+			len /= 2;
+#if SDL_X86_SIMD_AUDIO
+			if ( SDL_HasSSE2() ) {
+				i = MixMultiS16_SSE2(dst, srcs, volumes, numsrcs, len, swap);
+			}
+#endif
+			for ( ; i < len; ++i ) {
+				dst_sample = (Sint16)((dst[2*i+hi]<<8)|dst[2*i+1-hi]);
+				for ( n = 0; n < numsrcs; ++n ) {
+					if ( volumes[n] ) {
+						const Uint8 *src = srcs[n] + 2*i;
+						src1 = (Sint16)((src[hi]<<8)|src[1-hi]);
+						ADJUST_VOLUME(src1, volumes[n]);
+						dst_sample += src1;
+					}
+				}
+				if ( dst_sample > max_audioval ) {
+					dst_sample = max_audioval;
+				} else
+				if ( dst_sample < min_audioval ) {
+					dst_sample = min_audioval;
+				}
+				dst[2*i+hi] = (dst_sample>>8)&0xFF;
+				dst[2*i+1-hi] = dst_sample&0xFF;
+			}
+		}
+		break;
+
+		case AUDIO_S32LSB:
+		case AUDIO_S32MSB: {
+			const double max_audioval = 2147483647.0;
+			const double min_audioval = -2147483648.0;
+			double dst_sample;
+			Sint32 src1;
+
+			len /= 4;
+#if SDL_X86_SIMD_AUDIO
+			if ( SDL_HasSSE2() ) {
+				i = MixMultiS32_SSE2(dst, srcs, volumes, numsrcs, len, swap);
+			}
+#endif
+			for ( ; i < len; ++i ) {
+				dst_sample = (Sint32)GetSample32(dst + 4*i, msb);
+				for ( n = 0; n < numsrcs; ++n ) {
+					if ( volumes[n] ) {
+						src1 = (Sint32)GetSample32(srcs[n] + 4*i, msb);
+						ADJUST_VOLUME_S32(src1, volumes[n]);
+						dst_sample += src1;
+					}
+				}
+				if ( dst_sample > max_audioval ) {
+					dst_sample = max_audioval;
+				} else
+				if ( dst_sample < min_audioval ) {
+					dst_sample = min_audioval;
+				}
+				PutSample32(dst + 4*i, (Uint32)(Sint32)dst_sample, msb);
+			}
+		}
+		break;
+
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB: {
+			SDL_MixFloat src1, dst_sample;
+
+			len /= 4;
+#if SDL_X86_SIMD_AUDIO
+			if ( SDL_HasSSE2() ) {
+				i = MixMultiF32_SSE2(dst, srcs, volumes, numsrcs, len, swap);
+			}
+#endif
+			for ( ; i < len; ++i ) {
+				dst_sample.u = GetSample32(dst + 4*i, msb);
+				for ( n = 0; n < numsrcs; ++n ) {
+					if ( volumes[n] ) {
+						src1.u = GetSample32(srcs[n] + 4*i, msb);
+						dst_sample.f += src1.f * ((float)volumes[n] / SDL_MIX_MAXVOLUME);
+					}
+				}
+				if ( dst_sample.f > 1.0f ) {
+					dst_sample.f = 1.0f;
+				} else
+				if ( dst_sample.f < -1.0f ) {
+					dst_sample.f = -1.0f;
+				}
+				PutSample32(dst + 4*i, dst_sample.u, msb);
+			}
+		}
+		break;
+
+		default:
+			SDL_SetError("SDL_MixAudioMulti(): unknown audio format");
+			return;
+	}
+}
+
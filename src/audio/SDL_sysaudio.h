@@ -70,6 +70,14 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* The conversion SDL_RunAudio() does instead, straight into the
+	   device buffer and carrying on smoothly from one to the next */
+	SDL_AudioStream *stream;
+	Uint8 *stream_buf;		/* the application's buffer */
+	int stream_len;
+	Uint16 stream_format;
+	Uint8 stream_silence;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
@@ -85,6 +93,18 @@ struct SDL_AudioDevice {
 	SDL_Thread *thread;
 	Uint32 threadid;
 
+	/* Ring buffer for SDL_QueueAudio(), when opened without a callback */
+	Uint8 *queue;
+	Uint32 queue_size;		/* a power of two */
+	volatile Uint32 queue_head;	/* bytes ever queued */
+	volatile Uint32 queue_tail;	/* bytes ever played or cleared */
+	Uint32 queue_underruns;
+	int queue_starving;
+
+	/* Microseconds before the last buffer played is heard, 0 if unknown;
+	   drivers that can measure it update this from the audio thread */
+	volatile Uint32 latency;
+
 	/* * * */
 	/* Data private to this driver */
 	struct SDL_PrivateAudioData *hidden;
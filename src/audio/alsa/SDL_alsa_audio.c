@@ -85,6 +85,9 @@ static int (*SDL_NAME(snd_pcm_sw_params_current))(snd_pcm_t *pcm, snd_pcm_sw_par
 static int (*SDL_NAME(snd_pcm_sw_params_set_start_threshold))(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, snd_pcm_uframes_t val);
 static int (*SDL_NAME(snd_pcm_sw_params))(snd_pcm_t *pcm, snd_pcm_sw_params_t *params);
 static int (*SDL_NAME(snd_pcm_nonblock))(snd_pcm_t *pcm, int nonblock);
+static snd_pcm_sframes_t (*SDL_NAME(snd_pcm_avail_update))(snd_pcm_t *pcm);
+static int (*SDL_NAME(snd_pcm_wait))(snd_pcm_t *pcm, int timeout);
+static int (*SDL_NAME(snd_pcm_delay))(snd_pcm_t *pcm, snd_pcm_sframes_t *delayp);
 #define snd_pcm_hw_params_sizeof SDL_NAME(snd_pcm_hw_params_sizeof)
 #define snd_pcm_sw_params_sizeof SDL_NAME(snd_pcm_sw_params_sizeof)
 
@@ -121,6 +124,9 @@ static struct {
 	{ "snd_pcm_sw_params_set_start_threshold",	(void**)(char*)&SDL_NAME(snd_pcm_sw_params_set_start_threshold)	},
 	{ "snd_pcm_sw_params",	(void**)(char*)&SDL_NAME(snd_pcm_sw_params)	},
 	{ "snd_pcm_nonblock",	(void**)(char*)&SDL_NAME(snd_pcm_nonblock)	},
+	{ "snd_pcm_avail_update",	(void**)(char*)&SDL_NAME(snd_pcm_avail_update)	},
+	{ "snd_pcm_wait",	(void**)(char*)&SDL_NAME(snd_pcm_wait)		},
+	{ "snd_pcm_delay",	(void**)(char*)&SDL_NAME(snd_pcm_delay)		},
 };
 
 static void UnloadALSALibrary(void) {
@@ -249,10 +255,57 @@ AudioBootStrap ALSA_bootstrap = {
 	Audio_Available, Audio_CreateDevice
 };
 
+/* snd_pcm_recover() is available in alsa-lib >= 1.0.11 */
+static int ALSA_pcm_recover(snd_pcm_t *handle, int err, int silent)
+{
+	(void) silent;
+	if (err == -EINTR) return 0;
+	if (err == -EPIPE) {		/* under-run */
+		err = SDL_NAME(snd_pcm_prepare)(handle);
+		return (err < 0)? err : 0;
+	}
+	if (err == -ESTRPIPE) {
+		/* wait until suspend flag is released */
+		while ((err = SDL_NAME(snd_pcm_resume)(handle)) == -EAGAIN)
+			SDL_Delay(100);
+		if (err < 0) err = SDL_NAME(snd_pcm_prepare)(handle);
+		return (err < 0)? err : 0;
+	}
+	return err;
+}
+
 /* This function waits until it is possible to write a full sound buffer */
 static void ALSA_WaitAudio(_THIS)
 {
-	/* We're in blocking mode, so there's nothing to do here */
+	snd_pcm_sframes_t avail;
+	int status;
+
+	if ( !low_latency ) {
+		/* We're in blocking mode, so there's nothing to do here */
+		return;
+	}
+
+	/* Sleep until the device has room for a whole period, so the
+	   write that follows never blocks and never leaves a gap */
+	while ( this->enabled ) {
+		avail = SDL_NAME(snd_pcm_avail_update)(pcm_handle);
+		if ( avail >= (snd_pcm_sframes_t)this->spec.samples ) {
+			return;
+		}
+		if ( avail >= 0 ) {
+			status = SDL_NAME(snd_pcm_wait)(pcm_handle, 100);
+		} else {
+			status = (int)avail;
+		}
+		if ( status < 0 ) {
+			status = ALSA_pcm_recover(pcm_handle, status, 0);
+			if ( status < 0 ) {
+				fprintf(stderr, "ALSA wait failed (unrecoverable): %s\n", SDL_NAME(snd_strerror)(status));
+				this->enabled = 0;
+				return;
+			}
+		}
+	}
 }
 
 
@@ -300,28 +353,10 @@ static __inline__ void swizzle_alsa_channels(_THIS)
 }
 
 
-/* snd_pcm_recover() is available in alsa-lib >= 1.0.11 */
-static int ALSA_pcm_recover(snd_pcm_t *handle, int err, int silent)
-{
-	(void) silent;
-	if (err == -EINTR) return 0;
-	if (err == -EPIPE) {		/* under-run */
-		err = SDL_NAME(snd_pcm_prepare)(handle);
-		return (err < 0)? err : 0;
-	}
-	if (err == -ESTRPIPE) {
-		/* wait until suspend flag is released */
-		while ((err = SDL_NAME(snd_pcm_resume)(handle)) == -EAGAIN)
-			SDL_Delay(100);
-		if (err < 0) err = SDL_NAME(snd_pcm_prepare)(handle);
-		return (err < 0)? err : 0;
-	}
-	return err;
-}
-
 static void ALSA_PlayAudio(_THIS)
 {
 	int status;
+	snd_pcm_sframes_t delay;
 	snd_pcm_uframes_t frames_left;
 	const Uint8 *sample_buf = (const Uint8 *) mixbuf;
 	const int frame_size = (((int) (this->spec.format & 0xFF)) / 8) * this->spec.channels;
@@ -350,6 +385,11 @@ static void ALSA_PlayAudio(_THIS)
 		sample_buf += status * frame_size;
 		frames_left -= status;
 	}
+
+	/* Everything queued in the device, including what we just wrote */
+	if ( SDL_NAME(snd_pcm_delay)(pcm_handle, &delay) == 0 && delay > 0 ) {
+		this->latency = (Uint32)(((Uint64)delay * 1000000) / this->spec.freq);
+	}
 }
 
 static Uint8 *ALSA_GetAudioBuf(_THIS)
@@ -367,7 +407,7 @@ static void ALSA_CloseAudio(_THIS)
 		/* Wait for the submitted audio to drain
 		   snd_pcm_drop() can hang, so don't use that.
 		 */
-		Uint32 delay = ((this->spec.samples * 1000) / this->spec.freq) * 2;
+		Uint32 delay = ((this->spec.samples * 1000) / this->spec.freq) * periods;
 		SDL_Delay(delay);
 		SDL_NAME(snd_pcm_close)(pcm_handle);
 		pcm_handle = NULL;
@@ -390,22 +430,22 @@ static int ALSA_finalize_hardware(_THIS, SDL_AudioSpec *spec, snd_pcm_hw_params_
 	if ( status < 0 ) {
 		return(-1);
 	}
-	if ( !override && bufsize != spec->samples * 2 ) {
+	if ( !override && bufsize != spec->samples * periods ) {
 		return(-1);
 	}
 
 	/* FIXME: Is this safe to do? */
-	spec->samples = bufsize / 2;
+	spec->samples = bufsize / periods;
 
 	/* This is useful for debugging */
 	if ( getenv("SDL_AUDIO_ALSA_DEBUG") ) {
 		snd_pcm_uframes_t persize = 0;
-		unsigned int periods = 0;
+		unsigned int nperiods = 0;
 
 		SDL_NAME(snd_pcm_hw_params_get_period_size)(hwparams, &persize, NULL);
-		SDL_NAME(snd_pcm_hw_params_get_periods)(hwparams, &periods, NULL);
+		SDL_NAME(snd_pcm_hw_params_get_periods)(hwparams, &nperiods, NULL);
 
-		fprintf(stderr, "ALSA: period size = %ld, periods = %u, buffer size = %lu\n", persize, periods, bufsize);
+		fprintf(stderr, "ALSA: period size = %ld, periods = %u, buffer size = %lu\n", persize, nperiods, bufsize);
 	}
 	return(0);
 }
@@ -416,7 +456,7 @@ static int ALSA_set_period_size(_THIS, SDL_AudioSpec *spec, snd_pcm_hw_params_t
 	int status;
 	snd_pcm_hw_params_t *hwparams;
 	snd_pcm_uframes_t frames;
-	unsigned int periods;
+	unsigned int nperiods;
 
 	/* Copy the hardware parameters for this setup */
 	snd_pcm_hw_params_alloca(&hwparams);
@@ -438,8 +478,8 @@ static int ALSA_set_period_size(_THIS, SDL_AudioSpec *spec, snd_pcm_hw_params_t
 		return(-1);
 	}
 
-	periods = 2;
-	status = SDL_NAME(snd_pcm_hw_params_set_periods_near)(pcm_handle, hwparams, &periods, NULL);
+	nperiods = periods;
+	status = SDL_NAME(snd_pcm_hw_params_set_periods_near)(pcm_handle, hwparams, &nperiods, NULL);
 	if ( status < 0 ) {
 		return(-1);
 	}
@@ -468,7 +508,7 @@ static int ALSA_set_buffer_size(_THIS, SDL_AudioSpec *spec, snd_pcm_hw_params_t
 		}
 	}
 
-	frames = spec->samples * 2;
+	frames = spec->samples * periods;
 	status = SDL_NAME(snd_pcm_hw_params_set_buffer_size_near)(pcm_handle, hwparams, &frames);
 	if ( status < 0 ) {
 		return(-1);
@@ -486,6 +526,19 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	unsigned int         rate;
 	unsigned int 	     channels;
 	Uint16               test_format;
+	const char          *env;
+
+	/* In low latency mode the device buffer holds 'periods' periods of
+	   spec->samples frames each, and we only write what fits in it */
+	env = SDL_getenv("SDL_AUDIO_LOW_LATENCY");
+	low_latency = (env && SDL_atoi(env));
+	periods = 2;
+	if ( low_latency ) {
+		env = SDL_getenv("SDL_AUDIO_PERIODS");
+		if ( env && SDL_atoi(env) >= 2 ) {
+			periods = SDL_atoi(env);
+		}
+	}
 
 	/* Open the audio device */
 	/* Name of device should depend on # channels in spec */
@@ -496,9 +549,12 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 		return(-1);
 	}
 
-	/* Switch to blocking mode for playback */
+	/* Switch to blocking mode for playback, unless we're going to wait
+	   for room in the device buffer ourselves */
 	/* Note: this must happen before hw/sw params are set. */
-	SDL_NAME(snd_pcm_nonblock)(pcm_handle, 0);
+	if ( !low_latency ) {
+		SDL_NAME(snd_pcm_nonblock)(pcm_handle, 0);
+	}
 
 	/* Figure out what the hardware is capable of */
 	snd_pcm_hw_params_alloca(&hwparams);
@@ -607,7 +663,9 @@ static int ALSA_OpenAudio(_THIS, SDL_AudioSpec *spec)
 		ALSA_CloseAudio(this);
 		return(-1);
 	}
-	status = SDL_NAME(snd_pcm_sw_params_set_start_threshold)(pcm_handle, swparams, 1);
+	/* Don't start a low latency stream before its buffer is full, or it
+	   will underrun straight away */
+	status = SDL_NAME(snd_pcm_sw_params_set_start_threshold)(pcm_handle, swparams, low_latency ? spec->samples * periods : 1);
 	if ( status < 0 ) {
 		SDL_SetError("Couldn't set start threshold: %s", SDL_NAME(snd_strerror)(status));
 		ALSA_CloseAudio(this);
@@ -38,11 +38,17 @@ struct SDL_PrivateAudioData {
 	/* Raw mixing buffer */
 	Uint8 *mixbuf;
 	int    mixlen;
+
+	/* The number of periods in the device buffer */
+	unsigned int periods;
+	int low_latency;
 };
 
 /* Old variable names */
 #define pcm_handle		(this->hidden->pcm_handle)
 #define mixbuf			(this->hidden->mixbuf)
 #define mixlen			(this->hidden->mixlen)
+#define periods			(this->hidden->periods)
+#define low_latency		(this->hidden->low_latency)
 
 #endif /* _ALSA_PCM_audio_h */
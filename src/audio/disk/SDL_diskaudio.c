@@ -35,6 +35,7 @@
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "../SDL_audiodev_c.h"
+#include "../SDL_wave.h"
 #include "SDL_diskaudio.h"
 
 /* The tag name used by DISK audio */
@@ -44,7 +45,11 @@
 #define DISKENVR_OUTFILE         "SDL_DISKAUDIOFILE"
 #define DISKDEFAULT_OUTFILE      "sdlaudio.raw"
 #define DISKENVR_WRITEDELAY      "SDL_DISKAUDIODELAY"
-#define DISKDEFAULT_WRITEDELAY   150
+#define DISKENVR_CLOCK           "SDL_DISKAUDIOCLOCK"
+#define DISKENVR_WAV             "SDL_DISKAUDIOWAV"
+
+/* Size of the WAVE header written ahead of the samples */
+#define DISK_WAVHEADER_LEN       44
 
 /* Audio driver functions */
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec);
@@ -96,8 +101,12 @@ static SDL_AudioDevice *DISKAUD_CreateDevice(int devindex)
 	}
 	SDL_memset(this->hidden, 0, (sizeof *this->hidden));
 
+	/* Without a fixed delay, the output is paced to play in real time,
+	   or, with SDL_DISKAUDIOCLOCK=fast, rendered as fast as possible */
 	envr = SDL_getenv(DISKENVR_WRITEDELAY);
-	this->hidden->write_delay = (envr) ? SDL_atoi(envr) : DISKDEFAULT_WRITEDELAY;
+	this->hidden->write_delay = (envr) ? SDL_atoi(envr) : 0;
+	envr = SDL_getenv(DISKENVR_CLOCK);
+	this->hidden->fast_clock = (envr && SDL_strcasecmp(envr, "fast") == 0);
 
 	/* Set the function pointers */
 	this->OpenAudio = DISKAUD_OpenAudio;
@@ -119,68 +128,241 @@ AudioBootStrap DISKAUD_bootstrap = {
 /* This function waits until it is possible to write a full sound buffer */
 static void DISKAUD_WaitAudio(_THIS)
 {
-	SDL_Delay(this->hidden->write_delay);
+	struct SDL_PrivateAudioData *h = this->hidden;
+	Uint32 freq = this->spec.freq;
+
+	if ( h->write_error ) {
+		this->enabled = 0;
+		return;
+	}
+
+	/* Wait until the writer is done with the buffer we'll mix into */
+	if ( h->writer ) {
+		SDL_SemWait(h->room);
+	}
+
+	if ( h->fast_clock ) {
+		/* Don't race ahead writing silence before playback starts */
+		if ( this->paused ) {
+			SDL_Delay((this->spec.samples * 1000) / freq);
+		}
+		return;
+	}
+	if ( h->write_delay ) {
+		SDL_Delay(h->write_delay);
+		return;
+	}
+
+	/* Sleep until the audio written so far would have finished playing,
+	   folding whole seconds into the start time so nothing overflows */
+	if ( h->frames_played >= freq ) {
+		h->start_ticks += (h->frames_played / freq) * 1000;
+		h->frames_played %= freq;
+	}
+	{
+		Uint32 due = h->start_ticks + (h->frames_played * 1000) / freq;
+		Sint32 wait = (Sint32)(due - SDL_GetTicks());
+
+		if ( wait > 0 ) {
+			SDL_Delay(wait);
+		}
+	}
 }
 
-static void DISKAUD_PlayAudio(_THIS)
+static int DISKAUD_WriteBuffer(_THIS, const Uint8 *buf)
 {
 	int written;
 
 	/* Write the audio data */
-	written = SDL_RWwrite(this->hidden->output,
-                        this->hidden->mixbuf, 1,
-                        this->hidden->mixlen);
+	written = SDL_RWwrite(this->hidden->output, buf, 1,
+	                      this->hidden->mixlen);
 
 	/* If we couldn't write, assume fatal error for now */
 	if ( (Uint32)written != this->hidden->mixlen ) {
-		this->enabled = 0;
+		return(-1);
 	}
+	this->hidden->data_len += written;
 #ifdef DEBUG_AUDIO
 	fprintf(stderr, "Wrote %d bytes of audio data\n", written);
 #endif
+	return(0);
+}
+
+/* The writer thread, which owns the file while the audio is running */
+static int SDLCALL DISKAUD_WriterThread(void *data)
+{
+	SDL_AudioDevice *this = (SDL_AudioDevice *)data;
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	for ( ; ; ) {
+		SDL_SemWait(h->ready);
+
+		/* A wakeup with nothing submitted means it's time to quit */
+		if ( h->written == h->submitted ) {
+			break;
+		}
+		if ( !h->write_error && DISKAUD_WriteBuffer(this,
+		         h->mixbuf + (h->written % 2) * h->mixlen) < 0 ) {
+			h->write_error = 1;
+		}
+		++h->written;
+		SDL_SemPost(h->room);
+	}
+	return(0);
+}
+
+static void DISKAUD_PlayAudio(_THIS)
+{
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	h->frames_played += this->spec.samples;
+
+	if ( h->writer ) {
+		/* Hand the buffer to the writer and mix into the other one */
+		++h->submitted;
+		SDL_SemPost(h->ready);
+		h->filling = !h->filling;
+	} else if ( DISKAUD_WriteBuffer(this, h->mixbuf) < 0 ) {
+		this->enabled = 0;
+	}
 }
 
 static Uint8 *DISKAUD_GetAudioBuf(_THIS)
 {
-	return(this->hidden->mixbuf);
+	return(this->hidden->mixbuf + this->hidden->filling * this->hidden->mixlen);
+}
+
+static int DISKAUD_WriteWavHeader(_THIS, Uint32 data_len)
+{
+	SDL_RWops *dst = this->hidden->output;
+	Uint16 bits = (this->spec.format & 0xFF);
+	Uint16 blockalign = (bits / 8) * this->spec.channels;
+
+	if ( SDL_RWseek(dst, 0, RW_SEEK_SET) < 0 ) {
+		return(-1);
+	}
+	if ( !SDL_WriteLE32(dst, RIFF) ||
+	     !SDL_WriteLE32(dst, DISK_WAVHEADER_LEN - 8 + data_len) ||
+	     !SDL_WriteLE32(dst, WAVE) ||
+	     !SDL_WriteLE32(dst, FMT) ||
+	     !SDL_WriteLE32(dst, 16) ||
+	     !SDL_WriteLE16(dst, PCM_CODE) ||
+	     !SDL_WriteLE16(dst, this->spec.channels) ||
+	     !SDL_WriteLE32(dst, this->spec.freq) ||
+	     !SDL_WriteLE32(dst, this->spec.freq * blockalign) ||
+	     !SDL_WriteLE16(dst, blockalign) ||
+	     !SDL_WriteLE16(dst, bits) ||
+	     !SDL_WriteLE32(dst, DATA) ||
+	     !SDL_WriteLE32(dst, data_len) ) {
+		return(-1);
+	}
+	return(0);
 }
 
 static void DISKAUD_CloseAudio(_THIS)
 {
-	if ( this->hidden->mixbuf != NULL ) {
-		SDL_FreeAudioMem(this->hidden->mixbuf);
-		this->hidden->mixbuf = NULL;
+	struct SDL_PrivateAudioData *h = this->hidden;
+
+	/* Let the writer finish what it has been given, then stop it */
+	if ( h->writer != NULL ) {
+		SDL_SemPost(h->ready);
+		SDL_WaitThread(h->writer, NULL);
+		h->writer = NULL;
+	}
+	if ( h->ready != NULL ) {
+		SDL_DestroySemaphore(h->ready);
+		h->ready = NULL;
+	}
+	if ( h->room != NULL ) {
+		SDL_DestroySemaphore(h->room);
+		h->room = NULL;
+	}
+	if ( h->mixbuf != NULL ) {
+		SDL_FreeAudioMem(h->mixbuf);
+		h->mixbuf = NULL;
 	}
-	if ( this->hidden->output != NULL ) {
-		SDL_RWclose(this->hidden->output);
-		this->hidden->output = NULL;
+	if ( h->output != NULL ) {
+		/* Now that the length is known, fix up the header */
+		if ( h->wav_output ) {
+			DISKAUD_WriteWavHeader(this, h->data_len);
+		}
+		SDL_RWclose(h->output);
+		h->output = NULL;
 	}
 }
 
 static int DISKAUD_OpenAudio(_THIS, SDL_AudioSpec *spec)
 {
+	struct SDL_PrivateAudioData *h = this->hidden;
 	const char *fname = DISKAUD_GetOutputFilename();
+	const char *envr;
+	size_t namelen;
+
+	/* Write a WAVE file if asked to, or if the name says so */
+	envr = SDL_getenv(DISKENVR_WAV);
+	namelen = SDL_strlen(fname);
+	if ( envr ) {
+		h->wav_output = SDL_atoi(envr);
+	} else {
+		h->wav_output = (namelen >= 4 &&
+		    SDL_strcasecmp(fname + namelen - 4, ".wav") == 0);
+	}
+	if ( h->wav_output ) {
+		/* PCM WAVE data is unsigned 8-bit or signed little-endian */
+		if ( (spec->format & 0xFF) == 8 ) {
+			spec->format = AUDIO_U8;
+		} else {
+			spec->format = AUDIO_S16LSB;
+		}
+		SDL_CalculateAudioSpec(spec);
+	}
 
 	/* Open the audio device */
-	this->hidden->output = SDL_RWFromFile(fname, "wb");
-	if ( this->hidden->output == NULL ) {
+	h->output = SDL_RWFromFile(fname, "wb");
+	if ( h->output == NULL ) {
 		return(-1);
 	}
+	h->data_len = 0;
+	if ( h->wav_output ) {
+		if ( DISKAUD_WriteWavHeader(this, 0) < 0 ) {
+			SDL_SetError("Couldn't write WAVE header to %s", fname);
+			DISKAUD_CloseAudio(this);
+			return(-1);
+		}
+	}
 
 #if HAVE_STDIO_H
 	fprintf(stderr, "WARNING: You are using the SDL disk writer"
                     " audio driver!\n Writing to file [%s].\n", fname);
 #endif
 
-	/* Allocate mixing buffer */
-	this->hidden->mixlen = spec->size;
-	this->hidden->mixbuf = (Uint8 *) SDL_AllocAudioMem(this->hidden->mixlen);
-	if ( this->hidden->mixbuf == NULL ) {
+	/* Allocate the mixing buffers */
+	h->mixlen = spec->size;
+	h->mixbuf = (Uint8 *) SDL_AllocAudioMem(h->mixlen * 2);
+	if ( h->mixbuf == NULL ) {
+		DISKAUD_CloseAudio(this);
 		return(-1);
 	}
-	SDL_memset(this->hidden->mixbuf, spec->silence, spec->size);
+	SDL_memset(h->mixbuf, spec->silence, h->mixlen * 2);
+	h->filling = 0;
+
+	/* Write from a separate thread, so the audio thread never waits on
+	   the disk unless it gets a whole buffer ahead of it */
+	h->submitted = h->written = 0;
+	h->write_error = 0;
+	h->ready = SDL_CreateSemaphore(0);
+	h->room = SDL_CreateSemaphore(1);	/* the other one is mixed first */
+	if ( h->ready && h->room ) {
+		h->writer = SDL_CreateThread(DISKAUD_WriterThread, this);
+	}
+	if ( h->writer == NULL ) {
+		/* Fall back to writing from the audio thread */
+		SDL_ClearError();
+	}
+
+	h->start_ticks = SDL_GetTicks();
+	h->frames_played = 0;
 
 	/* We're ready to rock and roll. :-) */
 	return(0);
 }
-
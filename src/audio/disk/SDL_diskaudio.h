@@ -25,6 +25,7 @@
 #define _SDL_diskaudio_h
 
 #include "SDL_rwops.h"
+#include "SDL_thread.h"
 #include "../SDL_sysaudio.h"
 
 /* Hidden "this" pointer for the video functions */
@@ -33,9 +34,27 @@
 struct SDL_PrivateAudioData {
 	/* The file descriptor for the audio device */
 	SDL_RWops *output;
-	Uint8 *mixbuf;
+	Uint8 *mixbuf;			/* two buffers of mixlen bytes */
 	Uint32 mixlen;
-	Uint32 write_delay;
+	int filling;			/* the buffer being mixed into */
+
+	/* How the audio thread is paced */
+	Uint32 write_delay;		/* fixed delay, if one was asked for */
+	int fast_clock;			/* don't wait at all */
+	Uint32 start_ticks;
+	Uint32 frames_played;		/* since start_ticks */
+
+	/* Write a WAVE header, patching in the data length on close */
+	int wav_output;
+	Uint32 data_len;
+
+	/* The thread doing the file writes */
+	SDL_Thread *writer;
+	SDL_sem *ready;			/* filled buffers waiting to be written */
+	SDL_sem *room;			/* buffers free to mix into */
+	Uint32 submitted;
+	Uint32 written;
+	volatile int write_error;
 };
 
 #endif /* _SDL_diskaudio_h */
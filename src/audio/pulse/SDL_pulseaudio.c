@@ -109,6 +109,8 @@ static int (*SDL_NAME(pa_stream_connect_playback))(pa_stream *s, const char *dev
 	pa_cvolume *volume, pa_stream *sync_stream);
 static pa_stream_state_t (*SDL_NAME(pa_stream_get_state))(pa_stream *s);
 static size_t (*SDL_NAME(pa_stream_writable_size))(pa_stream *s);
+static int (*SDL_NAME(pa_stream_get_latency))(pa_stream *s,
+	pa_usec_t *r_usec, int *negative);
 static int (*SDL_NAME(pa_stream_write))(pa_stream *s, const void *data, size_t nbytes,
 	pa_free_cb_t free_cb, int64_t offset, pa_seek_mode_t seek);
 static pa_operation * (*SDL_NAME(pa_stream_drain))(pa_stream *s,
@@ -160,6 +162,8 @@ static struct {
 		(void **)&SDL_NAME(pa_stream_get_state)		},
 	{ "pa_stream_writable_size",
 		(void **)&SDL_NAME(pa_stream_writable_size)	},
+	{ "pa_stream_get_latency",
+		(void **)&SDL_NAME(pa_stream_get_latency)	},
 	{ "pa_stream_write",
 		(void **)&SDL_NAME(pa_stream_write)		},
 	{ "pa_stream_drain",
@@ -304,24 +308,37 @@ AudioBootStrap PULSE_bootstrap = {
 static void PULSE_WaitAudio(_THIS)
 {
 	int size;
+	/* In low latency mode, don't sleep if the server already has room */
+	int block = !low_latency;
 	while(1) {
 		if (SDL_NAME(pa_context_get_state)(context) != PA_CONTEXT_READY ||
 		    SDL_NAME(pa_stream_get_state)(stream) != PA_STREAM_READY ||
-		    SDL_NAME(pa_mainloop_iterate)(mainloop, 1, NULL) < 0) {
+		    SDL_NAME(pa_mainloop_iterate)(mainloop, block, NULL) < 0) {
 			this->enabled = 0;
 			return;
 		}
 		size = SDL_NAME(pa_stream_writable_size)(stream);
 		if (size >= mixlen)
 			return;
+		block = 1;
 	}
 }
 
 static void PULSE_PlayAudio(_THIS)
 {
+	pa_usec_t usec;
+	int negative;
+
 	/* Write the audio data */
-	if (SDL_NAME(pa_stream_write)(stream, mixbuf, mixlen, NULL, 0LL, PA_SEEK_RELATIVE) < 0)
+	if (SDL_NAME(pa_stream_write)(stream, mixbuf, mixlen, NULL, 0LL, PA_SEEK_RELATIVE) < 0) {
 		this->enabled = 0;
+		return;
+	}
+
+	/* This fails until the first timing update arrives */
+	if (SDL_NAME(pa_stream_get_latency)(stream, &usec, &negative) == 0 && !negative) {
+		this->latency = (usec > 0xFFFFFFFF) ? 0xFFFFFFFF : (Uint32)usec;
+	}
 }
 
 static Uint8 *PULSE_GetAudioBuf(_THIS)
@@ -430,6 +447,19 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	pa_buffer_attr  paattr;
 	pa_channel_map  pacmap;
 	pa_stream_flags_t flags = 0;
+	const char     *env;
+
+	/* In low latency mode the server holds 'periods' buffers of
+	   spec->samples frames, and we write each as soon as it has room */
+	env = SDL_getenv("SDL_AUDIO_LOW_LATENCY");
+	low_latency = (env && SDL_atoi(env));
+	periods = 2;
+	if ( low_latency ) {
+		env = SDL_getenv("SDL_AUDIO_PERIODS");
+		if ( env && SDL_atoi(env) >= 2 ) {
+			periods = SDL_atoi(env);
+		}
+	}
 
 	paspec.format = PA_SAMPLE_INVALID;
 	for ( test_format = SDL_FirstAudioFormat(spec->format); test_format; ) {
@@ -459,7 +489,9 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 
 	/* Calculate the final parameters for this audio specification */
 #ifdef PA_STREAM_ADJUST_LATENCY
-	spec->samples /= 2; /* Mix in smaller chunck to avoid underruns */
+	if ( !low_latency ) {
+		spec->samples /= 2; /* Mix in smaller chunck to avoid underruns */
+	}
 #endif
 	SDL_CalculateAudioSpec(spec);
 
@@ -473,7 +505,12 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 
 	/* Reduced prebuffering compared to the defaults. */
 #ifdef PA_STREAM_ADJUST_LATENCY
-	paattr.tlength = mixlen * 4; /* 2x original requested bufsize */
+	if ( low_latency ) {
+		/* tlength covers the server's own buffering too */
+		paattr.tlength = mixlen * periods;
+	} else {
+		paattr.tlength = mixlen * 4; /* 2x original requested bufsize */
+	}
 	paattr.prebuf = -1;
 	paattr.maxlength = -1;
 	paattr.minreq = mixlen; /* -1 can lead to pa_stream_writable_size()
@@ -485,6 +522,8 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 	paattr.maxlength = mixlen*2;
 	paattr.minreq = mixlen;
 #endif
+	/* Keep the latency SDL_GetAudioLatency() reports up to date */
+	flags |= PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE;
 
 	/* The SDL ALSA output hints us that we use Windows' channel mapping */
 	/* http://bugzilla.libsdl.org/show_bug.cgi?id=110 */
@@ -42,6 +42,10 @@ struct SDL_PrivateAudioData {
 	/* Raw mixing buffer */
 	Uint8 *mixbuf;
 	int    mixlen;
+
+	/* The number of mixing buffers the server holds */
+	int periods;
+	int low_latency;
 };
 
 #if (PA_API_VERSION < 12)
@@ -68,6 +72,8 @@ static inline int PA_STREAM_IS_GOOD(pa_stream_state_t x) {
 #define stream			(this->hidden->stream)
 #define mixbuf			(this->hidden->mixbuf)
 #define mixlen			(this->hidden->mixlen)
+#define periods			(this->hidden->periods)
+#define low_latency		(this->hidden->low_latency)
 
 #endif /* _SDL_pulseaudio_h */
 
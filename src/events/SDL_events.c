@@ -32,23 +32,120 @@
 #include "../joystick/SDL_joystick_c.h"
 #endif
 
+#if HAVE_SELECT && HAVE_PIPE
+#define SDL_EVENT_WAIT_SELECT
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
 /* Public data -- the event filter */
 SDL_EventFilter SDL_EventOK = NULL;
 Uint8 SDL_ProcessEvents[SDL_NUMEVENTS];
 static Uint32 SDL_eventstate = 0;
 
-/* Private data -- event queue */
-#define MAXEVENTS	128
+/* Atomic operations for the event queue, which lets any thread add events
+   without taking a lock.  Without them adding events is serialized by the
+   queue lock.
+ */
+#if defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define SDL_EVENTQ_LOCKFREE
+#define SDL_EventQ_Add(p, v)		__sync_fetch_and_add(p, v)
+#define SDL_EventQ_CAS(p, o, n)		__sync_bool_compare_and_swap(p, o, n)
+#define SDL_EventQ_Barrier()		__sync_synchronize()
+#else
+#define SDL_EventQ_Add(p, v)		((*(p) += (v)) - (v))
+#define SDL_EventQ_CAS(p, o, n)		((*(p) == (o)) ? (*(p) = (n), 1) : 0)
+#define SDL_EventQ_Barrier()
+#endif
+
+/* Private data -- event queue
+
+   Events are stored in a linked list of fixed size segments.  Producers
+   reserve a slot in the tail segment with an atomic increment, fill it in
+   and mark it ready, appending a new segment when the tail is full.  The
+   single consumer (whoever holds the queue lock) links ready slots, in
+   order, into a list per event type, so looking for a few types only
+   visits the events of those types.  Taken events are marked as removed
+   and consumed segments are recycled once no producer can still be
+   looking at them.
+ */
+#define MAXEVENTS	8192		/* events queued before we drop them */
+#define SEGEVENTS	128		/* events per segment */
+
+#define SLOT_EMPTY	0		/* reserved, not yet written */
+#define SLOT_READY	1
+#define SLOT_REMOVED	2
+
+/* Events are bucketed by type the way SDL_EVENTMASK() sees them */
+#define EVENTBUCKET(type)	((type) % SDL_NUMEVENTS)
+
+typedef struct SDL_EventPos {
+	struct SDL_EventSegment *seg;
+	int slot;
+} SDL_EventPos;
+
+typedef struct SDL_EventSegment {
+	struct SDL_EventSegment * volatile next;
+	volatile int reserved;		/* slots handed out to producers */
+	int first;			/* first slot not removed yet */
+	volatile Uint8 state[SEGEVENTS];
+	SDL_Event event[SEGEVENTS];
+	struct SDL_SysWMmsg wmmsg[SEGEVENTS];
+	Uint32 seq[SEGEVENTS];		/* position in the queue */
+	SDL_EventPos link[SEGEVENTS];	/* next queued event of this type */
+} SDL_EventSegment;
+
 static struct {
 	SDL_mutex *lock;
 	int active;
-	int head;
-	int tail;
-	SDL_Event event[MAXEVENTS];
-	int wmmsg_next;
-	struct SDL_SysWMmsg wmmsg[MAXEVENTS];
+	SDL_EventSegment *head;			/* consumer end */
+	SDL_EventSegment * volatile tail;	/* producer end */
+	SDL_EventSegment * volatile spare;	/* ready for the next producer */
+	SDL_EventSegment *retired;	/* consumed, maybe still seen by producers */
+	SDL_EventSegment *pool;		/* consumed and safe to reuse */
+	volatile int pushing;		/* producers in SDL_AddEvents() */
+	volatile int count;		/* events reserved or queued */
+	volatile Uint32 published;	/* events made visible so far */
+	volatile int highwater;		/* largest count seen */
+	volatile Uint32 dropped;	/* events lost because the queue was full */
+
+	/* Consumer side, protected by the lock */
+	SDL_EventPos index;		/* next slot to link into the lists */
+	Uint32 seq;
+	Uint32 typemask;		/* buckets with events queued */
+	SDL_EventPos first[SDL_NUMEVENTS];
+	SDL_EventPos last[SDL_NUMEVENTS];
+	SDL_EventPos run;		/* first of the trailing events ... */
+	int runtype;			/* ... that are all of this type */
 } SDL_EventQ;
 
+/* Private data -- merge motion events into the ones already queued */
+static SDL_bool SDL_EventCoalesce = SDL_FALSE;
+
+/* Private data -- waking up threads waiting for events.
+   Threads that can pump events sleep in select() on the input sources and
+   a pipe that is written to when an event is queued, other threads wait on
+   the condition variable.  The counters are changed with SDL_EventQ.lock
+   held, and read without it by SDL_AddEvents().
+ */
+#define MAXWAITFDS	16
+static struct {
+	SDL_cond *cond;
+	volatile int waiting;	/* threads blocked on cond */
+	volatile int sleeping;	/* threads blocked in select() */
+	int woken;		/* a byte is pending in the pipe */
+#ifdef SDL_EVENT_WAIT_SELECT
+	int pipe[2];
+#endif
+} SDL_EventWait = {
+	NULL, 0, 0, 0,
+#ifdef SDL_EVENT_WAIT_SELECT
+	{ -1, -1 }
+#endif
+};
+
 /* Private data -- event locking structure */
 static struct {
 	SDL_mutex *lock;
@@ -87,6 +184,120 @@ void SDL_Unlock_EventThread(void)
 #include <time.h>
 #endif
 
+/* The shorter of two timeouts in milliseconds, -1 meaning forever */
+static Sint32 SDL_MinTimeout(Sint32 a, Sint32 b)
+{
+	if ( a < 0 ) {
+		return(b);
+	}
+	if ( (b < 0) || (a < b) ) {
+		return(a);
+	}
+	return(b);
+}
+
+static SDL_bool SDL_CanWaitInput(void)
+{
+#ifdef SDL_EVENT_WAIT_SELECT
+	if ( SDL_EventWait.pipe[0] >= 0 ) {
+		return(SDL_TRUE);
+	}
+#endif
+	return(SDL_FALSE);
+}
+
+/* Wake up the threads waiting for events -- called with the queue locked */
+static void SDL_WakeEventWaitLocked(void)
+{
+	if ( SDL_EventWait.waiting ) {
+		SDL_CondBroadcast(SDL_EventWait.cond);
+	}
+#ifdef SDL_EVENT_WAIT_SELECT
+	if ( SDL_EventWait.sleeping && ! SDL_EventWait.woken ) {
+		char c = 0;
+		if ( write(SDL_EventWait.pipe[1], &c, 1) == 1 ) {
+			SDL_EventWait.woken = 1;
+		}
+	}
+#endif
+}
+
+void SDL_WakeEventWait(void)
+{
+	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+		SDL_WakeEventWaitLocked();
+		SDL_mutexV(SDL_EventQ.lock);
+	}
+}
+
+/* Sleep until one of the input sources is readable, an event is queued,
+   or 'timeout' milliseconds pass.  Sources that can only be polled are
+   checked every 'interval' milliseconds.  The caller registers itself
+   in SDL_EventWait.sleeping with the queue locked before it computes
+   'timeout', so it can't miss an event queued or a timer added after
+   it last looked.
+ */
+static void SDL_WaitInput(Sint32 timeout, Sint32 interval)
+{
+#ifdef SDL_EVENT_WAIT_SELECT
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	int fds[MAXWAITFDS];
+	int i, n, numfds, max_fd;
+	fd_set fdset;
+	struct timeval tv;
+
+	timeout = SDL_MinTimeout(timeout, SDL_NextKeyRepeat());
+	numfds = 0;
+	if ( video ) {
+		n = -1;
+		if ( video->GetEventFDs ) {
+			n = video->GetEventFDs(this, fds, MAXWAITFDS, &timeout);
+		}
+		if ( n < 0 ) {
+			timeout = SDL_MinTimeout(timeout, interval);
+		} else {
+			numfds = n;
+		}
+	}
+#if !SDL_JOYSTICK_DISABLED
+	if ( SDL_numjoysticks && (SDL_eventstate & SDL_JOYEVENTMASK) ) {
+		n = SDL_JoystickGetFDs(&fds[numfds], MAXWAITFDS-numfds);
+		if ( n < 0 ) {
+			timeout = SDL_MinTimeout(timeout, interval);
+		} else {
+			numfds += n;
+		}
+	}
+#endif
+
+	FD_ZERO(&fdset);
+	max_fd = SDL_EventWait.pipe[0];
+	FD_SET(max_fd, &fdset);
+	for ( i=0; i<numfds; ++i ) {
+		FD_SET(fds[i], &fdset);
+		if ( max_fd < fds[i] ) {
+			max_fd = fds[i];
+		}
+	}
+	if ( timeout >= 0 ) {
+		tv.tv_sec = timeout / 1000;
+		tv.tv_usec = (timeout % 1000) * 1000;
+	}
+	select(max_fd+1, &fdset, NULL, NULL, (timeout >= 0) ? &tv : NULL);
+
+	/* The pipe stays readable until the last sleeper is awake */
+	SDL_mutexP(SDL_EventQ.lock);
+	if ( (--SDL_EventWait.sleeping == 0) && SDL_EventWait.woken ) {
+		char buf[16];
+		while ( read(SDL_EventWait.pipe[0], buf, sizeof(buf)) > 0 )
+			;
+		SDL_EventWait.woken = 0;
+	}
+	SDL_mutexV(SDL_EventQ.lock);
+#endif /* SDL_EVENT_WAIT_SELECT */
+}
+
 static int SDLCALL SDL_GobbleEvents(void *unused)
 {
 	event_thread = SDL_ThreadID();
@@ -117,12 +328,31 @@ static int SDLCALL SDL_GobbleEvents(void *unused)
 		}
 #endif
 
-		/* Give up the CPU for the rest of our timeslice */
+		/* Sleep until there is input or the next timer is due */
 		SDL_EventLock.safe = 1;
 		if ( SDL_timer_running ) {
 			SDL_ThreadedTimerCheck();
 		}
-		SDL_Delay(1);
+		if ( SDL_CanWaitInput() ) {
+			Sint32 timeout = -1;
+			/* Register as a sleeper before looking at the timers,
+			   so a timer added or an event pushed from here on
+			   writes the wake pipe instead of being missed.
+			 */
+			SDL_mutexP(SDL_EventQ.lock);
+			if ( SDL_EventQ.active ) {
+				++SDL_EventWait.sleeping;
+				SDL_mutexV(SDL_EventQ.lock);
+				if ( SDL_timer_running ) {
+					timeout = SDL_ThreadedTimerTimeout();
+				}
+				SDL_WaitInput(timeout, 1);
+			} else {
+				SDL_mutexV(SDL_EventQ.lock);
+			}
+		} else {
+			SDL_Delay(1);
+		}
 
 		/* Check for event locking.
 		   On the P of the lock mutex, if the lock is held, this thread
@@ -141,6 +371,31 @@ static int SDLCALL SDL_GobbleEvents(void *unused)
 	return(0);
 }
 
+static SDL_EventSegment *SDL_NewEventSegment(void)
+{
+	SDL_EventSegment *seg;
+
+	seg = (SDL_EventSegment *)SDL_malloc(sizeof(*seg));
+	if ( seg == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	seg->next = NULL;
+	seg->reserved = 0;
+	seg->first = 0;
+	SDL_memset((void *)seg->state, SLOT_EMPTY, sizeof(seg->state));
+	return(seg);
+}
+
+static void SDL_FreeEventSegments(SDL_EventSegment *seg)
+{
+	while ( seg ) {
+		SDL_EventSegment *next = seg->next;
+		SDL_free(seg);
+		seg = next;
+	}
+}
+
 static int SDL_StartEventThread(Uint32 flags)
 {
 	/* Reset everything to zero */
@@ -158,6 +413,28 @@ static int SDL_StartEventThread(Uint32 flags)
 #endif
 	}
 #endif /* !SDL_THREADS_DISABLED */
+	SDL_EventQ.head = SDL_NewEventSegment();
+	if ( SDL_EventQ.head == NULL ) {
+		return(-1);
+	}
+	SDL_EventQ.tail = SDL_EventQ.head;
+	SDL_EventQ.index.seg = SDL_EventQ.head;
+	SDL_EventQ.index.slot = 0;
+	SDL_EventQ.typemask = 0;
+	SDL_EventQ.run.seg = NULL;
+	SDL_memset(SDL_EventQ.first, 0, sizeof(SDL_EventQ.first));
+	SDL_memset(SDL_EventQ.last, 0, sizeof(SDL_EventQ.last));
+	SDL_memset(&SDL_EventWait, 0, sizeof(SDL_EventWait));
+	SDL_EventWait.cond = SDL_CreateCond();
+#ifdef SDL_EVENT_WAIT_SELECT
+	if ( pipe(SDL_EventWait.pipe) == 0 ) {
+		fcntl(SDL_EventWait.pipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(SDL_EventWait.pipe[1], F_SETFL, O_NONBLOCK);
+	} else {
+		SDL_EventWait.pipe[0] = -1;
+		SDL_EventWait.pipe[1] = -1;
+	}
+#endif
 	SDL_EventQ.active = 1;
 
 	if ( (flags&SDL_INIT_EVENTTHREAD) == SDL_INIT_EVENTTHREAD ) {
@@ -188,11 +465,24 @@ static void SDL_StopEventThread(void)
 {
 	SDL_EventQ.active = 0;
 	if ( SDL_EventThread ) {
+		SDL_WakeEventWait();
 		SDL_WaitThread(SDL_EventThread, NULL);
 		SDL_EventThread = NULL;
 		SDL_DestroyMutex(SDL_EventLock.lock);
 		SDL_EventLock.lock = NULL;
 	}
+	if ( SDL_EventWait.cond ) {
+		SDL_DestroyCond(SDL_EventWait.cond);
+		SDL_EventWait.cond = NULL;
+	}
+#ifdef SDL_EVENT_WAIT_SELECT
+	if ( SDL_EventWait.pipe[0] >= 0 ) {
+		close(SDL_EventWait.pipe[0]);
+		close(SDL_EventWait.pipe[1]);
+		SDL_EventWait.pipe[0] = -1;
+		SDL_EventWait.pipe[1] = -1;
+	}
+#endif
 #ifndef IPOD
 	SDL_DestroyMutex(SDL_EventQ.lock);
 	SDL_EventQ.lock = NULL;
@@ -218,23 +508,39 @@ void SDL_StopEventLoop(void)
 	SDL_QuitQuit();
 
 	/* Clean out EventQ */
-	SDL_EventQ.head = 0;
-	SDL_EventQ.tail = 0;
-	SDL_EventQ.wmmsg_next = 0;
+	SDL_FreeEventSegments(SDL_EventQ.head);
+	SDL_FreeEventSegments(SDL_EventQ.spare);
+	SDL_FreeEventSegments(SDL_EventQ.retired);
+	SDL_FreeEventSegments(SDL_EventQ.pool);
+	SDL_EventQ.head = NULL;
+	SDL_EventQ.tail = NULL;
+	SDL_EventQ.spare = NULL;
+	SDL_EventQ.retired = NULL;
+	SDL_EventQ.pool = NULL;
+	SDL_EventQ.count = 0;
+	SDL_EventQ.highwater = 0;
+	SDL_EventQ.dropped = 0;
 }
 
 /* This function (and associated calls) may be called more than once */
 int SDL_StartEventLoop(Uint32 flags)
 {
+	const char *coalesce;
 	int retcode;
 
 	/* Clean out the event queue */
 	SDL_EventThread = NULL;
 	SDL_EventQ.lock = NULL;
+	SDL_EventQ.head = NULL;
+	SDL_EventQ.spare = NULL;
+	SDL_EventQ.retired = NULL;
+	SDL_EventQ.pool = NULL;
 	SDL_StopEventLoop();
 
 	/* No filter to start with, process most event types */
 	SDL_EventOK = NULL;
+	coalesce = SDL_getenv("SDL_EVENT_COALESCE");
+	SDL_EventCoalesce = (coalesce && SDL_atoi(coalesce)) ? SDL_TRUE : SDL_FALSE;
 	SDL_memset(SDL_ProcessEvents,SDL_ENABLE,sizeof(SDL_ProcessEvents));
 	SDL_eventstate = ~0;
 	/* It's not safe to call SDL_EventState() yet */
@@ -261,101 +567,277 @@ int SDL_StartEventLoop(Uint32 flags)
 }
 
 
-/* Add an event to the event queue -- called with the queue locked */
-static int SDL_AddEvent(SDL_Event *event)
+/* Add events to the event queue -- safe to call from any thread */
+static int SDL_AddEvents(SDL_Event *events, int numevents)
 {
-	int tail, added;
+	SDL_EventSegment *seg, *next;
+	int count, highwater, added, slot, i, n;
 
-	tail = (SDL_EventQ.tail+1)%MAXEVENTS;
-	if ( tail == SDL_EventQ.head ) {
-		/* Overflow, drop event */
-		added = 0;
-	} else {
-		SDL_EventQ.event[SDL_EventQ.tail] = *event;
-		if (event->type == SDL_SYSWMEVENT) {
-			/* Note that it's possible to lose an event */
-			int next = SDL_EventQ.wmmsg_next;
-			SDL_EventQ.wmmsg[next] = *event->syswm.msg;
-		        SDL_EventQ.event[SDL_EventQ.tail].syswm.msg =
-						&SDL_EventQ.wmmsg[next];
-			SDL_EventQ.wmmsg_next = (next+1)%MAXEVENTS;
-		}
-		SDL_EventQ.tail = tail;
-		added = 1;
+	if ( numevents <= 0 ) {
+		return(0);
+	}
+	count = SDL_EventQ_Add(&SDL_EventQ.count, numevents) + numevents;
+	if ( count > MAXEVENTS ) {
+		/* Overflow, drop what doesn't fit */
+		n = count - MAXEVENTS;
+		if ( n > numevents ) {
+			n = numevents;
+		}
+		SDL_EventQ_Add(&SDL_EventQ.count, -n);
+		SDL_EventQ_Add(&SDL_EventQ.dropped, n);
+		numevents -= n;
+		count -= n;
+		if ( numevents == 0 ) {
+			return(0);
+		}
+	}
+	do {
+		highwater = SDL_EventQ.highwater;
+	} while ( (count > highwater) &&
+	          !SDL_EventQ_CAS(&SDL_EventQ.highwater, highwater, count) );
+
+	SDL_EventQ_Add(&SDL_EventQ.pushing, 1);
+	added = 0;
+	for ( ; ; ) {
+		seg = SDL_EventQ.tail;
+		slot = SDL_EventQ_Add(&seg->reserved, numevents - added);
+		if ( slot < SEGEVENTS ) {
+			n = SEGEVENTS - slot;
+			if ( n > (numevents - added) ) {
+				n = numevents - added;
+			}
+			for ( i = 0; i < n; ++i ) {
+				SDL_Event *event = &events[added+i];
+				seg->event[slot+i] = *event;
+				if (event->type == SDL_SYSWMEVENT) {
+					seg->wmmsg[slot+i] = *event->syswm.msg;
+					seg->event[slot+i].syswm.msg =
+							&seg->wmmsg[slot+i];
+				}
+			}
+			SDL_EventQ_Barrier();
+			for ( i = 0; i < n; ++i ) {
+				seg->state[slot+i] = SLOT_READY;
+			}
+			added += n;
+			if ( added == numevents ) {
+				break;
+			}
+		}
+
+		/* The tail segment is full, append one and move the tail */
+		next = seg->next;
+		if ( next == NULL ) {
+			next = SDL_EventQ.spare;
+			if ( !next || !SDL_EventQ_CAS(&SDL_EventQ.spare, next, NULL) ) {
+				next = SDL_NewEventSegment();
+			}
+			if ( next == NULL ) {
+				n = numevents - added;
+				SDL_EventQ_Add(&SDL_EventQ.count, -n);
+				SDL_EventQ_Add(&SDL_EventQ.dropped, n);
+				break;
+			}
+			if ( ! SDL_EventQ_CAS(&seg->next, NULL, next) ) {
+				/* Somebody else got there first */
+				if ( ! SDL_EventQ_CAS(&SDL_EventQ.spare, NULL, next) ) {
+					SDL_free(next);
+				}
+				next = seg->next;
+			}
+		}
+		SDL_EventQ_CAS(&SDL_EventQ.tail, seg, next);
+	}
+	SDL_EventQ_Add(&SDL_EventQ.pushing, -1);
+
+	/* Pairs with the check in SDL_WaitEventOnce() */
+	SDL_EventQ_Add(&SDL_EventQ.published, added);
+	if ( added && (SDL_EventWait.waiting || SDL_EventWait.sleeping) ) {
+		SDL_WakeEventWait();
 	}
 	return(added);
 }
 
-/* Cut an event, and return the next valid spot, or the tail */
-/*                           -- called with the queue locked */
-static int SDL_CutEvent(int spot)
+/* Link newly published events into the per-type lists
+                                     -- called with the queue locked */
+static void SDL_IndexEvents(void)
 {
-	if ( spot == SDL_EventQ.head ) {
-		SDL_EventQ.head = (SDL_EventQ.head+1)%MAXEVENTS;
-		return(SDL_EventQ.head);
-	} else
-	if ( (spot+1)%MAXEVENTS == SDL_EventQ.tail ) {
-		SDL_EventQ.tail = spot;
-		return(SDL_EventQ.tail);
-	} else
-	/* We cut the middle -- shift everything over */
-	{
-		int here, next;
+	SDL_EventSegment *seg;
+	int slot, end, type;
 
-		/* This can probably be optimized with SDL_memcpy() -- careful! */
-		if ( --SDL_EventQ.tail < 0 ) {
-			SDL_EventQ.tail = MAXEVENTS-1;
+	seg = SDL_EventQ.index.seg;
+	slot = SDL_EventQ.index.slot;
+	for ( ; ; ) {
+		if ( slot == SEGEVENTS ) {
+			if ( seg->next == NULL ) {
+				break;
+			}
+			seg = seg->next;
+			slot = 0;
 		}
-		for ( here=spot; here != SDL_EventQ.tail; here = next ) {
-			next = (here+1)%MAXEVENTS;
-			SDL_EventQ.event[here] = SDL_EventQ.event[next];
+		end = seg->reserved;
+		if ( (slot >= end) || (seg->state[slot] != SLOT_READY) ) {
+			/* Nothing more, or still being written */
+			break;
+		}
+		SDL_EventQ_Barrier();
+		type = EVENTBUCKET(seg->event[slot].type);
+		seg->seq[slot] = SDL_EventQ.seq++;
+		seg->link[slot].seg = NULL;
+		if ( SDL_EventQ.last[type].seg ) {
+			SDL_EventPos *last = &SDL_EventQ.last[type];
+			last->seg->link[last->slot].seg = seg;
+			last->seg->link[last->slot].slot = slot;
+		} else {
+			SDL_EventQ.first[type].seg = seg;
+			SDL_EventQ.first[type].slot = slot;
+			SDL_EventQ.typemask |= (1 << type);
+		}
+		SDL_EventQ.last[type].seg = seg;
+		SDL_EventQ.last[type].slot = slot;
+		if ( !SDL_EventQ.run.seg || (SDL_EventQ.runtype != type) ) {
+			SDL_EventQ.run.seg = seg;
+			SDL_EventQ.run.slot = slot;
+			SDL_EventQ.runtype = type;
+		}
+		++slot;
+	}
+	SDL_EventQ.index.seg = seg;
+	SDL_EventQ.index.slot = slot;
+}
+
+/* Remove the oldest event of a type -- called with the queue locked */
+static void SDL_CutEvent(int type)
+{
+	SDL_EventSegment *seg = SDL_EventQ.first[type].seg;
+	int slot = SDL_EventQ.first[type].slot;
+
+	SDL_EventQ.first[type] = seg->link[slot];
+	if ( (SDL_EventQ.run.seg == seg) && (SDL_EventQ.run.slot == slot) ) {
+		SDL_EventQ.run = seg->link[slot];
+	}
+	if ( SDL_EventQ.first[type].seg == NULL ) {
+		SDL_EventQ.last[type].seg = NULL;
+		SDL_EventQ.typemask &= ~(1 << type);
+	}
+	seg->state[slot] = SLOT_REMOVED;
+	while ( (seg->first < SEGEVENTS) &&
+	        (seg->state[seg->first] == SLOT_REMOVED) ) {
+		++seg->first;
+	}
+	SDL_EventQ_Add(&SDL_EventQ.count, -1);
+}
+
+/* Recycle consumed segments -- called with the queue locked */
+static void SDL_RecycleEventSegments(void)
+{
+	SDL_EventSegment *seg;
+
+	/* Retire consumed segments the producers have moved past */
+	while ( (SDL_EventQ.head->first == SEGEVENTS) &&
+	        (SDL_EventQ.head != SDL_EventQ.tail) &&
+	        (SDL_EventQ.head != SDL_EventQ.index.seg) ) {
+		seg = SDL_EventQ.head;
+		SDL_EventQ.head = seg->next;
+		seg->next = SDL_EventQ.retired;
+		SDL_EventQ.retired = seg;
+	}
+
+	/* A producer that saw a retired segment as the tail is still pushing */
+	SDL_EventQ_Barrier();
+	if ( SDL_EventQ.retired && (SDL_EventQ.pushing == 0) ) {
+		while ( SDL_EventQ.retired ) {
+			seg = SDL_EventQ.retired;
+			SDL_EventQ.retired = seg->next;
+			seg->next = SDL_EventQ.pool;
+			SDL_EventQ.pool = seg;
+		}
+	}
+	if ( SDL_EventQ.pool && (SDL_EventQ.spare == NULL) ) {
+		seg = SDL_EventQ.pool;
+		SDL_EventQ.pool = seg->next;
+		seg->next = NULL;
+		seg->reserved = 0;
+		seg->first = 0;
+		SDL_memset((void *)seg->state, SLOT_EMPTY, sizeof(seg->state));
+		if ( ! SDL_EventQ_CAS(&SDL_EventQ.spare, NULL, seg) ) {
+			seg->next = SDL_EventQ.pool;
+			SDL_EventQ.pool = seg;
+		}
+	}
+}
+
+/* Take a peep at the event queue -- called with the queue locked */
+static int SDL_PeepEventsLocked(SDL_Event *events, int numevents,
+				SDL_eventaction action, Uint32 mask)
+{
+	int used;
+
+	used = 0;
+	if ( action == SDL_ADDEVENT ) {
+		used = SDL_AddEvents(events, numevents);
+	} else {
+		SDL_Event tmpevent;
+		SDL_EventPos pos[SDL_NUMEVENTS];
+		Uint32 types;
+		int type, oldest;
+
+		/* If 'events' is NULL, just see if they exist */
+		if ( events == NULL ) {
+			action = SDL_PEEKEVENT;
+			numevents = 1;
+			events = &tmpevent;
+		}
+		SDL_IndexEvents();
+
+		/* Merge the lists of the requested types in queue order */
+		types = SDL_EventQ.typemask & mask;
+		SDL_memcpy(pos, SDL_EventQ.first, sizeof(pos));
+		while ( (used < numevents) && types ) {
+			oldest = -1;
+			for ( type = 0; type < SDL_NUMEVENTS; ++type ) {
+				if ( (types & (1 << type)) &&
+				     ((oldest < 0) ||
+				      ((Sint32)(pos[type].seg->seq[pos[type].slot] -
+				                pos[oldest].seg->seq[pos[oldest].slot]) < 0)) ) {
+					oldest = type;
+				}
+			}
+			events[used++] = pos[oldest].seg->event[pos[oldest].slot];
+			if ( action == SDL_GETEVENT ) {
+				SDL_CutEvent(oldest);
+				pos[oldest] = SDL_EventQ.first[oldest];
+			} else {
+				pos[oldest] = pos[oldest].seg->link[pos[oldest].slot];
+			}
+			if ( pos[oldest].seg == NULL ) {
+				types &= ~(1 << oldest);
+			}
 		}
-		return(spot);
+		SDL_RecycleEventSegments();
 	}
-	/* NOTREACHED */
+	return(used);
 }
 
 /* Lock the event queue, take a peep at it, and unlock it */
 int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 								Uint32 mask)
 {
-	int i, used;
+	int used;
 
 	/* Don't look after we've quit */
 	if ( ! SDL_EventQ.active ) {
 		return(-1);
 	}
+#ifdef SDL_EVENTQ_LOCKFREE
+	if ( action == SDL_ADDEVENT ) {
+		return(SDL_PeepEventsLocked(events, numevents, action, mask));
+	}
+#endif
 	/* Lock the event queue */
 	used = 0;
 	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
-		if ( action == SDL_ADDEVENT ) {
-			for ( i=0; i<numevents; ++i ) {
-				used += SDL_AddEvent(&events[i]);
-			}
-		} else {
-			SDL_Event tmpevent;
-			int spot;
-
-			/* If 'events' is NULL, just see if they exist */
-			if ( events == NULL ) {
-				action = SDL_PEEKEVENT;
-				numevents = 1;
-				events = &tmpevent;
-			}
-			spot = SDL_EventQ.head;
-			while ((used < numevents)&&(spot != SDL_EventQ.tail)) {
-				if ( mask & SDL_EVENTMASK(SDL_EventQ.event[spot].type) ) {
-					events[used++] = SDL_EventQ.event[spot];
-					if ( action == SDL_GETEVENT ) {
-						spot = SDL_CutEvent(spot);
-					} else {
-						spot = (spot+1)%MAXEVENTS;
-					}
-				} else {
-					spot = (spot+1)%MAXEVENTS;
-				}
-			}
-		}
+		used = SDL_PeepEventsLocked(events, numevents, action, mask);
 		SDL_mutexV(SDL_EventQ.lock);
 	} else {
 		SDL_SetError("Couldn't lock event queue");
@@ -400,18 +882,108 @@ int SDL_PollEvent (SDL_Event *event)
 	return 1;
 }
 
+/* Get the next event, or wait up to 'timeout' milliseconds (-1 forever)
+   for something to happen.  Returns 1 if there was an event, 0 if not,
+   or -1 if there was an error.
+ */
+static int SDL_WaitEventOnce(SDL_Event *event, Sint32 timeout)
+{
+	Uint32 published;
+	int used;
+
+	/* Don't look after we've quit */
+	if ( ! SDL_EventQ.active ) {
+		return(-1);
+	}
+	if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+		SDL_SetError("Couldn't lock event queue");
+		return(-1);
+	}
+	published = SDL_EventQ.published;
+	SDL_EventQ_Barrier();
+	used = SDL_PeepEventsLocked(event, 1, SDL_GETEVENT, SDL_ALLEVENTS);
+	if ( (used == 0) && (timeout != 0) ) {
+		if ( !SDL_EventThread && SDL_CanWaitInput() ) {
+			/* Sleep on the input sources, we pump them ourselves */
+			++SDL_EventWait.sleeping;
+			SDL_EventQ_Barrier();
+			if ( SDL_EventQ.published != published ) {
+				/* An event came in since we looked */
+				--SDL_EventWait.sleeping;
+				SDL_mutexV(SDL_EventQ.lock);
+				return(0);
+			}
+			SDL_mutexV(SDL_EventQ.lock);
+			SDL_WaitInput(timeout, 10);
+			return(0);
+		}
+		if ( ! SDL_EventThread ) {
+			/* We have to poll the input sources */
+			timeout = SDL_MinTimeout(timeout, 10);
+		}
+		if ( SDL_EventWait.cond ) {
+			++SDL_EventWait.waiting;
+			SDL_EventQ_Barrier();
+			if ( SDL_EventQ.published != published ) {
+				/* An event came in since we looked */
+			} else if ( timeout < 0 ) {
+				SDL_CondWait(SDL_EventWait.cond, SDL_EventQ.lock);
+			} else {
+				SDL_CondWaitTimeout(SDL_EventWait.cond,
+				                    SDL_EventQ.lock, timeout);
+			}
+			--SDL_EventWait.waiting;
+		} else {
+			SDL_mutexV(SDL_EventQ.lock);
+			SDL_Delay((timeout < 0) ? 10 : timeout);
+			return(0);
+		}
+	}
+	SDL_mutexV(SDL_EventQ.lock);
+	return(used);
+}
+
 int SDL_WaitEvent (SDL_Event *event)
 {
+	return SDL_WaitEventTimeout(event, -1);
+}
+
+int SDL_WaitEventTimeout (SDL_Event *event, int timeout)
+{
+	Uint32 start;
+	Sint32 left;
+
+	start = SDL_GetTicks();
+	left = (timeout < 0) ? -1 : timeout;
 	while ( 1 ) {
 		SDL_PumpEvents();
-		switch(SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_ALLEVENTS)) {
+		switch(SDL_WaitEventOnce(event, left)) {
 		    case -1: return 0;
 		    case 1: return 1;
-		    case 0: SDL_Delay(10);
+		    case 0: break;
+		}
+		if ( timeout >= 0 ) {
+			left = timeout - (Sint32)(SDL_GetTicks() - start);
+			if ( left <= 0 ) {
+				return 0;
+			}
 		}
 	}
 }
 
+void SDL_GetEventQueueStats(int *queued, int *highwater, Uint32 *dropped)
+{
+	if ( queued ) {
+		*queued = SDL_EventQ.count;
+	}
+	if ( highwater ) {
+		*highwater = SDL_EventQ.highwater;
+	}
+	if ( dropped ) {
+		*dropped = SDL_EventQ.dropped;
+	}
+}
+
 int SDL_PushEvent(SDL_Event *event)
 {
 	if ( SDL_PeepEvents(event, 1, SDL_ADDEVENT, 0) <= 0 )
@@ -419,6 +991,109 @@ int SDL_PushEvent(SDL_Event *event)
 	return 0;
 }
 
+int SDL_PushEvents(SDL_Event *events, int numevents)
+{
+	return SDL_PeepEvents(events, numevents, SDL_ADDEVENT, 0);
+}
+
+/* Fold 'event' into 'queued' if it's an update of the same thing */
+static SDL_bool SDL_MergeEvent(SDL_Event *queued, const SDL_Event *event)
+{
+	int xrel, yrel;
+
+	if ( queued->type != event->type ) {
+		return(SDL_FALSE);
+	}
+	switch (event->type) {
+	    case SDL_MOUSEMOTION:
+		if ( (queued->motion.which != event->motion.which) ||
+		     (queued->motion.state != event->motion.state) ) {
+			return(SDL_FALSE);
+		}
+		xrel = queued->motion.xrel + event->motion.xrel;
+		yrel = queued->motion.yrel + event->motion.yrel;
+		if ( (xrel != (Sint16)xrel) || (yrel != (Sint16)yrel) ) {
+			return(SDL_FALSE);
+		}
+		queued->motion.x = event->motion.x;
+		queued->motion.y = event->motion.y;
+		queued->motion.xrel = (Sint16)xrel;
+		queued->motion.yrel = (Sint16)yrel;
+		return(SDL_TRUE);
+	    case SDL_JOYAXISMOTION:
+		if ( (queued->jaxis.which != event->jaxis.which) ||
+		     (queued->jaxis.axis != event->jaxis.axis) ) {
+			return(SDL_FALSE);
+		}
+		queued->jaxis.value = event->jaxis.value;
+		return(SDL_TRUE);
+	    case SDL_JOYBALLMOTION:
+		if ( (queued->jball.which != event->jball.which) ||
+		     (queued->jball.ball != event->jball.ball) ) {
+			return(SDL_FALSE);
+		}
+		xrel = queued->jball.xrel + event->jball.xrel;
+		yrel = queued->jball.yrel + event->jball.yrel;
+		if ( (xrel != (Sint16)xrel) || (yrel != (Sint16)yrel) ) {
+			return(SDL_FALSE);
+		}
+		queued->jball.xrel = (Sint16)xrel;
+		queued->jball.yrel = (Sint16)yrel;
+		return(SDL_TRUE);
+	    default:
+		return(SDL_FALSE);
+	}
+}
+
+int SDL_PushCoalescedEvent(SDL_Event *event)
+{
+	SDL_EventSegment *seg;
+	SDL_EventPos pos;
+	SDL_Event *target;
+	SDL_Event merged;
+	int reserved;
+
+	if ( ! SDL_EventCoalesce || ! SDL_EventQ.active ) {
+		return SDL_PushEvent(event);
+	}
+	if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+		return SDL_PushEvent(event);
+	}
+
+	/* Only events at the end of the queue, after any other type, can be
+	   updated, so nothing else is reordered.  The consumer side is locked,
+	   so nobody is copying them out while we change them.
+	 */
+	target = NULL;
+	SDL_IndexEvents();
+	seg = SDL_EventQ.index.seg;
+	reserved = seg->reserved;
+	if ( ((SDL_EventQ.index.slot < SEGEVENTS) ?
+	      (SDL_EventQ.index.slot >= reserved) : (seg->next == NULL)) &&
+	     (SDL_EventQ.runtype == EVENTBUCKET(event->type)) ) {
+		for ( pos = SDL_EventQ.run; pos.seg;
+		      pos = pos.seg->link[pos.slot] ) {
+			merged = pos.seg->event[pos.slot];
+			if ( SDL_MergeEvent(&merged, event) ) {
+				target = &pos.seg->event[pos.slot];
+				break;
+			}
+		}
+	}
+
+	/* Producers don't take the lock, so one may have added an event
+	   since we looked.  Only update the queued event if the tail is
+	   still where it was, otherwise the new event has to go after it.
+	 */
+	if ( target && SDL_EventQ_CAS(&seg->reserved, reserved, reserved) ) {
+		*target = merged;
+		SDL_mutexV(SDL_EventQ.lock);
+		return 0;
+	}
+	SDL_mutexV(SDL_EventQ.lock);
+	return SDL_PushEvent(event);
+}
+
 void SDL_SetEventFilter (SDL_EventFilter filter)
 {
 	SDL_Event bitbucket;
@@ -73,9 +73,20 @@ extern void SDL_ResetMouse(void);
 /* Used by the activity event handler to remove keyboard focus */
 extern void SDL_ResetKeyboard(void);
 
+/* Queue a motion event, merging it into a matching one at the end of
+   the queue if SDL_EVENT_COALESCE is set.  Returns 0, or -1 on error.
+ */
+extern int SDL_PushCoalescedEvent(SDL_Event *event);
+
 /* Used by the event loop to queue pending keyboard repeat events */
 extern void SDL_CheckKeyRepeat(void);
 
+/* Milliseconds until SDL_CheckKeyRepeat() has work to do, or -1 if never */
+extern Sint32 SDL_NextKeyRepeat(void);
+
+/* Wake up a thread sleeping in the event loop, e.g. to run a new timer */
+extern void SDL_WakeEventWait(void);
+
 /* Used by the OS keyboard code to detect whether or not to do UNICODE */
 #ifndef DEFAULT_UNICODE_TRANSLATION
 #define DEFAULT_UNICODE_TRANSLATION 0	/* Default off because of overhead */
@@ -609,6 +609,22 @@ void SDL_CheckKeyRepeat(void)
 	}
 }
 
+Sint32 SDL_NextKeyRepeat(void)
+{
+	Uint32 elapsed, wait;
+
+	if ( ! SDL_KeyRepeat.timestamp ) {
+		return(-1);
+	}
+	elapsed = SDL_GetTicks() - SDL_KeyRepeat.timestamp;
+	if ( SDL_KeyRepeat.firsttime ) {
+		wait = (Uint32)SDL_KeyRepeat.delay + 1;
+	} else {
+		wait = (Uint32)SDL_KeyRepeat.interval + 1;
+	}
+	return((elapsed < wait) ? (Sint32)(wait - elapsed) : 0);
+}
+
 int SDL_EnableKeyRepeat(int delay, int interval)
 {
 	if ( (delay < 0) || (interval < 0) ) {
@@ -188,7 +188,7 @@ printf("Mouse event didn't change state - dropped!\n");
 		event.motion.yrel = Yrel;
 		if ( (SDL_EventOK == NULL) || (*SDL_EventOK)(&event) ) {
 			posted = 1;
-			SDL_PushEvent(&event);
+			SDL_PushCoalescedEvent(&event);
 		}
 	}
 	return(posted);
@@ -452,7 +452,7 @@ int SDL_PrivateJoystickAxis(SDL_Joystick *joystick, Uint8 axis, Sint16 value)
 		event.jaxis.value = value;
 		if ( (SDL_EventOK == NULL) || (*SDL_EventOK)(&event) ) {
 			posted = 1;
-			SDL_PushEvent(&event);
+			SDL_PushCoalescedEvent(&event);
 		}
 	}
 #endif /* !SDL_EVENTS_DISABLED */
@@ -515,7 +515,7 @@ int SDL_PrivateJoystickBall(SDL_Joystick *joystick, Uint8 ball,
 		event.jball.yrel = yrel;
 		if ( (SDL_EventOK == NULL) || (*SDL_EventOK)(&event) ) {
 			posted = 1;
-			SDL_PushEvent(&event);
+			SDL_PushCoalescedEvent(&event);
 		}
 	}
 #endif /* !SDL_EVENTS_DISABLED */
@@ -574,6 +574,25 @@ void SDL_JoystickUpdate(void)
 	}
 }
 
+int SDL_JoystickGetFDs(int *fds, int maxfds)
+{
+	int i, numfds;
+
+	numfds = 0;
+	for ( i=0; SDL_joysticks && SDL_joysticks[i]; ++i ) {
+#if SDL_JOYSTICK_LINUX
+		int fd = SDL_SYS_JoystickGetFD(SDL_joysticks[i]);
+		if ( (fd < 0) || (numfds == maxfds) ) {
+			return(-1);
+		}
+		fds[numfds++] = fd;
+#else
+		return(-1);
+#endif
+	}
+	return(numfds);
+}
+
 int SDL_JoystickEventState(int state)
 {
 #if SDL_EVENTS_DISABLED
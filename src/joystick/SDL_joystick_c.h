@@ -27,6 +27,11 @@
 /* The number of available joysticks on the system */
 extern Uint8 SDL_numjoysticks;
 
+/* Fill 'fds' with up to 'maxfds' file descriptors of the open joysticks,
+   and return how many, or -1 if the open joysticks can only be polled.
+ */
+extern int SDL_JoystickGetFDs(int *fds, int maxfds);
+
 /* Internal event queueing functions */
 extern int SDL_PrivateJoystickAxis(SDL_Joystick *joystick,
                                    Uint8 axis, Sint16 value);
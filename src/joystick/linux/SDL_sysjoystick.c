@@ -1183,6 +1183,11 @@ void SDL_SYS_JoystickUpdate(SDL_Joystick *joystick)
 	}
 }
 
+int SDL_SYS_JoystickGetFD(SDL_Joystick *joystick)
+{
+	return(joystick->hwdata ? joystick->hwdata->fd : -1);
+}
+
 /* Function to close a joystick after use */
 void SDL_SYS_JoystickClose(SDL_Joystick *joystick)
 {
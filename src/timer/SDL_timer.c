@@ -25,6 +25,7 @@
 #include "SDL_timer_c.h"
 #include "SDL_mutex.h"
 #include "SDL_systimer.h"
+#include "../events/SDL_events_c.h"
 
 /* #define DEBUG_TIMERS */
 
@@ -43,12 +44,60 @@ struct _SDL_TimerID {
 	SDL_NewTimerCallback cb;
 	void *param;
 	Uint32 last_alarm;
-	struct _SDL_TimerID *next;
+	int heap_index;		/* position in SDL_timer_heap, -1 if running */
+	int slot;		/* position in SDL_timer_slots */
 };
 
-static SDL_TimerID SDL_timers = NULL;
+/* Pending timers are kept in a binary min-heap ordered by their next
+   alarm time, so the timer thread only ever looks at the first one and
+   can sleep on SDL_timer_cond until it is due.
+ */
+static SDL_TimerID *SDL_timer_heap = NULL;
+static int SDL_timer_count = 0;
+static int SDL_timer_maxcount = 0;
+static SDL_TimerID SDL_timer_current = NULL;	/* callback in progress */
+static SDL_bool SDL_timer_current_removed = SDL_FALSE;
 static SDL_mutex *SDL_timer_mutex;
-static volatile SDL_bool list_changed = SDL_FALSE;
+static SDL_cond *SDL_timer_cond;
+
+/* Applications don't get the timer itself as its id, but a handle: its
+   slot in SDL_timer_slots plus one, tagged in the upper 16 bits with the
+   slot's generation, which changes whenever the timer in it is freed.
+   That way a stale id is caught in constant time without looking at
+   freed memory.
+ */
+typedef struct {
+	SDL_TimerID timer;	/* NULL if the slot is free */
+	Uint16 generation;
+	int next_free;
+} SDL_TimerSlot;
+
+#define SDL_MAX_TIMER_SLOTS	0xFFFF
+
+static SDL_TimerSlot *SDL_timer_slots = NULL;
+static int SDL_timer_numslots = 0;
+static int SDL_timer_freeslot = -1;
+static SDL_bool SDL_timer_wake = SDL_FALSE;
+
+#if !SDL_TIMER_UNIX
+/* Platforms without a better clock fall back to millisecond ticks */
+#if !SDL_TIMER_WIN32
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return SDL_GetTicks();
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return 1000;
+}
+#endif /* !SDL_TIMER_WIN32 */
+
+void SDL_DelayNS(Uint64 ns)
+{
+	SDL_Delay((Uint32)((ns + 999999) / 1000000));
+}
+#endif /* !SDL_TIMER_UNIX */
 
 /* Set whether or not the timer should use a thread.
    This should not be called while the timer subsystem is running.
@@ -75,11 +124,17 @@ int SDL_TimerInit(void)
 	if ( SDL_timer_started ) {
 		SDL_TimerQuit();
 	}
+	/* The timer thread may start waiting as soon as it is created */
+	SDL_timer_mutex = SDL_CreateMutex();
+	SDL_timer_cond = SDL_CreateCond();
 	if ( ! SDL_timer_threaded ) {
 		retval = SDL_SYS_TimerInit();
 	}
-	if ( SDL_timer_threaded ) {
-		SDL_timer_mutex = SDL_CreateMutex();
+	if ( ! SDL_timer_threaded ) {
+		SDL_DestroyCond(SDL_timer_cond);
+		SDL_timer_cond = NULL;
+		SDL_DestroyMutex(SDL_timer_mutex);
+		SDL_timer_mutex = NULL;
 	}
 	if ( retval == 0 ) {
 		SDL_timer_started = 1;
@@ -94,72 +149,287 @@ void SDL_TimerQuit(void)
 		SDL_SYS_TimerQuit();
 	}
 	if ( SDL_timer_threaded ) {
+		SDL_DestroyCond(SDL_timer_cond);
+		SDL_timer_cond = NULL;
 		SDL_DestroyMutex(SDL_timer_mutex);
 		SDL_timer_mutex = NULL;
 	}
+	if ( SDL_timer_heap ) {
+		SDL_free(SDL_timer_heap);
+		SDL_timer_heap = NULL;
+		SDL_timer_maxcount = 0;
+	}
+	if ( SDL_timer_slots ) {
+		SDL_free(SDL_timer_slots);
+		SDL_timer_slots = NULL;
+		SDL_timer_numslots = 0;
+		SDL_timer_freeslot = -1;
+	}
 	SDL_timer_started = 0;
 	SDL_timer_threaded = 0;
 }
 
-void SDL_ThreadedTimerCheck(void)
+/* The heap and slot operations below are called with SDL_timer_mutex held */
+
+static int SDL_TimerSlotAlloc(SDL_TimerID t)
+{
+	int slot;
+
+	if ( SDL_timer_freeslot < 0 ) {
+		int i, numslots;
+		SDL_TimerSlot *slots;
+
+		numslots = SDL_timer_numslots ? SDL_timer_numslots * 2 : 16;
+		if ( numslots > SDL_MAX_TIMER_SLOTS ) {
+			numslots = SDL_MAX_TIMER_SLOTS;
+		}
+		if ( numslots == SDL_timer_numslots ) {
+			SDL_SetError("Too many timers");
+			return(-1);
+		}
+		slots = (SDL_TimerSlot *)SDL_realloc(SDL_timer_slots,
+		                                    numslots * sizeof(*slots));
+		if ( ! slots ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		for ( i = SDL_timer_numslots; i < numslots; ++i ) {
+			slots[i].timer = NULL;
+			slots[i].generation = 0;
+			slots[i].next_free = (i + 1 < numslots) ? i + 1 : -1;
+		}
+		SDL_timer_freeslot = SDL_timer_numslots;
+		SDL_timer_slots = slots;
+		SDL_timer_numslots = numslots;
+	}
+	slot = SDL_timer_freeslot;
+	SDL_timer_freeslot = SDL_timer_slots[slot].next_free;
+	SDL_timer_slots[slot].timer = t;
+	t->slot = slot;
+	return(0);
+}
+
+static void SDL_FreeTimer(SDL_TimerID t)
+{
+	SDL_TimerSlot *slot = &SDL_timer_slots[t->slot];
+
+	slot->timer = NULL;
+	++slot->generation;
+	slot->next_free = SDL_timer_freeslot;
+	SDL_timer_freeslot = t->slot;
+	SDL_free(t);
+}
+
+static SDL_TimerID SDL_TimerHandle(SDL_TimerID t)
+{
+	Uint32 handle;
+
+	handle = ((Uint32)SDL_timer_slots[t->slot].generation << 16) |
+	         (Uint32)(t->slot + 1);
+	return (SDL_TimerID)(size_t)handle;
+}
+
+static SDL_TimerID SDL_TimerFromHandle(SDL_TimerID id)
+{
+	Uint32 handle = (Uint32)(size_t)id;
+	int slot = (int)(handle & 0xFFFF) - 1;
+
+	if ( (slot < 0) || (slot >= SDL_timer_numslots) ||
+	     (SDL_timer_slots[slot].generation != (handle >> 16)) ) {
+		return NULL;
+	}
+	return SDL_timer_slots[slot].timer;
+}
+
+/* Round an interval to the timer resolution.  It's at least one tick,
+   since a timer due again at once would keep the timer thread busy.
+ */
+static Uint32 SDL_TimerInterval(Uint32 ms)
+{
+	ms = ROUND_RESOLUTION(ms);
+	if ( ms == 0 ) {
+		ms = TIMER_RESOLUTION;
+	}
+	return ms;
+}
+
+static SDL_bool SDL_TimerBefore(SDL_TimerID a, SDL_TimerID b)
+{
+	return ((Sint32)((a->last_alarm + a->interval) -
+	                 (b->last_alarm + b->interval)) < 0) ? SDL_TRUE : SDL_FALSE;
+}
+
+static void SDL_TimerHeapSet(int index, SDL_TimerID t)
+{
+	SDL_timer_heap[index] = t;
+	t->heap_index = index;
+}
+
+static void SDL_TimerSiftUp(int index)
+{
+	SDL_TimerID t = SDL_timer_heap[index];
+
+	while ( index > 0 ) {
+		int parent = (index - 1) / 2;
+		if ( ! SDL_TimerBefore(t, SDL_timer_heap[parent]) ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timer_heap[parent]);
+		index = parent;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+static void SDL_TimerSiftDown(int index)
+{
+	SDL_TimerID t = SDL_timer_heap[index];
+
+	for ( ; ; ) {
+		int child = index * 2 + 1;
+		if ( child >= SDL_timer_count ) {
+			break;
+		}
+		if ( (child + 1 < SDL_timer_count) &&
+		     SDL_TimerBefore(SDL_timer_heap[child+1], SDL_timer_heap[child]) ) {
+			++child;
+		}
+		if ( ! SDL_TimerBefore(SDL_timer_heap[child], t) ) {
+			break;
+		}
+		SDL_TimerHeapSet(index, SDL_timer_heap[child]);
+		index = child;
+	}
+	SDL_TimerHeapSet(index, t);
+}
+
+static int SDL_TimerHeapInsert(SDL_TimerID t)
+{
+	if ( SDL_timer_count == SDL_timer_maxcount ) {
+		int maxcount = SDL_timer_maxcount ? SDL_timer_maxcount * 2 : 16;
+		SDL_TimerID *heap = (SDL_TimerID *)SDL_realloc(SDL_timer_heap,
+		                                    maxcount * sizeof(*heap));
+		if ( ! heap ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		SDL_timer_heap = heap;
+		SDL_timer_maxcount = maxcount;
+	}
+	SDL_TimerHeapSet(SDL_timer_count++, t);
+	SDL_TimerSiftUp(t->heap_index);
+	return(0);
+}
+
+static void SDL_TimerHeapRemove(SDL_TimerID t)
+{
+	int index = t->heap_index;
+
+	t->heap_index = -1;
+	if ( index != --SDL_timer_count ) {
+		SDL_TimerHeapSet(index, SDL_timer_heap[SDL_timer_count]);
+		SDL_TimerSiftUp(index);
+		SDL_TimerSiftDown(SDL_timer_heap[index]->heap_index);
+	}
+}
+
+/* Run every timer that is due, with SDL_timer_mutex held */
+static void SDL_RunTimers(void)
 {
 	Uint32 now, ms;
-	SDL_TimerID t, prev, next;
-	SDL_bool removed;
+	SDL_TimerID t;
 
-	SDL_mutexP(SDL_timer_mutex);
-	list_changed = SDL_FALSE;
-	now = SDL_GetTicks();
-	for ( prev = NULL, t = SDL_timers; t; t = next ) {
-		removed = SDL_FALSE;
-		ms = t->interval - SDL_TIMESLICE;
-		next = t->next;
-		if ( (int)(now - t->last_alarm) > (int)ms ) {
-			struct _SDL_TimerID timer;
-
-			if ( (now - t->last_alarm) < t->interval ) {
-				t->last_alarm += t->interval;
-			} else {
-				t->last_alarm = now;
-			}
+	while ( SDL_timer_count > 0 ) {
+		now = SDL_GetTicks();
+		t = SDL_timer_heap[0];
+		if ( (Sint32)(now - (t->last_alarm + t->interval)) < 0 ) {
+			break;
+		}
+		if ( (now - t->last_alarm) < 2*t->interval ) {
+			t->last_alarm += t->interval;
+		} else {
+			t->last_alarm = now;
+		}
+		SDL_TimerHeapRemove(t);
 #ifdef DEBUG_TIMERS
-			printf("Executing timer %p (thread = %d)\n",
-				t, SDL_ThreadID());
+		printf("Executing timer %p (thread = %d)\n",
+			t, SDL_ThreadID());
 #endif
-			timer = *t;
-			SDL_mutexV(SDL_timer_mutex);
-			ms = timer.cb(timer.interval, timer.param);
-			SDL_mutexP(SDL_timer_mutex);
-			if ( list_changed ) {
-				/* Abort, list of timers modified */
-				/* FIXME: what if ms was changed? */
-				break;
-			}
-			if ( ms != t->interval ) {
-				if ( ms ) {
-					t->interval = ROUND_RESOLUTION(ms);
-				} else {
-					/* Remove timer from the list */
+		/* The callback may add or remove timers, including itself */
+		SDL_timer_current = t;
+		SDL_timer_current_removed = SDL_FALSE;
+		SDL_mutexV(SDL_timer_mutex);
+		ms = t->cb(t->interval, t->param);
+		SDL_mutexP(SDL_timer_mutex);
+		SDL_timer_current = NULL;
+
+		if ( SDL_timer_current_removed ) {
+			SDL_FreeTimer(t);
+		} else if ( ! ms ) {
 #ifdef DEBUG_TIMERS
-					printf("SDL: Removing timer %p\n", t);
+			printf("SDL: Removing timer %p\n", t);
 #endif
-					if ( prev ) {
-						prev->next = next;
-					} else {
-						SDL_timers = next;
-					}
-					SDL_free(t);
-					--SDL_timer_running;
-					removed = SDL_TRUE;
-				}
+			SDL_FreeTimer(t);
+			--SDL_timer_running;
+		} else {
+			t->interval = SDL_TimerInterval(ms);
+			if ( SDL_TimerHeapInsert(t) < 0 ) {
+				SDL_FreeTimer(t);
+				--SDL_timer_running;
+			}
+		}
+	}
+}
+
+void SDL_ThreadedTimerCheck(void)
+{
+	SDL_mutexP(SDL_timer_mutex);
+	SDL_RunTimers();
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+void SDL_ThreadedTimerWait(void)
+{
+	SDL_mutexP(SDL_timer_mutex);
+	SDL_RunTimers();
+	if ( ! SDL_timer_wake ) {
+		if ( SDL_timer_count == 0 ) {
+			SDL_CondWait(SDL_timer_cond, SDL_timer_mutex);
+		} else {
+			SDL_TimerID t = SDL_timer_heap[0];
+			Sint32 wait = (Sint32)((t->last_alarm + t->interval) -
+			                       SDL_GetTicks());
+			if ( wait > 0 ) {
+				SDL_CondWaitTimeout(SDL_timer_cond,
+				                    SDL_timer_mutex, wait);
 			}
 		}
-		/* Don't update prev if the timer has disappeared */
-		if ( ! removed ) {
-			prev = t;
+	}
+	SDL_timer_wake = SDL_FALSE;
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+Sint32 SDL_ThreadedTimerTimeout(void)
+{
+	Sint32 wait = -1;
+
+	SDL_mutexP(SDL_timer_mutex);
+	if ( SDL_timer_count > 0 ) {
+		SDL_TimerID t = SDL_timer_heap[0];
+		wait = (Sint32)((t->last_alarm + t->interval) - SDL_GetTicks());
+		if ( wait < 0 ) {
+			wait = 0;
 		}
 	}
 	SDL_mutexV(SDL_timer_mutex);
+	return(wait);
+}
+
+void SDL_ThreadedTimerWake(void)
+{
+	SDL_mutexP(SDL_timer_mutex);
+	SDL_timer_wake = SDL_TRUE;
+	SDL_CondSignal(SDL_timer_cond);
+	SDL_mutexV(SDL_timer_mutex);
 }
 
 static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback callback, void *param)
@@ -167,14 +437,25 @@ static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback ca
 	SDL_TimerID t;
 	t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
 	if ( t ) {
-		t->interval = ROUND_RESOLUTION(interval);
+		t->interval = SDL_TimerInterval(interval);
 		t->cb = callback;
 		t->param = param;
 		t->last_alarm = SDL_GetTicks();
-		t->next = SDL_timers;
-		SDL_timers = t;
+		if ( SDL_TimerSlotAlloc(t) < 0 ) {
+			SDL_free(t);
+			return NULL;
+		}
+		if ( SDL_TimerHeapInsert(t) < 0 ) {
+			SDL_FreeTimer(t);
+			return NULL;
+		}
 		++SDL_timer_running;
-		list_changed = SDL_TRUE;
+		/* Let the timer thread recompute its deadline */
+		if ( SDL_timer_threaded == 2 ) {
+			SDL_WakeEventWait();
+		} else {
+			SDL_CondSignal(SDL_timer_cond);
+		}
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_AddTimer(%d) = %08x num_timers = %d\n", interval, (Uint32)t, SDL_timer_running);
@@ -199,31 +480,33 @@ SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *p
 	}
 	SDL_mutexP(SDL_timer_mutex);
 	t = SDL_AddTimerInternal(interval, callback, param);
+	if ( t ) {
+		t = SDL_TimerHandle(t);
+	}
 	SDL_mutexV(SDL_timer_mutex);
 	return t;
 }
 
 SDL_bool SDL_RemoveTimer(SDL_TimerID id)
 {
-	SDL_TimerID t, prev = NULL;
+	SDL_TimerID t;
 	SDL_bool removed;
 
 	removed = SDL_FALSE;
 	SDL_mutexP(SDL_timer_mutex);
-	/* Look for id in the linked list of timers */
-	for (t = SDL_timers; t; prev=t, t = t->next ) {
-		if ( t == id ) {
-			if(prev) {
-				prev->next = t->next;
-			} else {
-				SDL_timers = t->next;
-			}
-			SDL_free(t);
+	t = SDL_TimerFromHandle(id);
+	if ( t && (t == SDL_timer_current) ) {
+		/* Its callback is running, it will be freed afterwards */
+		if ( ! SDL_timer_current_removed ) {
+			SDL_timer_current_removed = SDL_TRUE;
 			--SDL_timer_running;
 			removed = SDL_TRUE;
-			list_changed = SDL_TRUE;
-			break;
 		}
+	} else if ( t ) {
+		SDL_TimerHeapRemove(t);
+		SDL_FreeTimer(t);
+		--SDL_timer_running;
+		removed = SDL_TRUE;
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_RemoveTimer(%08x) = %d num_timers = %d thread = %d\n", (Uint32)id, removed, SDL_timer_running, SDL_ThreadID());
@@ -253,13 +536,14 @@ int SDL_SetTimer(Uint32 ms, SDL_TimerCallback callback)
 	}
 	if ( SDL_timer_running ) {	/* Stop any currently running timer */
 		if ( SDL_timer_threaded ) {
-			while ( SDL_timers ) {
-				SDL_TimerID freeme = SDL_timers;
-				SDL_timers = SDL_timers->next;
-				SDL_free(freeme);
+			while ( SDL_timer_count > 0 ) {
+				SDL_TimerID freeme = SDL_timer_heap[--SDL_timer_count];
+				SDL_FreeTimer(freeme);
+			}
+			if ( SDL_timer_current ) {
+				SDL_timer_current_removed = SDL_TRUE;
 			}
 			SDL_timer_running = 0;
-			list_changed = SDL_TRUE;
 		} else {
 			SDL_SYS_StopTimer();
 			SDL_timer_running = 0;
@@ -44,3 +44,13 @@ extern void SDL_TimerQuit(void);
 
 /* This function is called from the SDL event thread if it is available */
 extern void SDL_ThreadedTimerCheck(void);
+
+/* A dedicated timer thread calls this instead: it runs the timers that
+   are due and then sleeps until the next one is, a timer is added, or
+   SDL_ThreadedTimerWake() is called.
+ */
+extern void SDL_ThreadedTimerWait(void);
+extern void SDL_ThreadedTimerWake(void);
+
+/* Milliseconds until the next timer is due, or -1 if there are none */
+extern Sint32 SDL_ThreadedTimerTimeout(void);
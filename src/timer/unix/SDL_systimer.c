@@ -85,9 +85,74 @@ Uint32 SDL_GetTicks (void)
 #endif
 }
 
+Uint64 SDL_GetPerformanceCounter (void)
+{
+#if HAVE_CLOCK_GETTIME
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return((Uint64)now.tv_sec*1000000000 + now.tv_nsec);
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return((Uint64)now.tv_sec*1000000 + now.tv_usec);
+#endif
+}
+
+Uint64 SDL_GetPerformanceFrequency (void)
+{
+#if HAVE_CLOCK_GETTIME
+	return(1000000000);
+#else
+	return(1000000);
+#endif
+}
+
+#if HAVE_CLOCK_NANOSLEEP && !SDL_THREAD_PTH
+/* Sleep until an absolute deadline, so interruptions don't add drift */
+static void SDL_DelayUntil (const struct timespec *deadline)
+{
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+	                        deadline, NULL) == EINTR ) {
+		/* Keep waiting for the same deadline */
+	}
+}
+#endif
+
+void SDL_DelayNS (Uint64 ns)
+{
+#if HAVE_CLOCK_NANOSLEEP && !SDL_THREAD_PTH
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += (time_t)(ns / 1000000000);
+	deadline.tv_nsec += (long)(ns % 1000000000);
+	if ( deadline.tv_nsec >= 1000000000 ) {
+		deadline.tv_nsec -= 1000000000;
+		++deadline.tv_sec;
+	}
+	SDL_DelayUntil(&deadline);
+#elif HAVE_NANOSLEEP && !SDL_THREAD_PTH
+	struct timespec elapsed, tv;
+	int was_error;
+
+	elapsed.tv_sec = (time_t)(ns / 1000000000);
+	elapsed.tv_nsec = (long)(ns % 1000000000);
+	do {
+		errno = 0;
+		tv.tv_sec = elapsed.tv_sec;
+		tv.tv_nsec = elapsed.tv_nsec;
+		was_error = nanosleep(&tv, &elapsed);
+	} while ( was_error && (errno == EINTR) );
+#else
+	SDL_Delay((Uint32)((ns + 999999) / 1000000));
+#endif
+}
+
 void SDL_Delay (Uint32 ms)
 {
-#if SDL_THREAD_PTH
+#if HAVE_CLOCK_NANOSLEEP && !SDL_THREAD_PTH
+	SDL_DelayNS((Uint64)ms * 1000000);
+#elif SDL_THREAD_PTH
 	pth_time_t tv;
 	tv.tv_sec  =  ms/1000;
 	tv.tv_usec = (ms%1000)*1000;
@@ -197,10 +262,7 @@ static SDL_Thread *timer = NULL;
 static int RunTimer(void *unused)
 {
 	while ( timer_alive ) {
-		if ( SDL_timer_running ) {
-			SDL_ThreadedTimerCheck();
-		}
-		SDL_Delay(1);
+		SDL_ThreadedTimerWait();
 	}
 	return(0);
 }
@@ -209,16 +271,20 @@ static int RunTimer(void *unused)
 int SDL_SYS_TimerInit(void)
 {
 	timer_alive = 1;
+	if ( SDL_SetTimerThreaded(1) < 0 ) {
+		return(-1);
+	}
 	timer = SDL_CreateThread(RunTimer, NULL);
 	if ( timer == NULL )
 		return(-1);
-	return(SDL_SetTimerThreaded(1));
+	return(0);
 }
 
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
 	if ( timer ) {
+		SDL_ThreadedTimerWake();
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
 	}
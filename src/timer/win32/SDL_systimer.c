@@ -109,6 +109,26 @@ void SDL_Delay(Uint32 ms)
 	Sleep(ms);
 }
 
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	LARGE_INTEGER counter;
+
+	if ( !QueryPerformanceCounter(&counter) ) {
+		return SDL_GetTicks();
+	}
+	return counter.QuadPart;
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	LARGE_INTEGER frequency;
+
+	if ( !QueryPerformanceFrequency(&frequency) ) {
+		return 1000;
+	}
+	return frequency.QuadPart;
+}
+
 /* Data to handle a single periodic alarm */
 static UINT timerID = 0;
 
@@ -98,7 +98,11 @@
 
 #ifdef MMX_ASMBLIT
 #include "mmx.h"
+#endif
 #include "SDL_cpuinfo.h"
+
+#if SDL_X86_SIMD_BLITTERS
+#include <emmintrin.h>
 #endif
 
 #ifndef MAX
@@ -848,7 +852,7 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 
 	/* Lock the destination if necessary */
 	if ( SDL_MUSTLOCK(dst) ) {
-		if ( SDL_LockSurface(dst) < 0 ) {
+		if ( SDL_LockSurfaceRect(dst, dstrect) < 0 ) {
 			return(-1);
 		}
 	}
@@ -994,6 +998,66 @@ done:
 	dst = (Uint16)(d | d >> 16);			\
     } while(0)
 
+/* blend a run of n translucent pixels, one pixel at a time */
+#define BLIT_TRANSL_RUN(do_blend, dst, src, n)		\
+    do {						\
+	unsigned i;					\
+	for(i = 0; i < (unsigned)(n); i++)		\
+	    do_blend((src)[i], (dst)[i]);		\
+    } while(0)
+
+#define BLIT_TRANSL_888_RUN(dst, src, n)		\
+    BLIT_TRANSL_RUN(BLIT_TRANSL_888, dst, src, n)
+#define BLIT_TRANSL_565_RUN(dst, src, n)		\
+    BLIT_TRANSL_RUN(BLIT_TRANSL_565, dst, src, n)
+#define BLIT_TRANSL_555_RUN(dst, src, n)		\
+    BLIT_TRANSL_RUN(BLIT_TRANSL_555, dst, src, n)
+
+#if SDL_X86_SIMD_BLITTERS
+/*
+ * BLIT_TRANSL_888 on four pixels at a time. SSE2 has no 32-bit multiply,
+ * but since alpha fits in 16 bits the 32-bit product can be put together
+ * from the low and high halves of a 16-bit multiply, which keeps the
+ * result identical to the scalar code, borrows between components and all.
+ */
+SDL_TARGET_SSE2
+static void BlitTransl888SSE2(Uint32 *dst, const Uint32 *src, unsigned n)
+{
+    const __m128i rbmask = _mm_set1_epi32(0xff00ff);
+    const __m128i gmask = _mm_set1_epi32(0xff00);
+
+    for(; n >= 4; n -= 4) {
+	__m128i s = _mm_loadu_si128((const __m128i *)src);
+	__m128i d = _mm_loadu_si128((const __m128i *)dst);
+	__m128i a = _mm_srli_epi32(s, 24);
+	__m128i s1, d1, v;
+	a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+
+	s1 = _mm_and_si128(s, rbmask);
+	d1 = _mm_and_si128(d, rbmask);
+	v = _mm_sub_epi32(s1, d1);
+	v = _mm_add_epi32(_mm_mullo_epi16(v, a),
+			  _mm_slli_epi32(_mm_mulhi_epu16(v, a), 16));
+	d1 = _mm_and_si128(_mm_add_epi32(d1, _mm_srli_epi32(v, 8)), rbmask);
+
+	s = _mm_and_si128(s, gmask);
+	d = _mm_and_si128(d, gmask);
+	v = _mm_sub_epi32(s, d);
+	v = _mm_add_epi32(_mm_mullo_epi16(v, a),
+			  _mm_slli_epi32(_mm_mulhi_epu16(v, a), 16));
+	d = _mm_and_si128(_mm_add_epi32(d, _mm_srli_epi32(v, 8)), gmask);
+
+	_mm_storeu_si128((__m128i *)dst, _mm_or_si128(d1, d));
+	src += 4;
+	dst += 4;
+    }
+    BLIT_TRANSL_888_RUN(dst, src, n);
+}
+
+#define BLIT_TRANSL_888_SSE2_RUN(dst, src, n)	\
+    BlitTransl888SSE2(dst, src, n)
+#endif /* SDL_X86_SIMD_BLITTERS */
+
 /* used to save the destination format in the encoding. Designed to be
    macro-compatible with SDL_PixelFormat but without the unneeded fields */
 typedef struct {
@@ -1019,7 +1083,7 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
     /*
      * clipped blitter: Ptype is the destination pixel type,
      * Ctype the translucent count type, and do_blend the macro
-     * to blend one pixel.
+     * to blend a run of pixels.
      */
 #define RLEALPHACLIPBLIT(Ptype, Ctype, do_blend)			  \
     do {								  \
@@ -1077,9 +1141,7 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 		    if(crun > 0) {					  \
 			Ptype *dst = (Ptype *)dstbuf + cofs;		  \
 			Uint32 *src = (Uint32 *)srcbuf + (cofs - ofs);	  \
-			int i;						  \
-			for(i = 0; i < crun; i++)			  \
-			    do_blend(src[i], dst[i]);			  \
+			do_blend(dst, src, crun);			  \
 		    }							  \
 		    srcbuf += run * 4;					  \
 		    ofs += run;						  \
@@ -1093,12 +1155,18 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
     case 2:
 	if(df->Gmask == 0x07e0 || df->Rmask == 0x07e0
 	   || df->Bmask == 0x07e0)
-	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565);
+	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565_RUN);
 	else
-	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555);
+	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555_RUN);
 	break;
     case 4:
-	RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888);
+#if SDL_X86_SIMD_BLITTERS
+	if(SDL_HasSSE2()) {
+	    RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888_SSE2_RUN);
+	    break;
+	}
+#endif
+	RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888_RUN);
 	break;
     }
 }
@@ -1114,7 +1182,7 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 
     /* Lock the destination if necessary */
     if ( SDL_MUSTLOCK(dst) ) {
-	if ( SDL_LockSurface(dst) < 0 ) {
+	if ( SDL_LockSurfaceRect(dst, dstrect) < 0 ) {
 	    return -1;
 	}
     }
@@ -1189,7 +1257,7 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	/*
 	 * non-clipped blitter. Ptype is the destination pixel type,
 	 * Ctype the translucent count type, and do_blend the
-	 * macro to blend one pixel.
+	 * macro to blend a run of pixels.
 	 */
 #define RLEALPHABLIT(Ptype, Ctype, do_blend)				 \
 	do {								 \
@@ -1221,14 +1289,9 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		    run = ((Uint16 *)srcbuf)[1];			 \
 		    srcbuf += 4;					 \
 		    if(run) {						 \
-			Ptype *dst = (Ptype *)dstbuf + ofs;		 \
-			unsigned i;					 \
-			for(i = 0; i < run; i++) {			 \
-			    Uint32 src = *(Uint32 *)srcbuf;		 \
-			    do_blend(src, *dst);			 \
-			    srcbuf += 4;				 \
-			    dst++;					 \
-			}						 \
+			do_blend((Ptype *)dstbuf + ofs,			 \
+				 (Uint32 *)srcbuf, run);		 \
+			srcbuf += run * 4;				 \
 			ofs += run;					 \
 		    }							 \
 		} while(ofs < w);					 \
@@ -1240,12 +1303,18 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	case 2:
 	    if(df->Gmask == 0x07e0 || df->Rmask == 0x07e0
 	       || df->Bmask == 0x07e0)
-		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565);
+		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565_RUN);
 	    else
-		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555);
+		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555_RUN);
 	    break;
 	case 4:
-	    RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888);
+#if SDL_X86_SIMD_BLITTERS
+	    if(SDL_HasSSE2()) {
+		RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888_SSE2_RUN);
+		break;
+	    }
+#endif
+	    RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888_RUN);
 	    break;
 	}
     }
@@ -1396,6 +1465,88 @@ static int uncopy_32(Uint32 *dst, void *src, int n,
 #define ISTRANSL(pixel, fmt)	\
     ((unsigned)((((pixel) & fmt->Amask) >> fmt->Ashift) - 1U) < 254U)
 
+/*
+ * Surfaces that are locked and written keep their pixels along with the
+ * encoding, and the encoders record where each row starts. On unlock only
+ * the rows written under the lock are encoded again; the others are copied
+ * from the previous encoding. Rows always start on a 32-bit boundary in
+ * the pixel-alpha format, so moving them keeps the translucent parts aligned.
+ */
+#define RLE_ROW_DIRTY	1	/* written since the row was encoded */
+#define RLE_ROW_BLANK	2	/* no visible pixels */
+
+/* allocate the row offsets of an encoding, followed by the row flags */
+static int *AllocRLERows(int h)
+{
+    int *rows = (int *)SDL_malloc((h + 1) * sizeof(int) + h);
+    if(!rows)
+	SDL_OutOfMemory();
+    return rows;
+}
+
+/* copy row y from the previous encoding if it hasn't been written since,
+   and return its size, or 0 if it has to be encoded again */
+static int ReuseRLERow(struct private_swaccel *sw, int y, Uint8 *dst)
+{
+    int len;
+    if(!sw->aux_data || !sw->rle_rows || (sw->rle_flags[y] & RLE_ROW_DIRTY))
+	return 0;
+    len = sw->rle_rows[y + 1] - sw->rle_rows[y];
+    SDL_memcpy(dst, (Uint8 *)sw->aux_data + sw->rle_rows[y], len);
+    return len;
+}
+
+static void FreeRLEData(struct private_swaccel *sw)
+{
+    if(sw->aux_data) {
+	SDL_free(sw->aux_data);
+	sw->aux_data = NULL;
+    }
+    if(sw->rle_rows) {
+	SDL_free(sw->rle_rows);
+	sw->rle_rows = NULL;
+	sw->rle_flags = NULL;
+    }
+}
+
+/*
+ * Install a finished encoding of 'size' bytes, replacing the previous one.
+ * Rows after 'last' are trailing blank lines that were left out; they get
+ * no bytes in the index so that they are encoded again when copied.
+ */
+static void SetRLEData(SDL_Surface *surface, Uint8 *rlebuf, int size,
+		       int last, int *rows)
+{
+    struct private_swaccel *sw = surface->map->sw_data;
+    int y;
+
+    for(y = 0; y <= surface->h; y++)
+	if(rows[y] > last)
+	    rows[y] = last;
+
+    /* Now that we have it encoded, release the original pixels,
+       unless the surface gets locked and written */
+    if(!sw->rle_keep
+       && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
+       && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
+	SDL_free( surface->pixels );
+	surface->pixels = NULL;
+    }
+
+    FreeRLEData(sw);
+
+    /* realloc the buffer to release unused memory */
+    {
+	/* If realloc returns NULL, the original block is left intact */
+	Uint8 *p = SDL_realloc(rlebuf, size);
+	if(!p)
+	    p = rlebuf;
+	sw->aux_data = p;
+    }
+    sw->rle_rows = rows;
+    sw->rle_flags = (Uint8 *)(rows + surface->h + 1);
+}
+
 /* convert surface to be quickly alpha-blittable onto dest, if possible */
 static int RLEAlphaSurface(SDL_Surface *surface)
 {
@@ -1406,6 +1557,10 @@ static int RLEAlphaSurface(SDL_Surface *surface)
     int max_transl_run = 65535;
     unsigned masksum;
     Uint8 *rlebuf, *dst;
+    Uint8 *lastline;	/* end of last non-blank line */
+    int *rows;
+    Uint8 *flags;
+    struct private_swaccel *sw = surface->map->sw_data;
     int (*copy_opaque)(void *, Uint32 *, int,
 		       SDL_PixelFormat *, SDL_PixelFormat *);
     int (*copy_transl)(void *, Uint32 *, int,
@@ -1470,6 +1625,12 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	SDL_OutOfMemory();
 	return -1;
     }
+    rows = AllocRLERows(surface->h);
+    if(!rows) {
+	SDL_free(rlebuf);
+	return -1;
+    }
+    flags = (Uint8 *)(rows + surface->h + 1);
     {
 	/* save the destination format so we can undo the encoding later */
 	RLEDestFormat *r = (RLEDestFormat *)rlebuf;
@@ -1487,6 +1648,7 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	r->Amask = df->Amask;
     }
     dst = rlebuf + sizeof(RLEDestFormat);
+    lastline = dst;
 
     /* Do the actual encoding */
     {
@@ -1494,7 +1656,6 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	int h = surface->h, w = surface->w;
 	SDL_PixelFormat *sf = surface->format;
 	Uint32 *src = (Uint32 *)surface->pixels;
-	Uint8 *lastline = dst;	/* end of last non-blank line */
 
 	/* opaque counts are 8 or 16 bits, depending on target depth */
 #define ADD_OPAQUE_COUNTS(n, m)			\
@@ -1515,6 +1676,19 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	for(y = 0; y < h; y++) {
 	    int runstart, skipstart;
 	    int blankline = 0;
+	    int copied;
+
+	    rows[y] = dst - rlebuf;
+	    copied = ReuseRLERow(sw, y, dst);
+	    if(copied) {
+		dst += copied;
+		flags[y] = sw->rle_flags[y];
+		if(!(flags[y] & RLE_ROW_BLANK))
+		    lastline = dst;
+		src += surface->pitch >> 2;
+		continue;
+	    }
+
 	    /* First encode all opaque pixels of a scan line */
 	    x = 0;
 	    do {
@@ -1583,8 +1757,10 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 		    lastline = dst;
 	    } while(x < w);
 
+	    flags[y] = blankline ? RLE_ROW_BLANK : 0;
 	    src += surface->pitch >> 2;
 	}
+	rows[h] = dst - rlebuf;
 	dst = lastline;		/* back up past trailing blank lines */
 	ADD_OPAQUE_COUNTS(0, 0);
     }
@@ -1592,21 +1768,7 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 #undef ADD_OPAQUE_COUNTS
 #undef ADD_TRANSL_COUNTS
 
-    /* Now that we have it encoded, release the original pixels */
-    if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-       && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	SDL_free( surface->pixels );
-	surface->pixels = NULL;
-    }
-
-    /* realloc the buffer to release unused memory */
-    {
-	Uint8 *p = SDL_realloc(rlebuf, dst - rlebuf);
-	if(!p)
-	    p = rlebuf;
-	surface->map->sw_data->aux_data = p;
-    }
-
+    SetRLEData(surface, rlebuf, dst - rlebuf, lastline - rlebuf, rows);
     return 0;
 }
 
@@ -1651,6 +1813,9 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	getpix_func getpix;
 	Uint32 ckey, rgbmask;
 	int w, h;
+	int *rows;
+	Uint8 *flags;
+	struct private_swaccel *sw = surface->map->sw_data;
 
 	/* calculate the worst case size for the compressed surface */
 	switch(bpp) {
@@ -1677,6 +1842,12 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		SDL_OutOfMemory();
 		return(-1);
 	}
+	rows = AllocRLERows(surface->h);
+	if ( rows == NULL ) {
+		SDL_free(rlebuf);
+		return(-1);
+	}
+	flags = (Uint8 *)(rows + surface->h + 1);
 
 	/* Set up the conversion */
 	srcbuf = (Uint8 *)surface->pixels;
@@ -1703,6 +1874,19 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	for(y = 0; y < h; y++) {
 	    int x = 0;
 	    int blankline = 0;
+	    int copied;
+
+	    rows[y] = dst - rlebuf;
+	    copied = ReuseRLERow(sw, y, dst);
+	    if(copied) {
+		dst += copied;
+		flags[y] = sw->rle_flags[y];
+		if(!(flags[y] & RLE_ROW_BLANK))
+		    lastline = dst;
+		srcbuf += surface->pitch;
+		continue;
+	    }
+
 	    do {
 		int run, skip, len;
 		int runstart;
@@ -1742,29 +1926,16 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 		    lastline = dst;
 	    } while(x < w);
 
+	    flags[y] = blankline ? RLE_ROW_BLANK : 0;
 	    srcbuf += surface->pitch;
 	}
+	rows[h] = dst - rlebuf;
 	dst = lastline;		/* back up bast trailing blank lines */
 	ADD_COUNTS(0, 0);
 
 #undef ADD_COUNTS
 
-	/* Now that we have it encoded, release the original pixels */
-	if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    SDL_free( surface->pixels );
-	    surface->pixels = NULL;
-	}
-
-	/* realloc the buffer to release unused memory */
-	{
-	    /* If realloc returns NULL, the original block is left intact */
-	    Uint8 *p = SDL_realloc(rlebuf, dst - rlebuf);
-	    if(!p)
-		p = rlebuf;
-	    surface->map->sw_data->aux_data = p;
-	}
-
+	SetRLEData(surface, rlebuf, dst - rlebuf, lastline - rlebuf, rows);
 	return(0);
 }
 
@@ -1805,8 +1976,11 @@ int SDL_RLESurface(SDL_Surface *surface)
 		SDL_UnlockSurface(surface);
 	}
 
-	if(retcode < 0)
+	if(retcode < 0) {
+	    /* drop what is left of an encoding kept over a lock */
+	    FreeRLEData(surface->map->sw_data);
 	    return -1;
+	}
 
 	/* The surface is now accelerated */
 	surface->flags |= SDL_RLEACCEL;
@@ -1897,7 +2071,9 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
     if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
 	surface->flags &= ~SDL_RLEACCEL;
 
-	if(recode && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
+	/* surfaces that kept their pixels over a lock need no decoding */
+	if(recode && !surface->pixels
+	   && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
 	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
 	    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
 		SDL_Rect full;
@@ -1931,11 +2107,39 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 	    }
 	}
 
-	if ( surface->map && surface->map->sw_data->aux_data ) {
-	    SDL_free(surface->map->sw_data->aux_data);
-	    surface->map->sw_data->aux_data = NULL;
+	if ( surface->map ) {
+	    FreeRLEData(surface->map->sw_data);
 	}
     }
 }
 
+/*
+ * Get an RLE surface ready for writing the rows covered by 'rect' (all
+ * rows if NULL) under a lock. Surfaces that still have their pixels keep
+ * the encoding, and only these rows are encoded again on unlock. Returns
+ * -1 if the surface has to be decoded instead.
+ */
+int SDL_RLEDirtyRows(SDL_Surface *surface, const SDL_Rect *rect)
+{
+    struct private_swaccel *sw = surface->map->sw_data;
+    int y, end;
+
+    /* a surface that is written once is likely to be written again */
+    sw->rle_keep = 1;
+
+    if(!surface->pixels || !sw->aux_data || !sw->rle_rows
+       || (surface->flags & (SDL_HWSURFACE|SDL_ASYNCBLIT)))
+	return -1;
+
+    y = 0;
+    end = surface->h;
+    if(rect) {
+	y = MAX(rect->y, 0);
+	end = MIN(rect->y + rect->h, end);
+    }
+    for(; y < end; y++)
+	sw->rle_flags[y] |= RLE_ROW_DIRTY;
+    return 0;
+}
+
 
@@ -22,6 +22,7 @@
 #include "SDL_config.h"
 
 #include "SDL_video.h"
+#include "SDL_thread.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
@@ -39,8 +40,233 @@
 #include "mmx.h"
 #endif
 
+/*
+ * Optional multithreaded blitting: with SDL_BLIT_THREADS=n in the
+ * environment, large software blits are cut into n horizontal bands.
+ * The caller runs the first band itself and a persistent pool of n-1
+ * worker threads runs the others; the caller waits for all of them
+ * before returning, so the blit is still synchronous.  The pool is
+ * started once by SDL_Init(), so blits on several threads never race
+ * to create it, and blits before SDL_Init() aren't split.
+ */
+#define SDL_MAX_BLIT_THREADS		16
+#define SDL_BLIT_THREAD_MIN_PIXELS	(128*128)	/* per band */
+
+typedef struct {
+	SDL_Thread *thread;
+	SDL_sem *start;
+	SDL_BlitBandFunc func;
+	void *data;
+	int first;
+	int count;
+} SDL_BlitWorker;
+
+static SDL_mutex *blit_pool_lock = NULL;
+static SDL_sem *blit_pool_done = NULL;
+static volatile int blit_pool_quit = 0;
+static int blit_pool_size = 0;
+static SDL_BlitWorker blit_pool[SDL_MAX_BLIT_THREADS-1];
+
+static int SDLCALL SDL_BlitWorkerMain(void *data)
+{
+	SDL_BlitWorker *worker = (SDL_BlitWorker *)data;
+
+	for ( ; ; ) {
+		SDL_SemWait(worker->start);
+		if ( blit_pool_quit ) {
+			break;
+		}
+		worker->func(worker->data, worker->first, worker->count);
+		SDL_SemPost(blit_pool_done);
+	}
+	return(0);
+}
+
+void SDL_BlitThreadsQuit(void)
+{
+	int i;
+
+	blit_pool_quit = 1;
+	for ( i = 0; i < blit_pool_size; ++i ) {
+		SDL_SemPost(blit_pool[i].start);
+		SDL_WaitThread(blit_pool[i].thread, NULL);
+	}
+	for ( i = 0; i < SDL_arraysize(blit_pool); ++i ) {
+		if ( blit_pool[i].start ) {
+			SDL_DestroySemaphore(blit_pool[i].start);
+		}
+	}
+	SDL_memset(blit_pool, 0, sizeof(blit_pool));
+	blit_pool_size = 0;
+	if ( blit_pool_done ) {
+		SDL_DestroySemaphore(blit_pool_done);
+		blit_pool_done = NULL;
+	}
+	if ( blit_pool_lock ) {
+		SDL_DestroyMutex(blit_pool_lock);
+		blit_pool_lock = NULL;
+	}
+	blit_pool_quit = 0;
+}
+
+/* Start the worker pool asked for by SDL_BLIT_THREADS, if any.
+   Returns the number of threads available for a blit, including the caller.
+ */
+int SDL_BlitThreadsInit(void)
+{
+	const char *hint;
+	int i, wanted;
+
+	if ( blit_pool_size ) {
+		return(blit_pool_size + 1);
+	}
+	hint = SDL_getenv("SDL_BLIT_THREADS");
+	if ( !hint ) {
+		return(1);
+	}
+	wanted = SDL_atoi(hint);
+	if ( wanted > SDL_MAX_BLIT_THREADS ) {
+		wanted = SDL_MAX_BLIT_THREADS;
+	}
+	if ( wanted <= 1 ) {
+		return(1);
+	}
+
+	blit_pool_lock = SDL_CreateMutex();
+	blit_pool_done = SDL_CreateSemaphore(0);
+	if ( !blit_pool_lock || !blit_pool_done ) {
+		SDL_BlitThreadsQuit();
+		return(1);
+	}
+	for ( i = 0; i < wanted-1; ++i ) {
+		blit_pool[i].start = SDL_CreateSemaphore(0);
+		if ( !blit_pool[i].start ) {
+			break;
+		}
+		blit_pool[i].thread = SDL_CreateThread(SDL_BlitWorkerMain, &blit_pool[i]);
+		if ( !blit_pool[i].thread ) {
+			break;
+		}
+		blit_pool_size = i+1;
+	}
+	if ( !blit_pool_size ) {
+		SDL_BlitThreadsQuit();
+		return(1);
+	}
+	return(blit_pool_size + 1);
+}
+
+/* Run func() over 'rows' rows, split into bands spread over the worker pool */
+void SDL_RunBlitBands(SDL_BlitBandFunc func, void *data, int rows, int width)
+{
+	int bands, band_rows, y, i;
+
+	bands = 1;
+	if ( width > 0 && rows > 0 && blit_pool_size ) {
+		bands = (width*rows) / SDL_BLIT_THREAD_MIN_PIXELS;
+		if ( bands > blit_pool_size+1 ) {
+			bands = blit_pool_size+1;
+		}
+		if ( bands > rows ) {
+			bands = rows;
+		}
+	}
+	if ( bands < 2 ) {
+		func(data, 0, rows);
+		return;
+	}
+	band_rows = (rows + bands-1) / bands;
+
+	SDL_mutexP(blit_pool_lock);
+	for ( i = 0, y = band_rows; y < rows; ++i, y += band_rows ) {
+		SDL_BlitWorker *worker = &blit_pool[i];
+		worker->func = func;
+		worker->data = data;
+		worker->first = y;
+		worker->count = rows - y;
+		if ( worker->count > band_rows ) {
+			worker->count = band_rows;
+		}
+		SDL_SemPost(worker->start);
+	}
+	bands = i;
+
+	/* The first band is ours */
+	func(data, 0, band_rows);
+
+	while ( bands-- ) {
+		SDL_SemWait(blit_pool_done);
+	}
+	SDL_mutexV(blit_pool_lock);
+}
+
+typedef struct {
+	SDL_loblit blit;
+	SDL_BlitInfo *info;
+	int s_pitch;
+	int d_pitch;
+} SDL_BlitBandJob;
+
+static void SDL_BlitBand(void *data, int first, int count)
+{
+	SDL_BlitBandJob *job = (SDL_BlitBandJob *)data;
+	SDL_BlitInfo info = *job->info;
+
+	info.s_pixels += first*job->s_pitch;
+	info.d_pixels += first*job->d_pitch;
+	info.s_height = count;
+	info.d_height = count;
+	job->blit(&info);
+}
+
+/* Run the mapped software blitter on one clipped rectangle.
+   The surfaces must already be locked if they need it.
+ */
+void SDL_SoftBlitRect(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	SDL_BlitInfo info;
+	SDL_loblit RunBlit;
+
+	if ( !srcrect->w || !srcrect->h ) {
+		return;
+	}
+
+	/* Set up the blit information */
+	info.s_pixels = (Uint8 *)src->pixels +
+			(Uint16)srcrect->y*src->pitch +
+			(Uint16)srcrect->x*src->format->BytesPerPixel;
+	info.s_width = srcrect->w;
+	info.s_height = srcrect->h;
+	info.s_skip=src->pitch-info.s_width*src->format->BytesPerPixel;
+	info.d_pixels = (Uint8 *)dst->pixels +
+			(Uint16)dstrect->y*dst->pitch +
+			(Uint16)dstrect->x*dst->format->BytesPerPixel;
+	info.d_width = dstrect->w;
+	info.d_height = dstrect->h;
+	info.d_skip=dst->pitch-info.d_width*dst->format->BytesPerPixel;
+	info.aux_data = src->map->sw_data->aux_data;
+	info.src = src->format;
+	info.table = src->map->table;
+	info.dst = dst->format;
+	RunBlit = src->map->sw_data->blit;
+
+	/* Run the actual software blit */
+	if ( src->map->sw_data->threaded && blit_pool_size ) {
+		SDL_BlitBandJob job;
+
+		job.blit = RunBlit;
+		job.info = &info;
+		job.s_pitch = src->pitch;
+		job.d_pitch = dst->pitch;
+		SDL_RunBlitBands(SDL_BlitBand, &job, info.d_height, info.d_width);
+	} else {
+		RunBlit(&info);
+	}
+}
+
 /* The general purpose software blit routine */
-static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			SDL_Surface *dst, SDL_Rect *dstrect)
 {
 	int okay;
@@ -53,7 +279,7 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
 	if ( SDL_MUSTLOCK(dst) ) {
-		if ( SDL_LockSurface(dst) < 0 ) {
+		if ( SDL_LockSurfaceRect(dst, dstrect) < 0 ) {
 			okay = 0;
 		} else {
 			dst_locked = 1;
@@ -70,31 +296,8 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	}
 
 	/* Set up source and destination buffer pointers, and BLIT! */
-	if ( okay  && srcrect->w && srcrect->h ) {
-		SDL_BlitInfo info;
-		SDL_loblit RunBlit;
-
-		/* Set up the blit information */
-		info.s_pixels = (Uint8 *)src->pixels +
-				(Uint16)srcrect->y*src->pitch +
-				(Uint16)srcrect->x*src->format->BytesPerPixel;
-		info.s_width = srcrect->w;
-		info.s_height = srcrect->h;
-		info.s_skip=src->pitch-info.s_width*src->format->BytesPerPixel;
-		info.d_pixels = (Uint8 *)dst->pixels +
-				(Uint16)dstrect->y*dst->pitch +
-				(Uint16)dstrect->x*dst->format->BytesPerPixel;
-		info.d_width = dstrect->w;
-		info.d_height = dstrect->h;
-		info.d_skip=dst->pitch-info.d_width*dst->format->BytesPerPixel;
-		info.aux_data = src->map->sw_data->aux_data;
-		info.src = src->format;
-		info.table = src->map->table;
-		info.dst = dst->format;
-		RunBlit = src->map->sw_data->blit;
-
-		/* Run the actual software blit */
-		RunBlit(&info);
+	if ( okay ) {
+		SDL_SoftBlitRect(src, srcrect, dst, dstrect);
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -362,6 +565,15 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 	if ( surface->map->sw_blit == NULL ) {
 		surface->map->sw_blit = SDL_SoftBlit;
 	}
+
+	/* Bitmap sources can't be cut into bands on byte boundaries, and
+	   blits within one surface may read rows another band writes */
+	surface->map->sw_data->threaded = 0;
+	if ( surface->map->sw_blit == SDL_SoftBlit &&
+	     surface->format->BitsPerPixel >= 8 &&
+	     surface != surface->map->dst ) {
+		surface->map->sw_data->threaded = (blit_pool_size > 0);
+	}
 	return(0);
 }
 
@@ -28,6 +28,20 @@
 
 extern SDL_bool SDL_HasARMSIMD(void);		/* whether CPU has ARM SIMD (ARMv6) features */
 extern SDL_bool SDL_HasNEON (void);		/* whether CPU has ARM NEON features.        */
+extern SDL_bool SDL_HasSSSE3(void);		/* whether CPU has SSSE3 (pshufb) features   */
+extern SDL_bool SDL_HasAVX2(void);		/* whether CPU has AVX2 features (OS enabled) */
+
+/* The x86 SIMD blitters are written with intrinsics and compiled per
+   function for their instruction set, so the rest of the library keeps
+   its baseline code generation and the choice is made at runtime. */
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && \
+    (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || (__GNUC__ >= 5))
+#define SDL_X86_SIMD_BLITTERS	1
+#define SDL_TARGET_SSE2	__attribute__((target("sse2")))
+#define SDL_TARGET_SSSE3	__attribute__((target("ssse3")))
+#define SDL_TARGET_AVX2	__attribute__((target("avx2")))
+#endif
 
 /* The structure passed to the low level blit functions */
 typedef struct {
@@ -52,6 +66,13 @@ typedef void (*SDL_loblit)(SDL_BlitInfo *info);
 struct private_swaccel {
 	SDL_loblit blit;
 	void *aux_data;
+	int threaded;	/* split large blits into bands on the worker pool */
+
+	/* RLE surfaces that get locked keep their pixels, and only the
+	   rows written under a lock are encoded again on unlock */
+	int *rle_rows;		/* offset of each row in aux_data, h+1 entries */
+	Uint8 *rle_flags;	/* per-row RLE_ROW_* flags, after rle_rows */
+	int rle_keep;		/* don't free the pixels after encoding */
 };
 
 /* Blit mapping definition */
@@ -72,6 +93,18 @@ typedef struct SDL_BlitMap {
 
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern int SDL_BlitThreadsInit(void);
+extern void SDL_BlitThreadsQuit(void);
+
+/* Runs func() over rows [0,rows) of an image 'width' pixels wide, split
+   into bands on the SDL_BLIT_THREADS worker pool when it is large enough.
+ */
+typedef void (*SDL_BlitBandFunc)(void *data, int first, int count);
+extern void SDL_RunBlitBands(SDL_BlitBandFunc func, void *data, int rows, int width);
+extern int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect);
+extern void SDL_SoftBlitRect(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
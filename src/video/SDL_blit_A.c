@@ -2780,6 +2780,516 @@ static void BlitNtoNPixelAlpha(SDL_BlitInfo *info)
 }
 
 
+#if SDL_X86_SIMD_BLITTERS
+#include <immintrin.h>
+
+/*
+ * The SSE2/AVX2 blenders work on 16-bit channels and compute
+ *     (s * A + d * (256 - A) + bias) >> 8
+ * which is d + (((s - d) * A + bias) >> 8) without needing signed math.
+ * Pixel alpha 255 is promoted to 256 so opaque pixels come out exact,
+ * the same result the scalar code gets by special-casing them.
+ * Whole vectors of transparent (or colorkeyed) pixels are skipped and
+ * whole vectors of opaque pixels are copied without blending.
+ */
+
+/* The scalar pixel used for row tails, matching the vector arithmetic */
+#define BLEND_CHANNEL(s, d, A, bias)	(((s) * (A) + (d) * (256 - (A)) + (bias)) >> 8)
+
+static __inline__ Uint32 BlendRGBtoRGBPixelAlpha(Uint32 s, Uint32 d)
+{
+	Uint32 A = s >> 24;
+
+	if ( A == 0 ) {
+		return d;
+	}
+	if ( A == SDL_ALPHA_OPAQUE ) {
+		return (s & 0x00ffffff) | (d & 0xff000000);
+	}
+	return (BLEND_CHANNEL((s >> 16) & 0xff, (d >> 16) & 0xff, A, 0) << 16) |
+	       (BLEND_CHANNEL((s >> 8) & 0xff, (d >> 8) & 0xff, A, 0) << 8) |
+	       BLEND_CHANNEL(s & 0xff, d & 0xff, A, 0) | (d & 0xff000000);
+}
+
+static __inline__ Uint32 BlendRGBtoRGBSurfaceAlpha(Uint32 s, Uint32 d, Uint32 A,
+                                                   Uint32 bias, Uint32 rgbmask, Uint32 fill)
+{
+	Uint32 p = 0;
+	int shift;
+
+	for ( shift = 0; shift < 32; shift += 8 ) {
+		p |= BLEND_CHANNEL((s >> shift) & 0xff, (d >> shift) & 0xff, A, bias) << shift;
+	}
+	return (p & rgbmask) | fill;
+}
+
+SDL_TARGET_SSE2
+static __inline__ __m128i Blend16_SSE2(__m128i s, __m128i d, __m128i A, __m128i bias)
+{
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(s, A),
+	            _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(256), A)));
+	return _mm_srli_epi16(_mm_add_epi16(t, bias), 8);
+}
+
+SDL_TARGET_AVX2
+static __inline__ __m256i Blend16_AVX2(__m256i s, __m256i d, __m256i A, __m256i bias)
+{
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(s, A),
+	            _mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(256), A)));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, bias), 8);
+}
+
+/* ARGB8888 -> (A)RGB8888 with pixel alpha, destination alpha is kept */
+SDL_TARGET_SSE2
+static void BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xff000000);
+	const __m128i opaque = _mm_set1_epi16(SDL_ALPHA_OPAQUE);
+	const __m128i chanmask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+
+	while(height--) {
+	    int n = width;
+	    while(n >= 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+		__m128i sa = _mm_and_si128(s, amask);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) != 0xffff) {
+		    __m128i d = _mm_loadu_si128((const __m128i *)dstp);
+		    if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, amask)) == 0xffff) {
+			d = _mm_or_si128(_mm_andnot_si128(amask, s), _mm_and_si128(d, amask));
+		    } else {
+			__m128i slo = _mm_unpacklo_epi8(s, zero);
+			__m128i shi = _mm_unpackhi_epi8(s, zero);
+			__m128i dlo = _mm_unpacklo_epi8(d, zero);
+			__m128i dhi = _mm_unpackhi_epi8(d, zero);
+			__m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, 0xff), 0xff);
+			__m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, 0xff), 0xff);
+			alo = _mm_and_si128(_mm_sub_epi16(alo, _mm_cmpeq_epi16(alo, opaque)), chanmask);
+			ahi = _mm_and_si128(_mm_sub_epi16(ahi, _mm_cmpeq_epi16(ahi, opaque)), chanmask);
+			dlo = Blend16_SSE2(slo, dlo, alo, zero);
+			dhi = Blend16_SSE2(shi, dhi, ahi, zero);
+			d = _mm_packus_epi16(dlo, dhi);
+		    }
+		    _mm_storeu_si128((__m128i *)dstp, d);
+		}
+		srcp += 4;
+		dstp += 4;
+		n -= 4;
+	    }
+	    while(n--) {
+		*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static void BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i amask = _mm256_set1_epi32(0xff000000);
+	const __m256i opaque = _mm256_set1_epi16(SDL_ALPHA_OPAQUE);
+	const __m256i chanmask = _mm256_set1_epi64x(0x0000ffffffffffffLL);
+
+	while(height--) {
+	    int n = width;
+	    while(n >= 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)srcp);
+		__m256i sa = _mm256_and_si256(s, amask);
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) != -1) {
+		    __m256i d = _mm256_loadu_si256((const __m256i *)dstp);
+		    if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, amask)) == -1) {
+			d = _mm256_or_si256(_mm256_andnot_si256(amask, s), _mm256_and_si256(d, amask));
+		    } else {
+			__m256i slo = _mm256_unpacklo_epi8(s, zero);
+			__m256i shi = _mm256_unpackhi_epi8(s, zero);
+			__m256i dlo = _mm256_unpacklo_epi8(d, zero);
+			__m256i dhi = _mm256_unpackhi_epi8(d, zero);
+			__m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xff), 0xff);
+			__m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xff), 0xff);
+			alo = _mm256_and_si256(_mm256_sub_epi16(alo, _mm256_cmpeq_epi16(alo, opaque)), chanmask);
+			ahi = _mm256_and_si256(_mm256_sub_epi16(ahi, _mm256_cmpeq_epi16(ahi, opaque)), chanmask);
+			dlo = Blend16_AVX2(slo, dlo, alo, zero);
+			dhi = Blend16_AVX2(shi, dhi, ahi, zero);
+			d = _mm256_packus_epi16(dlo, dhi);
+		    }
+		    _mm256_storeu_si256((__m256i *)dstp, d);
+		}
+		srcp += 8;
+		dstp += 8;
+		n -= 8;
+	    }
+	    while(n--) {
+		*dstp = BlendRGBtoRGBPixelAlpha(*srcp, *dstp);
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+	_mm256_zeroupper();
+}
+
+/*
+ * 32->32 with per-surface alpha and matching RGB masks, optionally
+ * skipping colorkeyed source pixels.  'bias' is 0 for the fast RGB888
+ * path and 255 for the rounding done by ALPHA_BLEND.
+ */
+SDL_TARGET_SSE2
+static __inline__ void Blit32to32SurfaceAlphaSSE2(SDL_BlitInfo *info,
+                                  Uint32 bias, Uint32 fill, int use_key)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat *srcfmt = info->src;
+	Uint32 ckey = srcfmt->colorkey;
+	Uint32 rgbmask = srcfmt->Rmask | srcfmt->Gmask | srcfmt->Bmask;
+	unsigned A = srcfmt->alpha;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vA = _mm_set1_epi16(A);
+	const __m128i vbias = _mm_set1_epi16(bias);
+	const __m128i vrgb = _mm_set1_epi32(rgbmask);
+	const __m128i vfill = _mm_set1_epi32(fill);
+	const __m128i vkey = _mm_set1_epi32(ckey);
+
+	if(!A) {
+		return;
+	}
+	while(height--) {
+	    int n = width;
+	    while(n >= 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+		__m128i k = zero;
+		if(use_key) {
+		    k = _mm_cmpeq_epi32(s, vkey);
+		}
+		if(_mm_movemask_epi8(k) != 0xffff) {
+		    __m128i d = _mm_loadu_si128((const __m128i *)dstp);
+		    __m128i lo = Blend16_SSE2(_mm_unpacklo_epi8(s, zero),
+		                              _mm_unpacklo_epi8(d, zero), vA, vbias);
+		    __m128i hi = Blend16_SSE2(_mm_unpackhi_epi8(s, zero),
+		                              _mm_unpackhi_epi8(d, zero), vA, vbias);
+		    __m128i r = _mm_or_si128(_mm_and_si128(_mm_packus_epi16(lo, hi), vrgb), vfill);
+		    r = _mm_or_si128(_mm_and_si128(k, d), _mm_andnot_si128(k, r));
+		    _mm_storeu_si128((__m128i *)dstp, r);
+		}
+		srcp += 4;
+		dstp += 4;
+		n -= 4;
+	    }
+	    while(n--) {
+		if(!use_key || *srcp != ckey) {
+		    *dstp = BlendRGBtoRGBSurfaceAlpha(*srcp, *dstp, A, bias, rgbmask, fill);
+		}
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static __inline__ void Blit32to32SurfaceAlphaAVX2(SDL_BlitInfo *info,
+                                  Uint32 bias, Uint32 fill, int use_key)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat *srcfmt = info->src;
+	Uint32 ckey = srcfmt->colorkey;
+	Uint32 rgbmask = srcfmt->Rmask | srcfmt->Gmask | srcfmt->Bmask;
+	unsigned A = srcfmt->alpha;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i vA = _mm256_set1_epi16(A);
+	const __m256i vbias = _mm256_set1_epi16(bias);
+	const __m256i vrgb = _mm256_set1_epi32(rgbmask);
+	const __m256i vfill = _mm256_set1_epi32(fill);
+	const __m256i vkey = _mm256_set1_epi32(ckey);
+
+	if(!A) {
+		return;
+	}
+	while(height--) {
+	    int n = width;
+	    while(n >= 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)srcp);
+		__m256i k = zero;
+		if(use_key) {
+		    k = _mm256_cmpeq_epi32(s, vkey);
+		}
+		if(_mm256_movemask_epi8(k) != -1) {
+		    __m256i d = _mm256_loadu_si256((const __m256i *)dstp);
+		    __m256i lo = Blend16_AVX2(_mm256_unpacklo_epi8(s, zero),
+		                              _mm256_unpacklo_epi8(d, zero), vA, vbias);
+		    __m256i hi = Blend16_AVX2(_mm256_unpackhi_epi8(s, zero),
+		                              _mm256_unpackhi_epi8(d, zero), vA, vbias);
+		    __m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_packus_epi16(lo, hi), vrgb), vfill);
+		    r = _mm256_or_si256(_mm256_and_si256(k, d), _mm256_andnot_si256(k, r));
+		    _mm256_storeu_si256((__m256i *)dstp, r);
+		}
+		srcp += 8;
+		dstp += 8;
+		n -= 8;
+	    }
+	    while(n--) {
+		if(!use_key || *srcp != ckey) {
+		    *dstp = BlendRGBtoRGBSurfaceAlpha(*srcp, *dstp, A, bias, rgbmask, fill);
+		}
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+	_mm256_zeroupper();
+}
+
+SDL_TARGET_SSE2
+static void BlitRGBtoRGBSurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaSSE2(info, 0, 0xff000000, 0);
+}
+
+SDL_TARGET_SSE2
+static void Blit32to32SurfaceAlphaSSE2Generic(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaSSE2(info, 255, info->dst->Amask, 0);
+}
+
+SDL_TARGET_SSE2
+static void Blit32to32SurfaceAlphaKeySSE2(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaSSE2(info, 255, info->dst->Amask, 1);
+}
+
+SDL_TARGET_AVX2
+static void BlitRGBtoRGBSurfaceAlphaAVX2(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaAVX2(info, 0, 0xff000000, 0);
+}
+
+SDL_TARGET_AVX2
+static void Blit32to32SurfaceAlphaAVX2Generic(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaAVX2(info, 255, info->dst->Amask, 0);
+}
+
+SDL_TARGET_AVX2
+static void Blit32to32SurfaceAlphaKeyAVX2(SDL_BlitInfo *info)
+{
+	Blit32to32SurfaceAlphaAVX2(info, 255, info->dst->Amask, 1);
+}
+
+/*
+ * ARGB8888 -> RGB565/RGB555 with pixel alpha, blending at the 5-bit
+ * alpha precision of BlitARGBto565PixelAlpha.  The parameters select
+ * the destination red shift and the source green shift/mask.
+ */
+#define ARGB_TO_16_PARAMS(is565) \
+	((is565) ? 11 : 10), ((is565) ? 10 : 11), ((is565) ? 0x3f : 0x1f)
+
+static __inline__ Uint16 BlendARGBto16Pixel(Uint32 s, Uint16 d, int rs, int gs, int gm)
+{
+	unsigned A = s >> 27;
+	int sr, sg, sb, dr, dg, db;
+
+	if ( A == 0 ) {
+		return d;
+	}
+	sr = (s >> 19) & 0x1f;
+	sg = (s >> gs) & gm;
+	sb = (s >> 3) & 0x1f;
+	if ( A != (SDL_ALPHA_OPAQUE >> 3) ) {
+		dr = (d >> rs) & 0x1f;
+		dg = (d >> 5) & gm;
+		db = d & 0x1f;
+		sr = dr + (((sr - dr) * (int)A) >> 5);
+		sg = dg + (((sg - dg) * (int)A) >> 5);
+		sb = db + (((sb - db) * (int)A) >> 5);
+	}
+	return (Uint16)((sr << rs) | (sg << 5) | sb);
+}
+
+SDL_TARGET_SSE2
+static __inline__ void BlitARGBto16PixelAlphaSSE2(SDL_BlitInfo *info, int rs, int gs, int gm)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m128i m5 = _mm_set1_epi32(0x1f);
+	const __m128i mg = _mm_set1_epi32(gm);
+
+	while(height--) {
+	    int n = width;
+	    while(n >= 8) {
+		__m128i s0 = _mm_loadu_si128((const __m128i *)srcp);
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(srcp + 4));
+		__m128i A = _mm_packs_epi32(_mm_srli_epi32(s0, 27), _mm_srli_epi32(s1, 27));
+		__m128i transparent = _mm_cmpeq_epi16(A, zero);
+		if(_mm_movemask_epi8(transparent) != 0xffff) {
+		    __m128i d = _mm_loadu_si128((const __m128i *)dstp);
+		    __m128i r;
+		    __m128i sr = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 19), m5),
+		                                 _mm_and_si128(_mm_srli_epi32(s1, 19), m5));
+		    __m128i sg = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, gs), mg),
+		                                 _mm_and_si128(_mm_srli_epi32(s1, gs), mg));
+		    __m128i sb = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 3), m5),
+		                                 _mm_and_si128(_mm_srli_epi32(s1, 3), m5));
+		    __m128i opq = _mm_cmpeq_epi16(A, opaque);
+		    if(_mm_movemask_epi8(opq) != 0xffff) {
+			__m128i dr = _mm_and_si128(_mm_srli_epi16(d, rs), _mm_set1_epi16(0x1f));
+			__m128i dg = _mm_and_si128(_mm_srli_epi16(d, 5), _mm_set1_epi16(gm));
+			__m128i db = _mm_and_si128(d, _mm_set1_epi16(0x1f));
+			/* Alpha 31 becomes 32 so opaque pixels are copied exactly */
+			A = _mm_sub_epi16(A, opq);
+			sr = _mm_add_epi16(dr, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(sr, dr), A), 5));
+			sg = _mm_add_epi16(dg, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(sg, dg), A), 5));
+			sb = _mm_add_epi16(db, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(sb, db), A), 5));
+		    }
+		    r = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(sr, rs), _mm_slli_epi16(sg, 5)), sb);
+		    /* leave the pixels under fully transparent ones untouched */
+		    r = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, r));
+		    _mm_storeu_si128((__m128i *)dstp, r);
+		}
+		srcp += 8;
+		dstp += 8;
+		n -= 8;
+	    }
+	    while(n--) {
+		*dstp = BlendARGBto16Pixel(*srcp, *dstp, rs, gs, gm);
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static __inline__ void BlitARGBto16PixelAlphaAVX2(SDL_BlitInfo *info, int rs, int gs, int gm)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i opaque = _mm256_set1_epi16(SDL_ALPHA_OPAQUE >> 3);
+	const __m256i m5 = _mm256_set1_epi32(0x1f);
+	const __m256i mg = _mm256_set1_epi32(gm);
+
+/* packs works per 128-bit lane, restore the pixel order afterwards */
+#define PACK_ORDERED(a, b) _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8)
+
+	while(height--) {
+	    int n = width;
+	    while(n >= 16) {
+		__m256i s0 = _mm256_loadu_si256((const __m256i *)srcp);
+		__m256i s1 = _mm256_loadu_si256((const __m256i *)(srcp + 8));
+		__m256i A = PACK_ORDERED(_mm256_srli_epi32(s0, 27), _mm256_srli_epi32(s1, 27));
+		__m256i transparent = _mm256_cmpeq_epi16(A, zero);
+		if(_mm256_movemask_epi8(transparent) != -1) {
+		    __m256i d = _mm256_loadu_si256((const __m256i *)dstp);
+		    __m256i r;
+		    __m256i sr = PACK_ORDERED(_mm256_and_si256(_mm256_srli_epi32(s0, 19), m5),
+		                              _mm256_and_si256(_mm256_srli_epi32(s1, 19), m5));
+		    __m256i sg = PACK_ORDERED(_mm256_and_si256(_mm256_srli_epi32(s0, gs), mg),
+		                              _mm256_and_si256(_mm256_srli_epi32(s1, gs), mg));
+		    __m256i sb = PACK_ORDERED(_mm256_and_si256(_mm256_srli_epi32(s0, 3), m5),
+		                              _mm256_and_si256(_mm256_srli_epi32(s1, 3), m5));
+		    __m256i opq = _mm256_cmpeq_epi16(A, opaque);
+		    if(_mm256_movemask_epi8(opq) != -1) {
+			__m256i dr = _mm256_and_si256(_mm256_srli_epi16(d, rs), _mm256_set1_epi16(0x1f));
+			__m256i dg = _mm256_and_si256(_mm256_srli_epi16(d, 5), _mm256_set1_epi16(gm));
+			__m256i db = _mm256_and_si256(d, _mm256_set1_epi16(0x1f));
+			A = _mm256_sub_epi16(A, opq);
+			sr = _mm256_add_epi16(dr, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sr, dr), A), 5));
+			sg = _mm256_add_epi16(dg, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sg, dg), A), 5));
+			sb = _mm256_add_epi16(db, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(sb, db), A), 5));
+		    }
+		    r = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(sr, rs), _mm256_slli_epi16(sg, 5)), sb);
+		    r = _mm256_or_si256(_mm256_and_si256(transparent, d), _mm256_andnot_si256(transparent, r));
+		    _mm256_storeu_si256((__m256i *)dstp, r);
+		}
+		srcp += 16;
+		dstp += 16;
+		n -= 16;
+	    }
+	    while(n--) {
+		*dstp = BlendARGBto16Pixel(*srcp, *dstp, rs, gs, gm);
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+#undef PACK_ORDERED
+	_mm256_zeroupper();
+}
+
+SDL_TARGET_SSE2
+static void BlitARGBto565PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, ARGB_TO_16_PARAMS(1));
+}
+
+SDL_TARGET_SSE2
+static void BlitARGBto555PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, ARGB_TO_16_PARAMS(0));
+}
+
+SDL_TARGET_AVX2
+static void BlitARGBto565PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, ARGB_TO_16_PARAMS(1));
+}
+
+SDL_TARGET_AVX2
+static void BlitARGBto555PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, ARGB_TO_16_PARAMS(0));
+}
+
+/* 32-bit formats whose channels all sit on byte boundaries */
+static int Is32BitByteAligned(const SDL_PixelFormat *fmt)
+{
+	return (fmt->BytesPerPixel == 4 &&
+	        fmt->Rshift % 8 == 0 && fmt->Rloss == 0 &&
+	        fmt->Gshift % 8 == 0 && fmt->Gloss == 0 &&
+	        fmt->Bshift % 8 == 0 && fmt->Bloss == 0);
+}
+#endif /* SDL_X86_SIMD_BLITTERS */
+
 SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 {
     SDL_PixelFormat *sf = surface->format;
@@ -2790,6 +3300,13 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	    if(df->BytesPerPixel == 1)
 		return BlitNto1SurfaceAlphaKey;
 	    else
+#if SDL_X86_SIMD_BLITTERS
+	if (sf->BytesPerPixel == 4 && Is32BitByteAligned(df) &&
+	    sf->Rmask == df->Rmask && sf->Gmask == df->Gmask &&
+	    sf->Bmask == df->Bmask && (SDL_HasAVX2() || SDL_HasSSE2()))
+	    return SDL_HasAVX2() ? Blit32to32SurfaceAlphaKeyAVX2 : Blit32to32SurfaceAlphaKeySSE2;
+	else
+#endif
 #if SDL_ALTIVEC_BLITTERS
 	if (sf->BytesPerPixel == 4 && df->BytesPerPixel == 4 &&
 	    !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
@@ -2841,6 +3358,12 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #endif
 			if((sf->Rmask | sf->Gmask | sf->Bmask) == 0xffffff)
 			{
+#if SDL_X86_SIMD_BLITTERS
+				if(SDL_HasAVX2())
+					return BlitRGBtoRGBSurfaceAlphaAVX2;
+				if(SDL_HasSSE2())
+					return BlitRGBtoRGBSurfaceAlphaSSE2;
+#endif
 #if SDL_ALTIVEC_BLITTERS
 				if(!(surface->map->dst->flags & SDL_HWSURFACE)
 					&& SDL_HasAltiVec())
@@ -2848,6 +3371,15 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #endif
 				return BlitRGBtoRGBSurfaceAlpha;
 			}
+#if SDL_X86_SIMD_BLITTERS
+			if(Is32BitByteAligned(df))
+			{
+				if(SDL_HasAVX2())
+					return Blit32to32SurfaceAlphaAVX2Generic;
+				if(SDL_HasSSE2())
+					return Blit32to32SurfaceAlphaSSE2Generic;
+			}
+#endif
 		}
 #if SDL_ALTIVEC_BLITTERS
 		if((sf->BytesPerPixel == 4) &&
@@ -2896,10 +3428,23 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
-		if(df->Gmask == 0x7e0)
+		if(df->Gmask == 0x7e0) {
+#if SDL_X86_SIMD_BLITTERS
+		    if(SDL_HasAVX2())
+			return BlitARGBto565PixelAlphaAVX2;
+		    if(SDL_HasSSE2())
+			return BlitARGBto565PixelAlphaSSE2;
+#endif
 		    return BlitARGBto565PixelAlpha;
-		else if(df->Gmask == 0x3e0)
+		} else if(df->Gmask == 0x3e0) {
+#if SDL_X86_SIMD_BLITTERS
+		    if(SDL_HasAVX2())
+			return BlitARGBto555PixelAlphaAVX2;
+		    if(SDL_HasSSE2())
+			return BlitARGBto555PixelAlphaSSE2;
+#endif
 		    return BlitARGBto555PixelAlpha;
+		}
 	    }
 	    return BlitNtoNPixelAlpha;
 
@@ -2924,6 +3469,12 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #endif
 		if(sf->Amask == 0xff000000)
 		{
+#if SDL_X86_SIMD_BLITTERS
+			if(SDL_HasAVX2())
+				return BlitRGBtoRGBPixelAlphaAVX2;
+			if(SDL_HasSSE2())
+				return BlitRGBtoRGBPixelAlphaSSE2;
+#endif
 #if SDL_ALTIVEC_BLITTERS
 			if(!(surface->map->dst->flags & SDL_HWSURFACE)
 				&& SDL_HasAltiVec())
@@ -41,7 +41,12 @@ enum blit_features {
 	BLIT_FEATURE_HAS_MMX = 1,
 	BLIT_FEATURE_HAS_ALTIVEC = 2,
 	BLIT_FEATURE_ALTIVEC_DONT_USE_PREFETCH = 4,
-	BLIT_FEATURE_HAS_ARM_SIMD = 8
+	BLIT_FEATURE_HAS_ARM_SIMD = 8,
+	BLIT_FEATURE_HAS_SSE2 = 16,
+	BLIT_FEATURE_HAS_SSSE3 = 32,
+	BLIT_FEATURE_HAS_AVX2 = 64,
+	/* not a CPU feature: both formats are 32-bit with whole byte channels */
+	BLIT_FEATURE_BYTE_ALIGNED_32 = 128
 };
 
 #if SDL_ALTIVEC_BLITTERS
@@ -906,7 +911,9 @@ static enum blit_features GetBlitFeatures( void )
 #endif
 #else
 /* Feature 1 is has-MMX */
-#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0))
+#define GetBlitFeatures() ((SDL_HasMMX() ? BLIT_FEATURE_HAS_MMX : 0) | (SDL_HasARMSIMD() ? BLIT_FEATURE_HAS_ARM_SIMD : 0) | \
+                           (SDL_HasSSE2() ? BLIT_FEATURE_HAS_SSE2 : 0) | (SDL_HasSSSE3() ? BLIT_FEATURE_HAS_SSSE3 : 0) | \
+                           (SDL_HasAVX2() ? BLIT_FEATURE_HAS_AVX2 : 0))
 #endif
 
 #if SDL_ARM_SIMD_BLITTERS
@@ -3043,6 +3050,488 @@ Blit_3or4_to_3or4__inversed_rgb(SDL_BlitInfo * info)
     }
 }
 
+#if SDL_X86_SIMD_BLITTERS
+#include <immintrin.h>
+
+/* Per-pixel byte shuffle for 32->32 blits with byte aligned channels.
+   Output bytes marked 0x80 are cleared and then filled from 'fill'. */
+typedef struct {
+	Uint8 shuffle[16];
+	Uint32 fill;
+} Blit4to4Swizzle;
+
+static void Calc4to4Swizzle(SDL_PixelFormat *srcfmt, SDL_PixelFormat *dstfmt,
+                            Blit4to4Swizzle *sw)
+{
+	int p[4], alpha_channel, i, j;
+
+	get_permutation(srcfmt, dstfmt, &p[0], &p[1], &p[2], &p[3], &alpha_channel);
+	if ( srcfmt->Amask && dstfmt->Amask ) {
+		/* COPY_ALPHA: every destination byte comes from the source */
+		alpha_channel = -1;
+	}
+	for ( i = 0; i < 4; ++i ) {
+		for ( j = 0; j < 4; ++j ) {
+			sw->shuffle[i*4+j] = (j == alpha_channel) ? 0x80 : (Uint8)(i*4 + p[j]);
+		}
+	}
+	sw->fill = 0;
+	if ( alpha_channel >= 0 && dstfmt->Amask ) {
+		sw->fill = (Uint32)srcfmt->alpha << (alpha_channel * 8);
+	}
+}
+
+static __inline__ void Swizzle4to4Pixel(const Uint8 *src, Uint8 *dst,
+                                        const Blit4to4Swizzle *sw)
+{
+	Uint32 pixel = sw->fill;
+	int j;
+
+	for ( j = 0; j < 4; ++j ) {
+		if ( !(sw->shuffle[j] & 0x80) ) {
+			pixel |= (Uint32)src[sw->shuffle[j]] << (j * 8);
+		}
+	}
+	*(Uint32 *)dst = pixel;
+}
+
+/* SSE2 has no byte shuffle, so build each pixel from the source shifted
+   by whole bytes; a permutation needs at most four distinct shifts. */
+SDL_TARGET_SSE2
+static void Blit4to4SSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	Blit4to4Swizzle sw;
+	Uint32 masks[7];
+	__m128i vmask[7], vcount[7], vfill;
+	int shifts[7], nshifts, i, j;
+
+	Calc4to4Swizzle(info->src, info->dst, &sw);
+	SDL_memset(masks, 0, sizeof(masks));
+	for ( j = 0; j < 4; ++j ) {
+		if ( !(sw.shuffle[j] & 0x80) ) {
+			masks[j - sw.shuffle[j] + 3] |= 0xFFu << (j * 8);
+		}
+	}
+	nshifts = 0;
+	for ( i = 0; i < 7; ++i ) {
+		if ( masks[i] ) {
+			shifts[nshifts] = (i - 3) * 8;
+			vmask[nshifts] = _mm_set1_epi32(masks[i]);
+			vcount[nshifts] = _mm_cvtsi32_si128(shifts[nshifts] < 0 ? -shifts[nshifts] : shifts[nshifts]);
+			++nshifts;
+		}
+	}
+	vfill = _mm_set1_epi32(sw.fill);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 4 ) {
+			__m128i s = _mm_loadu_si128((const __m128i *)src);
+			__m128i d = vfill;
+			for ( i = 0; i < nshifts; ++i ) {
+				__m128i t;
+				if ( shifts[i] < 0 ) {
+					t = _mm_srl_epi32(s, vcount[i]);
+				} else {
+					t = _mm_sll_epi32(s, vcount[i]);
+				}
+				d = _mm_or_si128(d, _mm_and_si128(t, vmask[i]));
+			}
+			_mm_storeu_si128((__m128i *)dst, d);
+			src += 16;
+			dst += 16;
+			n -= 4;
+		}
+		while ( n-- ) {
+			Swizzle4to4Pixel(src, dst, &sw);
+			src += 4;
+			dst += 4;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+SDL_TARGET_SSSE3
+static void Blit4to4SSSE3(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	Blit4to4Swizzle sw;
+	__m128i vshuffle, vfill;
+
+	Calc4to4Swizzle(info->src, info->dst, &sw);
+	vshuffle = _mm_loadu_si128((const __m128i *)sw.shuffle);
+	vfill = _mm_set1_epi32(sw.fill);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m128i s0 = _mm_loadu_si128((const __m128i *)src);
+			__m128i s1 = _mm_loadu_si128((const __m128i *)(src + 16));
+			s0 = _mm_or_si128(_mm_shuffle_epi8(s0, vshuffle), vfill);
+			s1 = _mm_or_si128(_mm_shuffle_epi8(s1, vshuffle), vfill);
+			_mm_storeu_si128((__m128i *)dst, s0);
+			_mm_storeu_si128((__m128i *)(dst + 16), s1);
+			src += 32;
+			dst += 32;
+			n -= 8;
+		}
+		if ( n >= 4 ) {
+			__m128i s = _mm_loadu_si128((const __m128i *)src);
+			s = _mm_or_si128(_mm_shuffle_epi8(s, vshuffle), vfill);
+			_mm_storeu_si128((__m128i *)dst, s);
+			src += 16;
+			dst += 16;
+			n -= 4;
+		}
+		while ( n-- ) {
+			Swizzle4to4Pixel(src, dst, &sw);
+			src += 4;
+			dst += 4;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static void Blit4to4AVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	Blit4to4Swizzle sw;
+	__m256i vshuffle, vfill;
+
+	Calc4to4Swizzle(info->src, info->dst, &sw);
+	/* vpshufb works within 128-bit lanes, so the same mask serves both */
+	vshuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)sw.shuffle));
+	vfill = _mm256_set1_epi32(sw.fill);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 16 ) {
+			__m256i s0 = _mm256_loadu_si256((const __m256i *)src);
+			__m256i s1 = _mm256_loadu_si256((const __m256i *)(src + 32));
+			s0 = _mm256_or_si256(_mm256_shuffle_epi8(s0, vshuffle), vfill);
+			s1 = _mm256_or_si256(_mm256_shuffle_epi8(s1, vshuffle), vfill);
+			_mm256_storeu_si256((__m256i *)dst, s0);
+			_mm256_storeu_si256((__m256i *)(dst + 32), s1);
+			src += 64;
+			dst += 64;
+			n -= 16;
+		}
+		if ( n >= 8 ) {
+			__m256i s = _mm256_loadu_si256((const __m256i *)src);
+			s = _mm256_or_si256(_mm256_shuffle_epi8(s, vshuffle), vfill);
+			_mm256_storeu_si256((__m256i *)dst, s);
+			src += 32;
+			dst += 32;
+			n -= 8;
+		}
+		while ( n-- ) {
+			Swizzle4to4Pixel(src, dst, &sw);
+			src += 4;
+			dst += 4;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+	_mm256_zeroupper();
+}
+
+/* RGB 8-8-8 --> RGB 5-6-5 / 5-5-5, eight or sixteen pixels at a time.
+   The 16-bit results are sign extended so the signed pack keeps them. */
+#define RGB888_RGB16_SHIFTS(is565) \
+	((is565) ? 8 : 9), ((is565) ? 0xF800 : 0x7C00), \
+	((is565) ? 5 : 6), ((is565) ? 0x07E0 : 0x03E0)
+
+SDL_TARGET_SSE2
+static __inline__ __m128i RGB888_RGB16_SSE2(__m128i s, int rs, int rm, int gs, int gm)
+{
+	__m128i d;
+	d = _mm_and_si128(_mm_srli_epi32(s, rs), _mm_set1_epi32(rm));
+	d = _mm_or_si128(d, _mm_and_si128(_mm_srli_epi32(s, gs), _mm_set1_epi32(gm)));
+	d = _mm_or_si128(d, _mm_and_si128(_mm_srli_epi32(s, 3), _mm_set1_epi32(0x001F)));
+	return _mm_srai_epi32(_mm_slli_epi32(d, 16), 16);
+}
+
+SDL_TARGET_AVX2
+static __inline__ __m256i RGB888_RGB16_AVX2(__m256i s, int rs, int rm, int gs, int gm)
+{
+	__m256i d;
+	d = _mm256_and_si256(_mm256_srli_epi32(s, rs), _mm256_set1_epi32(rm));
+	d = _mm256_or_si256(d, _mm256_and_si256(_mm256_srli_epi32(s, gs), _mm256_set1_epi32(gm)));
+	d = _mm256_or_si256(d, _mm256_and_si256(_mm256_srli_epi32(s, 3), _mm256_set1_epi32(0x001F)));
+	return _mm256_srai_epi32(_mm256_slli_epi32(d, 16), 16);
+}
+
+#define RGB888_RGB16_PIXEL(dst, src, rs, rm, gs, gm) \
+	*(dst) = (Uint16)((((*(src))>>(rs))&(rm)) | (((*(src))>>(gs))&(gm)) | (((*(src))>>3)&0x001F))
+
+SDL_TARGET_SSE2
+static __inline__ void Blit_RGB888_RGB16SSE2(SDL_BlitInfo *info, int rs, int rm, int gs, int gm)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *src = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip/4;
+	Uint16 *dst = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip/2;
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m128i s0 = _mm_loadu_si128((const __m128i *)src);
+			__m128i s1 = _mm_loadu_si128((const __m128i *)(src + 4));
+			s0 = RGB888_RGB16_SSE2(s0, rs, rm, gs, gm);
+			s1 = RGB888_RGB16_SSE2(s1, rs, rm, gs, gm);
+			_mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(s0, s1));
+			src += 8;
+			dst += 8;
+			n -= 8;
+		}
+		while ( n-- ) {
+			RGB888_RGB16_PIXEL(dst, src, rs, rm, gs, gm);
+			++src;
+			++dst;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static __inline__ void Blit_RGB888_RGB16AVX2(SDL_BlitInfo *info, int rs, int rm, int gs, int gm)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *src = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip/4;
+	Uint16 *dst = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip/2;
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 16 ) {
+			__m256i s0 = _mm256_loadu_si256((const __m256i *)src);
+			__m256i s1 = _mm256_loadu_si256((const __m256i *)(src + 8));
+			__m256i d;
+			s0 = RGB888_RGB16_AVX2(s0, rs, rm, gs, gm);
+			s1 = RGB888_RGB16_AVX2(s1, rs, rm, gs, gm);
+			/* the pack interleaves 128-bit lanes, put them back in order */
+			d = _mm256_permute4x64_epi64(_mm256_packs_epi32(s0, s1), 0xD8);
+			_mm256_storeu_si256((__m256i *)dst, d);
+			src += 16;
+			dst += 16;
+			n -= 16;
+		}
+		while ( n-- ) {
+			RGB888_RGB16_PIXEL(dst, src, rs, rm, gs, gm);
+			++src;
+			++dst;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+	_mm256_zeroupper();
+}
+
+SDL_TARGET_SSE2
+static void Blit_RGB888_RGB565SSE2(SDL_BlitInfo *info)
+{
+	Blit_RGB888_RGB16SSE2(info, RGB888_RGB16_SHIFTS(1));
+}
+
+SDL_TARGET_SSE2
+static void Blit_RGB888_RGB555SSE2(SDL_BlitInfo *info)
+{
+	Blit_RGB888_RGB16SSE2(info, RGB888_RGB16_SHIFTS(0));
+}
+
+SDL_TARGET_AVX2
+static void Blit_RGB888_RGB565AVX2(SDL_BlitInfo *info)
+{
+	Blit_RGB888_RGB16AVX2(info, RGB888_RGB16_SHIFTS(1));
+}
+
+SDL_TARGET_AVX2
+static void Blit_RGB888_RGB555AVX2(SDL_BlitInfo *info)
+{
+	Blit_RGB888_RGB16AVX2(info, RGB888_RGB16_SHIFTS(0));
+}
+
+/* RGB 5-6-5 --> 8888 RGB, giving exactly what the RGB565_*_LUT tables do:
+   each channel is scaled by 255/31 or 255/63 and truncated, and green is
+   the sum of its top three and bottom three bits scaled separately, as the
+   tables add one entry for each source byte. The unused byte is all ones. */
+#define RGB565_32_PIXEL(p, fmt, fill) \
+	(((((p) >> 11) * 255 / 31) << (fmt)->Rshift) | \
+	 (((((p) >> 5) & 0x38) * 255 / 63 + (((p) >> 5) & 0x07) * 255 / 63) << (fmt)->Gshift) | \
+	 ((((p) & 0x1F) * 255 / 31) << (fmt)->Bshift) | \
+	 (fill))
+
+/* x * 255 / 31 and x * 255 / 63 for the 16-bit lanes of v, exact over the
+   range used here */
+#define SCALE31_SSE2(v) \
+	_mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(v, _mm_set1_epi16(255)), _mm_set1_epi16(8457)), 2)
+#define SCALE63_SSE2(v) \
+	_mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(v, _mm_set1_epi16(255)), _mm_set1_epi16(16645)), 4)
+#define SCALE31_AVX2(v) \
+	_mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_mullo_epi16(v, _mm256_set1_epi16(255)), _mm256_set1_epi16(8457)), 2)
+#define SCALE63_AVX2(v) \
+	_mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_mullo_epi16(v, _mm256_set1_epi16(255)), _mm256_set1_epi16(16645)), 4)
+
+/* Expand eight 5-6-5 pixels to 8-bit channels in 16-bit lanes */
+SDL_TARGET_SSE2
+static __inline__ void RGB565_Expand_SSE2(__m128i p, __m128i *r, __m128i *g, __m128i *b)
+{
+	__m128i gg = _mm_srli_epi16(p, 5);
+	*r = SCALE31_SSE2(_mm_srli_epi16(p, 11));
+	*g = _mm_add_epi16(SCALE63_SSE2(_mm_and_si128(gg, _mm_set1_epi16(0x38))),
+	                   SCALE63_SSE2(_mm_and_si128(gg, _mm_set1_epi16(0x07))));
+	*b = SCALE31_SSE2(_mm_and_si128(p, _mm_set1_epi16(0x1F)));
+}
+
+SDL_TARGET_AVX2
+static __inline__ void RGB565_Expand_AVX2(__m256i p, __m256i *r, __m256i *g, __m256i *b)
+{
+	__m256i gg = _mm256_srli_epi16(p, 5);
+	*r = SCALE31_AVX2(_mm256_srli_epi16(p, 11));
+	*g = _mm256_add_epi16(SCALE63_AVX2(_mm256_and_si256(gg, _mm256_set1_epi16(0x38))),
+	                      SCALE63_AVX2(_mm256_and_si256(gg, _mm256_set1_epi16(0x07))));
+	*b = SCALE31_AVX2(_mm256_and_si256(p, _mm256_set1_epi16(0x1F)));
+}
+
+/* Place 8-bit channels, zero extended to 32 bits, at their shifts */
+SDL_TARGET_SSE2
+static __inline__ __m128i RGB565_32_Place_SSE2(__m128i r, __m128i g, __m128i b,
+                                               const __m128i *counts, __m128i fill)
+{
+	r = _mm_sll_epi32(r, counts[0]);
+	g = _mm_sll_epi32(g, counts[1]);
+	b = _mm_sll_epi32(b, counts[2]);
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, fill));
+}
+
+SDL_TARGET_AVX2
+static __inline__ __m256i RGB565_32_Place_AVX2(__m256i r, __m256i g, __m256i b,
+                                               const __m128i *counts, __m256i fill)
+{
+	r = _mm256_sll_epi32(r, counts[0]);
+	g = _mm256_sll_epi32(g, counts[1]);
+	b = _mm256_sll_epi32(b, counts[2]);
+	return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, fill));
+}
+
+SDL_TARGET_SSE2
+static void Blit_RGB565_32SSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *src = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip/2;
+	Uint32 *dst = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip/4;
+	SDL_PixelFormat *dstfmt = info->dst;
+	Uint32 fill = ~(dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask);
+	__m128i counts[3], vfill, zero;
+
+	counts[0] = _mm_cvtsi32_si128(dstfmt->Rshift);
+	counts[1] = _mm_cvtsi32_si128(dstfmt->Gshift);
+	counts[2] = _mm_cvtsi32_si128(dstfmt->Bshift);
+	vfill = _mm_set1_epi32(fill);
+	zero = _mm_setzero_si128();
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 8 ) {
+			__m128i r, g, b, lo, hi;
+			RGB565_Expand_SSE2(_mm_loadu_si128((const __m128i *)src), &r, &g, &b);
+			lo = RGB565_32_Place_SSE2(_mm_unpacklo_epi16(r, zero),
+			                          _mm_unpacklo_epi16(g, zero),
+			                          _mm_unpacklo_epi16(b, zero), counts, vfill);
+			hi = RGB565_32_Place_SSE2(_mm_unpackhi_epi16(r, zero),
+			                          _mm_unpackhi_epi16(g, zero),
+			                          _mm_unpackhi_epi16(b, zero), counts, vfill);
+			_mm_storeu_si128((__m128i *)dst, lo);
+			_mm_storeu_si128((__m128i *)(dst + 4), hi);
+			src += 8;
+			dst += 8;
+			n -= 8;
+		}
+		while ( n-- ) {
+			Uint32 p = *src++;
+			*dst++ = RGB565_32_PIXEL(p, dstfmt, fill);
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+SDL_TARGET_AVX2
+static void Blit_RGB565_32AVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *src = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip/2;
+	Uint32 *dst = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip/4;
+	SDL_PixelFormat *dstfmt = info->dst;
+	Uint32 fill = ~(dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask);
+	__m128i counts[3];
+	__m256i vfill;
+
+	counts[0] = _mm_cvtsi32_si128(dstfmt->Rshift);
+	counts[1] = _mm_cvtsi32_si128(dstfmt->Gshift);
+	counts[2] = _mm_cvtsi32_si128(dstfmt->Bshift);
+	vfill = _mm256_set1_epi32(fill);
+
+	while ( height-- ) {
+		int n = width;
+		while ( n >= 16 ) {
+			__m256i r, g, b, d0, d1;
+			RGB565_Expand_AVX2(_mm256_loadu_si256((const __m256i *)src), &r, &g, &b);
+			d0 = RGB565_32_Place_AVX2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(r)),
+			                          _mm256_cvtepu16_epi32(_mm256_castsi256_si128(g)),
+			                          _mm256_cvtepu16_epi32(_mm256_castsi256_si128(b)),
+			                          counts, vfill);
+			d1 = RGB565_32_Place_AVX2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1)),
+			                          _mm256_cvtepu16_epi32(_mm256_extracti128_si256(g, 1)),
+			                          _mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1)),
+			                          counts, vfill);
+			_mm256_storeu_si256((__m256i *)dst, d0);
+			_mm256_storeu_si256((__m256i *)(dst + 8), d1);
+			src += 16;
+			dst += 16;
+			n -= 16;
+		}
+		while ( n-- ) {
+			Uint32 p = *src++;
+			*dst++ = RGB565_32_PIXEL(p, dstfmt, fill);
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+	_mm256_zeroupper();
+}
+#endif /* SDL_X86_SIMD_BLITTERS */
+
 /* Normal N to N optimized blitters */
 struct blit_table {
 	Uint32 srcR, srcG, srcB;
@@ -3055,9 +3544,28 @@ struct blit_table {
 };
 static const struct blit_table normal_blit_1[] = {
 	/* Default for 8-bit RGB source, an invalid combination */
-	{ 0,0,0, 0, 0,0,0, 0, NULL, NULL },
+	{ 0,0,0, 0, 0,0,0, 0, NULL, NULL, 0 },
 };
 static const struct blit_table normal_blit_2[] = {
+#if SDL_X86_SIMD_BLITTERS
+    /* the formats of the RGB565_*_LUT blitters below, with the same results */
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB565_32AVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x000000FF,0x0000FF00,0x00FF0000,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB565_32AVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0xFF000000,0x00FF0000,0x0000FF00,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB565_32AVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x0000FF00,0x00FF0000,0xFF000000,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB565_32AVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB565_32SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x000000FF,0x0000FF00,0x00FF0000,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB565_32SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0xFF000000,0x00FF0000,0x0000FF00,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB565_32SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x0000FF00,0x00FF0000,0xFF000000,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB565_32SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
 #if SDL_HERMES_BLITTERS
     { 0x0000F800,0x000007E0,0x0000001F, 2, 0x0000001F,0x000007E0,0x0000F800,
       0, ConvertX86p16_16BGR565, ConvertX86, NO_ALPHA },
@@ -3124,6 +3632,23 @@ static const struct blit_table normal_blit_3[] = {
     { 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
 };
 static const struct blit_table normal_blit_4[] = {
+#if SDL_X86_SIMD_BLITTERS
+    /* any byte aligned 32-bit swizzle, by shuffle or by byte shifts */
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_AVX2 | BLIT_FEATURE_BYTE_ALIGNED_32, NULL, Blit4to4AVX2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSSE3 | BLIT_FEATURE_BYTE_ALIGNED_32, NULL, Blit4to4SSSE3, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      BLIT_FEATURE_HAS_SSE2 | BLIT_FEATURE_BYTE_ALIGNED_32, NULL, Blit4to4SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB888_RGB565AVX2, NO_ALPHA },
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB888_RGB565SSE2, NO_ALPHA },
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x00007C00,0x000003E0,0x0000001F,
+      BLIT_FEATURE_HAS_AVX2, NULL, Blit_RGB888_RGB555AVX2, NO_ALPHA },
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x00007C00,0x000003E0,0x0000001F,
+      BLIT_FEATURE_HAS_SSE2, NULL, Blit_RGB888_RGB555SSE2, NO_ALPHA },
+#endif
 #if SDL_HERMES_BLITTERS
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
       BLIT_FEATURE_HAS_MMX, ConvertMMXpII32_16RGB565, ConvertMMX, NO_ALPHA },
@@ -3207,6 +3732,16 @@ static const struct blit_table *normal_blit[] = {
 /* Mask matches table, or table entry is zero */
 #define MASKOK(x, y) (((x) == (y)) || ((y) == 0x00000000))
 
+/* 32-bit formats whose channels, alpha included, all sit on byte boundaries */
+static int Is32BitByteAligned(const SDL_PixelFormat *fmt)
+{
+	return (fmt->BytesPerPixel == 4 &&
+	        fmt->Rshift % 8 == 0 && fmt->Rloss == 0 &&
+	        fmt->Gshift % 8 == 0 && fmt->Gloss == 0 &&
+	        fmt->Bshift % 8 == 0 && fmt->Bloss == 0 &&
+	        (!fmt->Amask || (fmt->Ashift % 8 == 0 && fmt->Aloss == 0)));
+}
+
 SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 {
 	struct private_swaccel *sdata;
@@ -3278,8 +3813,11 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	} else {
 		/* Now the meat, choose the blitter we want */
 		Uint32 a_need = NO_ALPHA;
+		Uint32 features = GetBlitFeatures();
 		if(dstfmt->Amask)
 		    a_need = srcfmt->Amask ? COPY_ALPHA : SET_ALPHA;
+		if(Is32BitByteAligned(srcfmt) && Is32BitByteAligned(dstfmt))
+		    features |= BLIT_FEATURE_BYTE_ALIGNED_32;
 		table = normal_blit[srcfmt->BytesPerPixel-1];
 		for ( which=0; table[which].dstbpp; ++which ) {
 			if ( MASKOK(srcfmt->Rmask, table[which].srcR) &&
@@ -3290,7 +3828,7 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 			    MASKOK(dstfmt->Bmask, table[which].dstB) &&
 			    dstfmt->BytesPerPixel == table[which].dstbpp &&
 			    (a_need & table[which].alpha) == a_need &&
-			    ((table[which].blit_features & GetBlitFeatures()) == table[which].blit_features) )
+			    ((table[which].blit_features & features) == table[which].blit_features) )
 				break;
 		}
 		sdata->aux_data = table[which].aux_data;
@@ -24,7 +24,9 @@
 /* General (mostly internal) pixel/color manipulation routines for SDL */
 
 #include "SDL_endian.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_video.h"
+#include "SDL_mutex.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
@@ -252,6 +254,7 @@ void SDL_FreeFormat(SDL_PixelFormat *format)
 {
 	if ( format ) {
 		if ( format->palette ) {
+			SDL_InvalidateInverseMap(format->palette);
 			if ( format->palette->colors ) {
 				SDL_free(format->palette->colors);
 			}
@@ -336,9 +339,46 @@ Uint16 SDL_CalculatePitch(SDL_Surface *surface)
 	return((Uint16)pitch);
 }
 /*
- * Match an RGB value to a particular palette index
+ * Nearest colour lookups go through a small cache of inverse colour maps.
+ * The RGB cube is cut into 16x16x16 cells, and the first lookup in a cell
+ * lists the palette entries that can be nearest to any colour inside it,
+ * so later lookups there only compare against those few.  The answer is
+ * always the one a full search of the palette gives.
+ *
+ * Each map keeps a copy of its palette and is rebuilt when the palette
+ * no longer matches it, so palettes written in place are still mapped
+ * right.  SDL_InvalidateInverseMap() drops the map of a palette that is
+ * being freed, so a new palette at the same address can't match it.
+ *
+ * Every map has its own lock, so threads mapping colours on different
+ * palettes don't wait for each other; the cache lock is only taken to
+ * hand a map over to another palette.  The locks are made by SDL_Init(),
+ * and until then every lookup searches the whole palette.
  */
-Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+#define INVMAP_CELL_BITS	4
+#define INVMAP_CELLS		(1 << (3*INVMAP_CELL_BITS))
+#define INVMAP_CACHE_SIZE	4
+
+typedef struct {
+	SDL_Palette *pal;
+	int ncolors;
+	Uint32 stamp;			/* last use, for replacement */
+	SDL_Color colors[256];
+	Sint16 r[256], g[256], b[256];	/* colors split for the cell search */
+	Uint32 cell_start[INVMAP_CELLS];
+	Uint16 cell_count[INVMAP_CELLS];	/* 0 if not listed yet */
+	Uint8 *list;
+	int list_len;
+	int list_size;
+} SDL_InverseMap;
+
+static SDL_InverseMap *inverse_maps[INVMAP_CACHE_SIZE];
+static SDL_mutex *inverse_map_locks[INVMAP_CACHE_SIZE];	/* one per map */
+static Uint32 inverse_map_stamp = 0;
+static SDL_mutex *inverse_map_lock = NULL;
+
+/* Plain search of the whole palette */
+static Uint8 FindColorFull(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
 {
 	/* Do colorspace distance matching */
 	unsigned int smallest;
@@ -364,6 +404,358 @@ Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
 	return(pixel);
 }
 
+/* Closest and farthest squared distance from each palette entry to a cell
+   spanning lo..hi on every axis, eight entries at a time */
+static void CellDistances(SDL_InverseMap *map, const int *lo, const int *hi,
+                          Uint32 *mind, Uint32 *maxd)
+{
+	int i, k;
+
+	for ( i = 0; i < map->ncolors; ++i ) {
+		int c[3];
+		Uint32 dmin = 0, dmax = 0;
+
+		c[0] = map->r[i];
+		c[1] = map->g[i];
+		c[2] = map->b[i];
+		for ( k = 0; k < 3; ++k ) {
+			int below = lo[k] - c[k];
+			int above = c[k] - hi[k];
+			int near = (below > 0) ? below : (above > 0) ? above : 0;
+			int away = (-below > -above) ? -below : -above;
+
+			dmin += near*near;
+			dmax += away*away;
+		}
+		mind[i] = dmin;
+		maxd[i] = dmax;
+	}
+}
+
+#if SDL_X86_SIMD_BLITTERS
+#include <emmintrin.h>
+
+SDL_TARGET_SSE2
+static void CellDistancesSSE2(SDL_InverseMap *map, const int *lo, const int *hi,
+                              Uint32 *mind, Uint32 *maxd)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lo_r = _mm_set1_epi16(lo[0]), hi_r = _mm_set1_epi16(hi[0]);
+	const __m128i lo_g = _mm_set1_epi16(lo[1]), hi_g = _mm_set1_epi16(hi[1]);
+	const __m128i lo_b = _mm_set1_epi16(lo[2]), hi_b = _mm_set1_epi16(hi[2]);
+	int i;
+
+	/* The split colours are padded out to a multiple of eight */
+	for ( i = 0; i < map->ncolors; i += 8 ) {
+		__m128i r = _mm_loadu_si128((const __m128i *)&map->r[i]);
+		__m128i g = _mm_loadu_si128((const __m128i *)&map->g[i]);
+		__m128i b = _mm_loadu_si128((const __m128i *)&map->b[i]);
+		__m128i nr, ng, nb, fr, fg, fb, rg;
+
+		nr = _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(lo_r, r),
+		                                 _mm_sub_epi16(r, hi_r)), zero);
+		ng = _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(lo_g, g),
+		                                 _mm_sub_epi16(g, hi_g)), zero);
+		nb = _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(lo_b, b),
+		                                 _mm_sub_epi16(b, hi_b)), zero);
+		fr = _mm_max_epi16(_mm_sub_epi16(r, lo_r), _mm_sub_epi16(hi_r, r));
+		fg = _mm_max_epi16(_mm_sub_epi16(g, lo_g), _mm_sub_epi16(hi_g, g));
+		fb = _mm_max_epi16(_mm_sub_epi16(b, lo_b), _mm_sub_epi16(hi_b, b));
+
+		/* Pair up r and g (and b with 0) so madd squares and sums them */
+		rg = _mm_unpacklo_epi16(nr, ng);
+		_mm_storeu_si128((__m128i *)&mind[i], _mm_add_epi32(
+			_mm_madd_epi16(rg, rg),
+			_mm_madd_epi16(_mm_unpacklo_epi16(nb, zero),
+			               _mm_unpacklo_epi16(nb, zero))));
+		rg = _mm_unpackhi_epi16(nr, ng);
+		_mm_storeu_si128((__m128i *)&mind[i+4], _mm_add_epi32(
+			_mm_madd_epi16(rg, rg),
+			_mm_madd_epi16(_mm_unpackhi_epi16(nb, zero),
+			               _mm_unpackhi_epi16(nb, zero))));
+		rg = _mm_unpacklo_epi16(fr, fg);
+		_mm_storeu_si128((__m128i *)&maxd[i], _mm_add_epi32(
+			_mm_madd_epi16(rg, rg),
+			_mm_madd_epi16(_mm_unpacklo_epi16(fb, zero),
+			               _mm_unpacklo_epi16(fb, zero))));
+		rg = _mm_unpackhi_epi16(fr, fg);
+		_mm_storeu_si128((__m128i *)&maxd[i+4], _mm_add_epi32(
+			_mm_madd_epi16(rg, rg),
+			_mm_madd_epi16(_mm_unpackhi_epi16(fb, zero),
+			               _mm_unpackhi_epi16(fb, zero))));
+	}
+}
+#endif /* SDL_X86_SIMD_BLITTERS */
+
+/* List the entries that can be nearest to some colour in a cell: those
+   no farther away at their closest than the best entry at its farthest */
+static int ListCell(SDL_InverseMap *map, int cell)
+{
+	Uint32 mind[256], maxd[256];
+	Uint32 limit;
+	int lo[3], hi[3];
+	int i, k, n;
+
+	lo[0] = (cell >> (2*INVMAP_CELL_BITS)) << (8-INVMAP_CELL_BITS);
+	lo[1] = ((cell >> INVMAP_CELL_BITS) & ((1<<INVMAP_CELL_BITS)-1))
+	                                   << (8-INVMAP_CELL_BITS);
+	lo[2] = (cell & ((1<<INVMAP_CELL_BITS)-1)) << (8-INVMAP_CELL_BITS);
+	for ( k = 0; k < 3; ++k ) {
+		hi[k] = lo[k] + (1 << (8-INVMAP_CELL_BITS)) - 1;
+	}
+#if SDL_X86_SIMD_BLITTERS
+	if ( SDL_HasSSE2() ) {
+		CellDistancesSSE2(map, lo, hi, mind, maxd);
+	} else {
+		CellDistances(map, lo, hi, mind, maxd);
+	}
+#else
+	CellDistances(map, lo, hi, mind, maxd);
+#endif
+
+	limit = ~0;
+	for ( i = 0; i < map->ncolors; ++i ) {
+		if ( maxd[i] < limit ) {
+			limit = maxd[i];
+		}
+	}
+	n = 0;
+	for ( i = 0; i < map->ncolors; ++i ) {
+		n += (mind[i] <= limit);
+	}
+	if ( map->list_len + n > map->list_size ) {
+		int size = map->list_size ? map->list_size * 2 : 4096;
+		Uint8 *list;
+
+		while ( size < map->list_len + n ) {
+			size *= 2;
+		}
+		list = (Uint8 *)SDL_realloc(map->list, size);
+		if ( list == NULL ) {
+			return(-1);
+		}
+		map->list = list;
+		map->list_size = size;
+	}
+
+	/* Kept in palette order so ties go to the lowest index as before */
+	map->cell_start[cell] = map->list_len;
+	for ( i = 0; i < map->ncolors; ++i ) {
+		if ( mind[i] <= limit ) {
+			map->list[map->list_len++] = (Uint8)i;
+		}
+	}
+	map->cell_count[cell] = (Uint16)n;
+	return(0);
+}
+
+/* Copy a palette into a map, forgetting the cells listed before */
+static void ResetInverseMap(SDL_InverseMap *map, SDL_Palette *pal)
+{
+	int i;
+
+	map->ncolors = pal->ncolors;
+	map->list_len = 0;
+	SDL_memcpy(map->colors, pal->colors, pal->ncolors * sizeof(SDL_Color));
+	SDL_memset(map->cell_count, 0, sizeof(map->cell_count));
+	for ( i = 0; i < 256; ++i ) {
+		/* Pad with copies of the last entry, they're never listed */
+		const SDL_Color *c = &pal->colors[(i < pal->ncolors) ? i : pal->ncolors-1];
+
+		map->r[i] = c->r;
+		map->g[i] = c->g;
+		map->b[i] = c->b;
+	}
+}
+
+/* Find the map of a palette and lock it.  The unlocked look at the slots
+   is only a hint, it is checked again with the map locked.
+ */
+static int LockInverseMap(SDL_Palette *pal)
+{
+	int i;
+
+	for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+		if ( inverse_maps[i] && inverse_maps[i]->pal == pal ) {
+			SDL_mutexP(inverse_map_locks[i]);
+			if ( inverse_maps[i] && inverse_maps[i]->pal == pal ) {
+				return(i);
+			}
+			SDL_mutexV(inverse_map_locks[i]);
+		}
+	}
+	return(-1);
+}
+
+/* Find (or make) the inverse map for a palette, returning its slot locked */
+static int GetInverseMap(SDL_Palette *pal)
+{
+	SDL_InverseMap *map;
+	int i, slot;
+
+	slot = LockInverseMap(pal);
+	if ( slot < 0 ) {
+		SDL_mutexP(inverse_map_lock);
+		/* Another thread may have made it in the meantime */
+		slot = LockInverseMap(pal);
+		if ( slot < 0 ) {
+			/* Take over an unused or the least recently used map */
+			slot = 0;
+			for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+				if ( !inverse_maps[i] ) {
+					slot = i;
+					break;
+				}
+				if ( inverse_maps[i]->stamp < inverse_maps[slot]->stamp ) {
+					slot = i;
+				}
+			}
+			SDL_mutexP(inverse_map_locks[slot]);
+			map = inverse_maps[slot];
+			if ( !map ) {
+				map = (SDL_InverseMap *)SDL_calloc(1, sizeof(*map));
+				if ( !map ) {
+					SDL_mutexV(inverse_map_locks[slot]);
+					SDL_mutexV(inverse_map_lock);
+					return(-1);
+				}
+				inverse_maps[slot] = map;
+			}
+			map->pal = pal;
+			map->ncolors = 0;
+		}
+		SDL_mutexV(inverse_map_lock);
+	}
+
+	map = inverse_maps[slot];
+	if ( map->ncolors != pal->ncolors ||
+	     SDL_memcmp(map->colors, pal->colors,
+	                pal->ncolors * sizeof(SDL_Color)) != 0 ) {
+		ResetInverseMap(map, pal);
+	}
+	/* Not atomic, but it only guides which map is replaced */
+	map->stamp = ++inverse_map_stamp;
+	return(slot);
+}
+
+/* Forget any inverse map of a palette that changed or is going away */
+void SDL_InvalidateInverseMap(SDL_Palette *pal)
+{
+	int i;
+
+	if ( !pal || !inverse_map_lock ) {
+		return;
+	}
+	SDL_mutexP(inverse_map_lock);
+	for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+		if ( inverse_maps[i] && inverse_maps[i]->pal == pal ) {
+			SDL_mutexP(inverse_map_locks[i]);
+			inverse_maps[i]->pal = NULL;
+			inverse_maps[i]->ncolors = 0;
+			SDL_mutexV(inverse_map_locks[i]);
+		}
+	}
+	SDL_mutexV(inverse_map_lock);
+}
+
+void SDL_InitInverseMaps(void)
+{
+	int i;
+
+	if ( inverse_map_lock ) {
+		return;
+	}
+	for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+		inverse_map_locks[i] = SDL_CreateMutex();
+		if ( !inverse_map_locks[i] ) {
+			while ( i-- > 0 ) {
+				SDL_DestroyMutex(inverse_map_locks[i]);
+				inverse_map_locks[i] = NULL;
+			}
+			return;
+		}
+	}
+	inverse_map_lock = SDL_CreateMutex();
+	if ( !inverse_map_lock ) {
+		for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+			SDL_DestroyMutex(inverse_map_locks[i]);
+			inverse_map_locks[i] = NULL;
+		}
+	}
+}
+
+void SDL_FreeInverseMaps(void)
+{
+	int i;
+
+	for ( i = 0; i < INVMAP_CACHE_SIZE; ++i ) {
+		if ( inverse_maps[i] ) {
+			SDL_free(inverse_maps[i]->list);
+			SDL_free(inverse_maps[i]);
+			inverse_maps[i] = NULL;
+		}
+		if ( inverse_map_locks[i] ) {
+			SDL_DestroyMutex(inverse_map_locks[i]);
+			inverse_map_locks[i] = NULL;
+		}
+	}
+	if ( inverse_map_lock ) {
+		SDL_DestroyMutex(inverse_map_lock);
+		inverse_map_lock = NULL;
+	}
+}
+
+/*
+ * Match an RGB value to a particular palette index
+ */
+Uint8 SDL_FindColor(SDL_Palette *pal, Uint8 r, Uint8 g, Uint8 b)
+{
+	SDL_InverseMap *map;
+	const Uint8 *list;
+	unsigned int smallest;
+	unsigned int distance;
+	int rd, gd, bd;
+	int slot, cell, i, n;
+	Uint8 pixel=0;
+
+	if ( pal->ncolors <= 0 || pal->ncolors > 256 || !inverse_map_lock ) {
+		return FindColorFull(pal, r, g, b);
+	}
+	slot = GetInverseMap(pal);
+	if ( slot < 0 ) {
+		return FindColorFull(pal, r, g, b);
+	}
+	map = inverse_maps[slot];
+	cell = ((r >> (8-INVMAP_CELL_BITS)) << (2*INVMAP_CELL_BITS)) |
+	       ((g >> (8-INVMAP_CELL_BITS)) << INVMAP_CELL_BITS) |
+	        (b >> (8-INVMAP_CELL_BITS));
+	if ( !map->cell_count[cell] && ListCell(map, cell) < 0 ) {
+		SDL_mutexV(inverse_map_locks[slot]);
+		return FindColorFull(pal, r, g, b);
+	}
+
+	list = map->list + map->cell_start[cell];
+	n = map->cell_count[cell];
+	smallest = ~0;
+	for ( i=0; i<n; ++i ) {
+		const SDL_Color *c = &map->colors[list[i]];
+
+		rd = c->r - r;
+		gd = c->g - g;
+		bd = c->b - b;
+		distance = (rd*rd)+(gd*gd)+(bd*bd);
+		if ( distance < smallest ) {
+			pixel = list[i];
+			if ( distance == 0 ) { /* Perfect match! */
+				break;
+			}
+			smallest = distance;
+		}
+	}
+	SDL_mutexV(inverse_map_locks[slot]);
+	return(pixel);
+}
+
 /* Find the opaque pixel value corresponding to an RGB triple */
 Uint32 SDL_MapRGB
 (const SDL_PixelFormat * const format,
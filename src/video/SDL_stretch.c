@@ -28,6 +28,8 @@
 */
 
 #include "SDL_video.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mutex.h"
 #include "SDL_blit.h"
 
 /* This isn't ready for general consumption yet - it should be folded
@@ -35,10 +37,9 @@
 */
 
 #if ((defined(_MSC_VER) && defined(_M_IX86)) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/*#define USE_ASM_STRETCH*/
+     (defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)))) && \
+    SDL_ASSEMBLY_ROUTINES
+#define USE_ASM_STRETCH
 #endif
 
 #ifdef USE_ASM_STRETCH
@@ -69,17 +70,34 @@
 #define LOAD_WORD	0xAD
 #define RETURN		0xC3
 
-static PAGE_ALIGNED unsigned char copy_row[4096];
-
-static int generate_rowbytes(int src_w, int dst_w, int bpp)
+/* The generated row copiers only use lods/stos, which encode the same
+   way on i386 and x86_64, so one code generator serves both.
+
+   Generated code is kept in a small cache keyed by the stretch geometry
+   so that alternating between a few sizes doesn't regenerate it every
+   time.  A slot is never rewritten while a stretch is running it; if
+   every slot is busy the C copiers are used instead.  The lock on the
+   slots is created by SDL_Init(), and until then the C copiers are used.
+ */
+#define COPY_ROW_SLOTS	8
+#define COPY_ROW_SIZE	16384	/* a multiple of the page size */
+
+typedef struct {
+	int bpp;
+	int src_w;
+	int dst_w;
+	int status;
+	int refcount;
+	Uint32 last_used;
+} copy_row_key;
+
+static PAGE_ALIGNED unsigned char copy_rows[COPY_ROW_SLOTS][COPY_ROW_SIZE];
+static copy_row_key copy_row_keys[COPY_ROW_SLOTS];
+static Uint32 copy_row_clock = 0;
+static SDL_mutex *copy_row_lock = NULL;
+
+static int generate_rowbytes(unsigned char *copy_row, int src_w, int dst_w, int bpp)
 {
-	static struct {
-		int bpp;
-		int src_w;
-		int dst_w;
-		int status;
-	} last;
-
 	int i;
 	int pos, inc;
 	unsigned char *eip, *fence;
@@ -88,16 +106,6 @@ static int generate_rowbytes(int src_w, int dst_w, int bpp)
 	DWORD oldprot;
 #endif
 
-	/* See if we need to regenerate the copy buffer */
-	if ( (src_w == last.src_w) &&
-	     (dst_w == last.dst_w) && (bpp == last.bpp) ) {
-		return(last.status);
-	}
-	last.bpp = bpp;
-	last.src_w = src_w;
-	last.dst_w = dst_w;
-	last.status = -1;
-
 	switch (bpp) {
 	    case 1:
 		load = LOAD_BYTE;
@@ -114,12 +122,12 @@ static int generate_rowbytes(int src_w, int dst_w, int bpp)
 	}
 	/* Make the code writeable */
 #ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_READWRITE, &oldprot)) {
+	if (!VirtualProtect(copy_row, COPY_ROW_SIZE, PAGE_READWRITE, &oldprot)) {
 		SDL_SetError("Couldn't make copy buffer writeable");
 		return(-1);
 	}
 #elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_WRITE) < 0 ) {
+	if ( mprotect(copy_row, COPY_ROW_SIZE, PROT_READ|PROT_WRITE) < 0 ) {
 		SDL_SetError("Couldn't make copy buffer writeable");
 		return(-1);
 	}
@@ -127,7 +135,7 @@ static int generate_rowbytes(int src_w, int dst_w, int bpp)
 	pos = 0x10000;
 	inc = (src_w << 16) / dst_w;
 	eip = copy_row;
-	fence = copy_row+sizeof(copy_row)-2;
+	fence = copy_row+COPY_ROW_SIZE-2;
 	for ( i=0; i<dst_w; ++i ) {
 		while ( pos >= 0x10000L ) {
 			if ( eip == fence ) {
@@ -152,22 +160,96 @@ static int generate_rowbytes(int src_w, int dst_w, int bpp)
 
 	/* Make the code executable but not writeable */
 #ifdef __WIN32__
-	if (!VirtualProtect(copy_row, sizeof(copy_row), PAGE_EXECUTE_READ, &oldprot)) {
+	if (!VirtualProtect(copy_row, COPY_ROW_SIZE, PAGE_EXECUTE_READ, &oldprot)) {
 		SDL_SetError("Couldn't make copy buffer executable");
 		return(-1);
 	}
 #elif defined(HAVE_MPROTECT)
-	if ( mprotect(copy_row, sizeof(copy_row), PROT_READ|PROT_EXEC) < 0 ) {
+	if ( mprotect(copy_row, COPY_ROW_SIZE, PROT_READ|PROT_EXEC) < 0 ) {
 		SDL_SetError("Couldn't make copy buffer executable");
 		return(-1);
 	}
 #endif
-	last.status = 0;
 	return(0);
 }
 
+/* Find or generate the row copier for this geometry and take a reference
+   on it.  Returns the slot, or -1 if the C copiers should be used.
+ */
+static int acquire_copy_row(int src_w, int dst_w, int bpp)
+{
+	int i, slot;
+
+	if ( !copy_row_lock ) {
+		return(-1);
+	}
+	SDL_mutexP(copy_row_lock);
+
+	slot = -1;
+	for ( i = 0; i < COPY_ROW_SLOTS; ++i ) {
+		copy_row_key *key = &copy_row_keys[i];
+		if ( (key->bpp == bpp) &&
+		     (key->src_w == src_w) && (key->dst_w == dst_w) ) {
+			key->last_used = ++copy_row_clock;
+			if ( key->status == 0 ) {
+				++key->refcount;
+				slot = i;
+			}
+			SDL_mutexV(copy_row_lock);
+			return(slot);
+		}
+		/* Remember the least recently used idle slot */
+		if ( key->refcount == 0 &&
+		     (slot < 0 || key->last_used < copy_row_keys[slot].last_used) ) {
+			slot = i;
+		}
+	}
+	if ( slot >= 0 ) {
+		copy_row_key *key = &copy_row_keys[slot];
+		key->bpp = bpp;
+		key->src_w = src_w;
+		key->dst_w = dst_w;
+		key->last_used = ++copy_row_clock;
+		key->status = generate_rowbytes(copy_rows[slot], src_w, dst_w, bpp);
+		if ( key->status == 0 ) {
+			key->refcount = 1;
+		} else {
+			slot = -1;
+		}
+	}
+	SDL_mutexV(copy_row_lock);
+	return(slot);
+}
+
+static void release_copy_row(int slot)
+{
+	SDL_mutexP(copy_row_lock);
+	--copy_row_keys[slot].refcount;
+	SDL_mutexV(copy_row_lock);
+}
+
 #endif /* USE_ASM_STRETCH */
 
+void SDL_StretchInit(void)
+{
+#ifdef USE_ASM_STRETCH
+	if ( !copy_row_lock ) {
+		copy_row_lock = SDL_CreateMutex();
+	}
+#endif
+}
+
+void SDL_StretchQuit(void)
+{
+#ifdef USE_ASM_STRETCH
+	if ( copy_row_lock ) {
+		SDL_DestroyMutex(copy_row_lock);
+		copy_row_lock = NULL;
+	}
+	SDL_memset(copy_row_keys, 0, sizeof(copy_row_keys));
+#endif
+}
+
 #define DEFINE_COPY_ROW(name, type)			\
 void name(type *src, int src_w, type *dst, int dst_w)	\
 {							\
@@ -214,7 +296,7 @@ void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 }
 
 /* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
+   This may be called from several threads at once.
 */
 int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                     SDL_Surface *dst, SDL_Rect *dstrect)
@@ -229,9 +311,9 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	SDL_Rect full_src;
 	SDL_Rect full_dst;
 #ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
+	int copy_slot = -1;
 #ifdef __GNUC__
-	int u1, u2;
+	Uint8 *u1, *u2;
 #endif
 #endif /* USE_ASM_STRETCH */
 	const int bpp = dst->format->BytesPerPixel;
@@ -300,10 +382,9 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	dst_row = dstrect->y;
 
 #ifdef USE_ASM_STRETCH
-	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
-	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
-		use_asm = SDL_FALSE;
+	/* Look up (or write) the opcodes for this stretch */
+	if ( bpp != 3 ) {
+		copy_slot = acquire_copy_row(srcrect->w, dstrect->w, bpp);
 	}
 #endif
 
@@ -318,15 +399,23 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 			pos -= 0x10000L;
 		}
 #ifdef USE_ASM_STRETCH
-		if (use_asm) {
+		if ( copy_slot >= 0 ) {
 #ifdef __GNUC__
+			/* The generated code loads through eax, and on x86_64
+			   the call mustn't land in our red zone */
 			__asm__ __volatile__ (
+#ifdef __x86_64__
+			"sub $128, %%rsp\n"
+			"call *%4\n"
+			"add $128, %%rsp"
+#else
 			"call *%4"
+#endif
 			: "=&D" (u1), "=&S" (u2)
-			: "0" (dstp), "1" (srcp), "r" (copy_row)
-			: "memory" );
+			: "0" (dstp), "1" (srcp), "r" (copy_rows[copy_slot])
+			: "memory", "eax", "cc" );
 #elif defined(_MSC_VER)
-		{ void *code = copy_row;
+		{ void *code = copy_rows[copy_slot];
 			__asm {
 				push edi
 				push esi
@@ -363,6 +452,12 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		pos += inc;
 	}
 
+#ifdef USE_ASM_STRETCH
+	if ( copy_slot >= 0 ) {
+		release_copy_row(copy_slot);
+	}
+#endif
+
 	/* We need to unlock the surfaces if they're locked */
 	if ( dst_locked ) {
 		SDL_UnlockSurface(dst);
@@ -373,3 +468,541 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	return(0);
 }
 
+
+/*
+ * Filtered scaling.
+ *
+ * Rows are filtered in a 32-bit work format with one byte per channel:
+ * the source format itself when it is a byte-aligned 32 bpp format, and
+ * ARGB8888 otherwise.  Each destination row is produced by a vertical
+ * pass over whole source rows (blending two rows for bilinear, summing
+ * the covered rows for area averaging) followed by a horizontal pass,
+ * and then converted to the destination format if that is different.
+ * Destination rows are independent, so they are spread over the blit
+ * thread pool when SDL_BLIT_THREADS is set.
+ */
+
+#if SDL_X86_SIMD_BLITTERS
+#include <emmintrin.h>
+#endif
+
+typedef struct {
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	SDL_Rect *srcrect;
+	SDL_Rect *dstrect;
+	SDL_StretchFilter filter;
+	SDL_PixelFormat argb;	/* work format for non 32 bpp sources */
+	SDL_PixelFormat *work;
+	int direct_src;		/* source rows are already in work format */
+	int direct_dst;		/* destination rows are in work format */
+	int opaque;		/* work format has no alpha channel */
+	Uint32 *xpos;		/* bilinear/nearest: 16.16 source x per dst x */
+	int *xspan;		/* area: source x bounds in 1/256 pixel units */
+	int *yspan;		/* area: source y bounds in 1/256 pixel units */
+	int sse2;
+	int status;
+} SDL_StretchJob;
+
+static int IsByteFormat(SDL_PixelFormat *fmt)
+{
+	if ( fmt->BytesPerPixel != 4 ||
+	     fmt->Rloss || fmt->Gloss || fmt->Bloss ||
+	     ((fmt->Rshift|fmt->Gshift|fmt->Bshift) & 7) ) {
+		return 0;
+	}
+	if ( fmt->Amask && (fmt->Aloss || (fmt->Ashift & 7)) ) {
+		return 0;
+	}
+	return 1;
+}
+
+/* Fill in the 16.16 sample positions for bilinear and nearest filtering */
+static void StretchPositions(Uint32 *pos, int src_w, int dst_w)
+{
+	int i;
+	Uint32 inc;
+	Sint64 p;
+
+	/* 16.16 positions of rows 32768 pixels or wider don't fit an int */
+	inc = (Uint32)(((Uint64)src_w << 16) / dst_w);
+	p = (Sint64)(inc/2) - 0x8000;
+	for ( i = 0; i < dst_w; ++i ) {
+		pos[i] = (p < 0) ? 0 : (Uint32)p;
+		p += inc;
+	}
+}
+
+/* Fill in the dst_w+1 bounds of the source area covered by each dst pixel */
+static void StretchSpans(int *span, int src_w, int dst_w)
+{
+	int i, q, r, step, rem;
+
+	step = (src_w << 8) / dst_w;
+	rem = (src_w << 8) % dst_w;
+	q = r = 0;
+	for ( i = 0; i <= dst_w; ++i ) {
+		span[i] = q;
+		q += step;
+		r += rem;
+		if ( r >= dst_w ) {
+			++q;
+			r -= dst_w;
+		}
+	}
+}
+
+/* Return source row y of the stretch rectangle in the work format */
+static const Uint32 *FetchRow(SDL_StretchJob *job, int y, Uint32 *buf)
+{
+	SDL_Surface *src = job->src;
+	SDL_PixelFormat *fmt = src->format;
+	int bpp = fmt->BytesPerPixel;
+	Uint8 *p = (Uint8 *)src->pixels + (job->srcrect->y+y)*src->pitch
+	                                + job->srcrect->x*bpp;
+	int i;
+
+	if ( job->direct_src ) {
+		return (const Uint32 *)p;
+	}
+	for ( i = 0; i < job->srcrect->w; ++i ) {
+		Uint32 pixel;
+		unsigned r, g, b, a;
+
+		DISEMBLE_RGBA(p, bpp, fmt, pixel, r, g, b, a);
+		if ( !fmt->Amask ) {
+			a = 255;
+		}
+		buf[i] = (a << 24) | (r << 16) | (g << 8) | b;
+		p += bpp;
+	}
+	return buf;
+}
+
+/* Convert a finished work format row into the destination surface */
+static void StoreRow(SDL_StretchJob *job, int y, const Uint32 *row)
+{
+	SDL_Surface *dst = job->dst;
+	SDL_PixelFormat *fmt = dst->format;
+	SDL_PixelFormat *work = job->work;
+	int bpp = fmt->BytesPerPixel;
+	Uint8 *p = (Uint8 *)dst->pixels + (job->dstrect->y+y)*dst->pitch
+	                                + job->dstrect->x*bpp;
+	int i;
+
+	for ( i = 0; i < job->dstrect->w; ++i ) {
+		Uint32 pixel = row[i];
+		unsigned r, g, b, a;
+
+		RGBA_FROM_8888(pixel, work, r, g, b, a);
+		if ( job->opaque ) {
+			a = 255;
+		}
+		ASSEMBLE_RGBA(p, bpp, fmt, r, g, b, a);
+		p += bpp;
+	}
+}
+
+/* Blend 4 byte channels: (a*(256-f) + b*f) / 256, with f in 0..256 */
+#define BLEND_8888(a, b, f)						\
+	((((((a) & 0xff00ff) * (256-(f)) + ((b) & 0xff00ff) * (f)	\
+	    + 0x800080) >> 8) & 0xff00ff) |				\
+	 ((((((a) >> 8) & 0xff00ff) * (256-(f)) +			\
+	    (((b) >> 8) & 0xff00ff) * (f) + 0x800080)) & 0xff00ff00))
+
+#if SDL_X86_SIMD_BLITTERS
+SDL_TARGET_SSE2
+static int BlendRowsSSE2(const Uint32 *a, const Uint32 *b, Uint32 *out, int n, int f)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i wa = _mm_set1_epi16((short)(256-f));
+	const __m128i wb = _mm_set1_epi16((short)f);
+	const __m128i round = _mm_set1_epi16(128);
+	int i;
+
+	for ( i = 0; i+4 <= n; i += 4 ) {
+		__m128i va = _mm_loadu_si128((const __m128i *)(a+i));
+		__m128i vb = _mm_loadu_si128((const __m128i *)(b+i));
+		__m128i lo = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+		__m128i hi = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)(out+i), _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+SDL_TARGET_SSE2
+static int AccumulateRowSSE2(const Uint32 *row, Uint32 *acc, int n, int w)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vw = _mm_set1_epi16((short)w);
+	int i;
+
+	for ( i = 0; i+4 <= n; i += 4 ) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(row+i));
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), vw);
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), vw);
+		__m128i *p = (__m128i *)(acc + i*4);
+
+		_mm_storeu_si128(p+0, _mm_add_epi32(_mm_loadu_si128(p+0),
+		                               _mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_si128(p+1, _mm_add_epi32(_mm_loadu_si128(p+1),
+		                               _mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_si128(p+2, _mm_add_epi32(_mm_loadu_si128(p+2),
+		                               _mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_si128(p+3, _mm_add_epi32(_mm_loadu_si128(p+3),
+		                               _mm_unpackhi_epi16(hi, zero)));
+	}
+	return i;
+}
+
+/* Convert unsigned 32-bit sums to float.  A sum over a tall span can reach
+   255 * 65535 * 256, past the signed range _mm_cvtepi32_ps handles, so the
+   halves are converted separately and put back together exactly.
+ */
+SDL_TARGET_SSE2
+static __m128 ConvertSumsSSE2(__m128i v)
+{
+	const __m128i lomask = _mm_set1_epi32(0xFFFF);
+	const __m128 himul = _mm_set1_ps(65536.0f);
+	__m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(v, 16));
+	__m128 lo = _mm_cvtepi32_ps(_mm_and_si128(v, lomask));
+
+	return _mm_add_ps(_mm_mul_ps(hi, himul), lo);
+}
+
+SDL_TARGET_SSE2
+static int NormalizeRowSSE2(const Uint32 *acc, Uint32 *out, int n, float scale)
+{
+	const __m128 vs = _mm_set1_ps(scale);
+	int i;
+
+	for ( i = 0; i+4 <= n; i += 4 ) {
+		const __m128i *p = (const __m128i *)(acc + i*4);
+		__m128i c0 = _mm_cvtps_epi32(_mm_mul_ps(ConvertSumsSSE2(_mm_loadu_si128(p+0)), vs));
+		__m128i c1 = _mm_cvtps_epi32(_mm_mul_ps(ConvertSumsSSE2(_mm_loadu_si128(p+1)), vs));
+		__m128i c2 = _mm_cvtps_epi32(_mm_mul_ps(ConvertSumsSSE2(_mm_loadu_si128(p+2)), vs));
+		__m128i c3 = _mm_cvtps_epi32(_mm_mul_ps(ConvertSumsSSE2(_mm_loadu_si128(p+3)), vs));
+		__m128i lo = _mm_packs_epi32(c0, c1);
+		__m128i hi = _mm_packs_epi32(c2, c3);
+		_mm_storeu_si128((__m128i *)(out+i), _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+#endif /* SDL_X86_SIMD_BLITTERS */
+
+static void BlendRows(SDL_StretchJob *job, const Uint32 *a, const Uint32 *b,
+                      Uint32 *out, int n, int f)
+{
+	int i = 0;
+
+#if SDL_X86_SIMD_BLITTERS
+	if ( job->sse2 ) {
+		i = BlendRowsSSE2(a, b, out, n, f);
+	}
+#endif
+	for ( ; i < n; ++i ) {
+		out[i] = BLEND_8888(a[i], b[i], f);
+	}
+}
+
+static void AccumulateRow(SDL_StretchJob *job, const Uint32 *row,
+                          Uint32 *acc, int n, int w)
+{
+	const Uint8 *p;
+	int i = 0;
+
+#if SDL_X86_SIMD_BLITTERS
+	if ( job->sse2 ) {
+		i = AccumulateRowSSE2(row, acc, n, w);
+	}
+#endif
+	p = (const Uint8 *)(row+i);
+	for ( i *= 4; i < n*4; ++i ) {
+		acc[i] += *p++ * w;
+	}
+}
+
+static void NormalizeRow(SDL_StretchJob *job, const Uint32 *acc,
+                         Uint32 *out, int n, int total)
+{
+	float scale = 1.0f / total;
+	Uint8 *p;
+	int i = 0;
+
+#if SDL_X86_SIMD_BLITTERS
+	if ( job->sse2 ) {
+		i = NormalizeRowSSE2(acc, out, n, scale);
+	}
+#endif
+	p = (Uint8 *)(out+i);
+	for ( i *= 4; i < n*4; ++i ) {
+		*p++ = (Uint8)(acc[i] * scale + 0.5f);
+	}
+}
+
+/* Produce destination rows [first, first+count) */
+static void StretchBand(void *data, int first, int count)
+{
+	SDL_StretchJob *job = (SDL_StretchJob *)data;
+	const int src_w = job->srcrect->w;
+	const int src_h = job->srcrect->h;
+	const int dst_w = job->dstrect->w;
+	const int dst_h = job->dstrect->h;
+	Uint32 *rowa, *rowb, *tmp, *out, *acc;
+	Uint8 *mem;
+	int y, x;
+
+	mem = (Uint8 *)SDL_malloc(sizeof(Uint32) * (src_w*3 + dst_w) +
+	          (job->filter == SDL_STRETCH_AREA ? sizeof(Uint32)*4*src_w : 0));
+	if ( !mem ) {
+		job->status = -1;
+		return;
+	}
+	rowa = (Uint32 *)mem;
+	rowb = rowa + src_w;
+	tmp = rowb + src_w;
+	out = tmp + src_w;
+	acc = out + dst_w;
+
+	for ( y = first; y < first+count; ++y ) {
+		const Uint32 *row;
+
+		if ( job->direct_dst ) {
+			out = (Uint32 *)((Uint8 *)job->dst->pixels +
+			                 (job->dstrect->y+y)*job->dst->pitch) +
+			      job->dstrect->x;
+		}
+
+		if ( job->filter == SDL_STRETCH_AREA ) {
+			int y0 = job->yspan[y], y1 = job->yspan[y+1];
+			int k;
+
+			SDL_memset(acc, 0, sizeof(Uint32)*4*src_w);
+			for ( k = y0 >> 8; (k << 8) < y1; ++k ) {
+				int lo = (y0 > (k << 8)) ? y0 : (k << 8);
+				int hi = (y1 < ((k+1) << 8)) ? y1 : ((k+1) << 8);
+				row = FetchRow(job, k, rowa);
+				AccumulateRow(job, row, acc, src_w, hi-lo);
+			}
+			NormalizeRow(job, acc, tmp, src_w, y1-y0);
+
+			for ( x = 0; x < dst_w; ++x ) {
+				int x0 = job->xspan[x], x1 = job->xspan[x+1];
+				Uint32 sum[4] = { 0, 0, 0, 0 };
+				float scale = 1.0f / (x1-x0);
+				Uint8 *p = (Uint8 *)&out[x];
+
+				for ( k = x0 >> 8; (k << 8) < x1; ++k ) {
+					int lo = (x0 > (k << 8)) ? x0 : (k << 8);
+					int hi = (x1 < ((k+1) << 8)) ? x1 : ((k+1) << 8);
+					const Uint8 *s = (const Uint8 *)&tmp[k];
+					sum[0] += s[0] * (hi-lo);
+					sum[1] += s[1] * (hi-lo);
+					sum[2] += s[2] * (hi-lo);
+					sum[3] += s[3] * (hi-lo);
+				}
+				p[0] = (Uint8)(sum[0] * scale + 0.5f);
+				p[1] = (Uint8)(sum[1] * scale + 0.5f);
+				p[2] = (Uint8)(sum[2] * scale + 0.5f);
+				p[3] = (Uint8)(sum[3] * scale + 0.5f);
+			}
+		} else {
+			Uint32 inc = (Uint32)(((Uint64)src_h << 16) / dst_h);
+			Sint64 pos = (Sint64)y*inc + inc/2 - 0x8000;
+			int sy, fy;
+
+			if ( pos < 0 ) {
+				pos = 0;
+			}
+			sy = (int)(pos >> 16);
+			fy = (int)(pos >> 8) & 0xff;
+			if ( job->filter == SDL_STRETCH_NEAREST ) {
+				int ny = (int)((pos + 0x8000) >> 16);
+				row = FetchRow(job, ny < src_h ? ny : src_h-1, rowa);
+				for ( x = 0; x < dst_w; ++x ) {
+					int sx = (job->xpos[x] + 0x8000) >> 16;
+					out[x] = row[sx < src_w ? sx : src_w-1];
+				}
+			} else {
+				row = FetchRow(job, sy, rowa);
+				if ( fy && sy+1 < src_h ) {
+					const Uint32 *next = FetchRow(job, sy+1, rowb);
+					BlendRows(job, row, next, tmp, src_w, fy);
+					row = tmp;
+				}
+				for ( x = 0; x < dst_w; ++x ) {
+					int sx = job->xpos[x] >> 16;
+					int fx = (job->xpos[x] >> 8) & 0xff;
+					Uint32 a = row[sx];
+					if ( fx && sx+1 < src_w ) {
+						Uint32 b = row[sx+1];
+						out[x] = BLEND_8888(a, b, fx);
+					} else {
+						out[x] = a;
+					}
+				}
+			}
+		}
+
+		if ( !job->direct_dst ) {
+			StoreRow(job, y, out);
+		}
+	}
+	SDL_free(mem);
+}
+
+int SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                            SDL_Surface *dst, SDL_Rect *dstrect,
+                            SDL_StretchFilter filter)
+{
+	SDL_StretchJob job;
+	SDL_Rect full_src;
+	SDL_Rect full_dst;
+	int src_locked;
+	int dst_locked;
+	int *tables;
+
+	if ( src->format->BytesPerPixel < 2 || dst->format->BytesPerPixel < 2 ) {
+		SDL_SetError("Filtered stretch needs 16, 24 or 32 bpp surfaces");
+		return(-1);
+	}
+	if ( filter != SDL_STRETCH_NEAREST && filter != SDL_STRETCH_BILINEAR &&
+	     filter != SDL_STRETCH_AREA ) {
+		SDL_SetError("Unknown stretch filter");
+		return(-1);
+	}
+
+	/* Verify the blit rectangles */
+	if ( srcrect ) {
+		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
+		     ((srcrect->x+srcrect->w) > src->w) ||
+		     ((srcrect->y+srcrect->h) > src->h) ) {
+			SDL_SetError("Invalid source blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_src.x = 0;
+		full_src.y = 0;
+		full_src.w = src->w;
+		full_src.h = src->h;
+		srcrect = &full_src;
+	}
+	if ( dstrect ) {
+		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
+		     ((dstrect->x+dstrect->w) > dst->w) ||
+		     ((dstrect->y+dstrect->h) > dst->h) ) {
+			SDL_SetError("Invalid destination blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_dst.x = 0;
+		full_dst.y = 0;
+		full_dst.w = dst->w;
+		full_dst.h = dst->h;
+		dstrect = &full_dst;
+	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
+
+	SDL_memset(&job, 0, sizeof(job));
+	job.src = src;
+	job.dst = dst;
+	job.srcrect = srcrect;
+	job.dstrect = dstrect;
+	job.filter = filter;
+#if SDL_X86_SIMD_BLITTERS
+	job.sse2 = SDL_HasSSE2();
+#endif
+
+	/* Pick the work format */
+	if ( IsByteFormat(src->format) ) {
+		job.work = src->format;
+		job.direct_src = 1;
+		job.opaque = !src->format->Amask;
+	} else {
+		job.argb.BitsPerPixel = 32;
+		job.argb.BytesPerPixel = 4;
+		job.argb.Rshift = 16;
+		job.argb.Gshift = 8;
+		job.argb.Bshift = 0;
+		job.argb.Ashift = 24;
+		job.argb.Rmask = 0x00FF0000;
+		job.argb.Gmask = 0x0000FF00;
+		job.argb.Bmask = 0x000000FF;
+		job.argb.Amask = 0xFF000000;
+		job.work = &job.argb;
+	}
+	if ( dst->format->BytesPerPixel == 4 &&
+	     dst->format->Rmask == job.work->Rmask &&
+	     dst->format->Gmask == job.work->Gmask &&
+	     dst->format->Bmask == job.work->Bmask &&
+	     (!dst->format->Amask ||
+	      (dst->format->Amask == job.work->Amask && !job.opaque)) ) {
+		job.direct_dst = 1;
+	}
+
+	/* Precompute the horizontal (and for area, vertical) sampling */
+	tables = (int *)SDL_malloc(sizeof(int) *
+	                           (dstrect->w + 1 + dstrect->h + 1));
+	if ( !tables ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	if ( filter == SDL_STRETCH_AREA ) {
+		job.xspan = tables;
+		job.yspan = tables + dstrect->w + 1;
+		StretchSpans(job.xspan, srcrect->w, dstrect->w);
+		StretchSpans(job.yspan, srcrect->h, dstrect->h);
+	} else {
+		job.xpos = (Uint32 *)tables;
+		StretchPositions(job.xpos, srcrect->w, dstrect->w);
+	}
+
+	/* Lock the destination if it's in hardware */
+	dst_locked = 0;
+	if ( SDL_MUSTLOCK(dst) ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			SDL_free(tables);
+			SDL_SetError("Unable to lock destination surface");
+			return(-1);
+		}
+		dst_locked = 1;
+	}
+	/* Lock the source if it's in hardware */
+	src_locked = 0;
+	if ( SDL_MUSTLOCK(src) ) {
+		if ( SDL_LockSurface(src) < 0 ) {
+			if ( dst_locked ) {
+				SDL_UnlockSurface(dst);
+			}
+			SDL_free(tables);
+			SDL_SetError("Unable to lock source surface");
+			return(-1);
+		}
+		src_locked = 1;
+	}
+
+	SDL_RunBlitBands(StretchBand, &job, dstrect->h, dstrect->w);
+
+	/* We need to unlock the surfaces if they're locked */
+	if ( dst_locked ) {
+		SDL_UnlockSurface(dst);
+	}
+	if ( src_locked ) {
+		SDL_UnlockSurface(src);
+	}
+	SDL_free(tables);
+
+	if ( job.status < 0 ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	return(0);
+}
@@ -22,8 +22,17 @@
 #include "SDL_config.h"
 
 /* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
+   This may be called from several threads at once.
 */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+
+/* Perform a filtered stretch blit, converting between formats if needed */
+extern int SDL_SoftStretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                                   SDL_Surface *dst, SDL_Rect *dstrect,
+                                   SDL_StretchFilter filter);
+
+/* Set up and release the cached stretch row code */
+extern void SDL_StretchInit(void);
+extern void SDL_StretchQuit(void);
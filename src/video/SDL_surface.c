@@ -445,28 +445,16 @@ int SDL_LowerBlit (SDL_Surface *src, SDL_Rect *srcrect,
 }
 
 
-int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
-		   SDL_Surface *dst, SDL_Rect *dstrect)
+/*
+ * Clip a blit against the source surface and the destination clip
+ * rectangle.  The clipped destination is written back to 'dstrect' and
+ * the matching source area to 'sr'.  Returns 0 if nothing is left.
+ */
+static int SDL_ClipBlitRect (SDL_Surface *src, const SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect, SDL_Rect *sr)
 {
-        SDL_Rect fulldst;
 	int srcx, srcy, w, h;
 
-	/* Make sure the surfaces aren't locked */
-	if ( ! src || ! dst ) {
-		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
-		return(-1);
-	}
-	if ( src->locked || dst->locked ) {
-		SDL_SetError("Surfaces must not be locked during blit");
-		return(-1);
-	}
-
-	/* If the destination rectangle is NULL, use the entire dest surface */
-	if ( dstrect == NULL ) {
-	        fulldst.x = fulldst.y = 0;
-		dstrect = &fulldst;
-	}
-
 	/* clip the source rectangle to the source surface */
 	if(srcrect) {
 	        int maxw, maxh;
@@ -526,17 +514,129 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	}
 
 	if(w > 0 && h > 0) {
-	        SDL_Rect sr;
-	        sr.x = srcx;
-		sr.y = srcy;
-		sr.w = dstrect->w = w;
-		sr.h = dstrect->h = h;
-		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	        sr->x = srcx;
+		sr->y = srcy;
+		sr->w = dstrect->w = w;
+		sr->h = dstrect->h = h;
+		return 1;
 	}
 	dstrect->w = dstrect->h = 0;
 	return 0;
 }
 
+int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
+		   SDL_Surface *dst, SDL_Rect *dstrect)
+{
+        SDL_Rect fulldst;
+	SDL_Rect sr;
+
+	/* Make sure the surfaces aren't locked */
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_UpperBlit: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	/* If the destination rectangle is NULL, use the entire dest surface */
+	if ( dstrect == NULL ) {
+	        fulldst.x = fulldst.y = 0;
+		dstrect = &fulldst;
+	}
+
+	if ( SDL_ClipBlitRect(src, srcrect, dst, dstrect, &sr) ) {
+		return SDL_LowerBlit(src, &sr, dst, dstrect);
+	}
+	return 0;
+}
+
+/*
+ * Blit many rectangles from one surface to another.  The blit mapping
+ * is validated and the surfaces are locked once for the whole batch,
+ * instead of once per rectangle as with SDL_UpperBlit().
+ */
+int SDL_BlitSurfaceBatch (SDL_Surface *src, const SDL_Rect *srcrects,
+			  SDL_Surface *dst, SDL_Rect *dstrects, int numrects)
+{
+	SDL_Rect sr;
+	int i, retval;
+	int src_locked;
+	int dst_locked;
+
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_BlitSurfaceBatch: passed a NULL surface");
+		return(-1);
+	}
+	if ( ! dstrects || numrects < 0 ) {
+		SDL_SetError("SDL_BlitSurfaceBatch: invalid rectangle list");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+
+	/* Check to make sure the blit mapping is valid */
+	if ( (src->map->dst != dst) ||
+             (src->map->dst->format_version != src->map->format_version) ) {
+		if ( SDL_MapSurface(src, dst) < 0 ) {
+			return(-1);
+		}
+	}
+
+	/* Hardware and RLE blits go through the regular path */
+	if ( (src->flags & SDL_HWACCEL) == SDL_HWACCEL ||
+	     src->map->sw_blit != SDL_SoftBlit ) {
+		retval = 0;
+		for ( i = 0; i < numrects; ++i ) {
+			const SDL_Rect *srcrect = srcrects ? &srcrects[i] : NULL;
+			if ( SDL_ClipBlitRect(src, srcrect, dst, &dstrects[i], &sr) ) {
+				retval = SDL_LowerBlit(src, &sr, dst, &dstrects[i]);
+				if ( retval < 0 ) {
+					break;
+				}
+			}
+		}
+		return(retval);
+	}
+
+	/* Lock the surfaces once for the whole batch */
+	dst_locked = 0;
+	if ( SDL_MUSTLOCK(dst) ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			return(-1);
+		}
+		dst_locked = 1;
+	}
+	src_locked = 0;
+	if ( SDL_MUSTLOCK(src) ) {
+		if ( SDL_LockSurface(src) < 0 ) {
+			if ( dst_locked ) {
+				SDL_UnlockSurface(dst);
+			}
+			return(-1);
+		}
+		src_locked = 1;
+	}
+
+	for ( i = 0; i < numrects; ++i ) {
+		const SDL_Rect *srcrect = srcrects ? &srcrects[i] : NULL;
+		if ( SDL_ClipBlitRect(src, srcrect, dst, &dstrects[i], &sr) ) {
+			SDL_SoftBlitRect(src, &sr, dst, &dstrects[i]);
+		}
+	}
+
+	if ( dst_locked ) {
+		SDL_UnlockSurface(dst);
+	}
+	if ( src_locked ) {
+		SDL_UnlockSurface(src);
+	}
+	return(0);
+}
+
 static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
 	/* FIXME: We have to worry about packing order.. *sigh* */
@@ -601,7 +701,7 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 	}
 
 	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
+	if ( SDL_LockSurfaceRect(dst, dstrect) != 0 ) {
 		return(-1);
 	}
 	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
@@ -780,6 +880,14 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
  * Lock a surface to directly access the pixels
  */
 int SDL_LockSurface (SDL_Surface *surface)
+{
+	return(SDL_LockSurfaceRect(surface, NULL));
+}
+
+/*
+ * Lock a surface to write only the pixels inside rect
+ */
+int SDL_LockSurfaceRect (SDL_Surface *surface, const SDL_Rect *rect)
 {
 	if ( ! surface->locked ) {
 		/* Perform the lock */
@@ -791,11 +899,17 @@ int SDL_LockSurface (SDL_Surface *surface)
 			}
 		}
 		if ( surface->flags & SDL_RLEACCEL ) {
-			SDL_UnRLESurface(surface, 1);
-			surface->flags |= SDL_RLEACCEL;	/* save accel'd state */
+			/* Keep the encoding if only some rows need updating */
+			if ( SDL_RLEDirtyRows(surface, rect) < 0 ) {
+				SDL_UnRLESurface(surface, 1);
+				surface->flags |= SDL_RLEACCEL;	/* save accel'd state */
+			}
 		}
 		/* This needs to be done here in case pixels changes value */
 		surface->pixels = (Uint8 *)surface->pixels + surface->offset;
+	} else if ( surface->flags & SDL_RLEACCEL ) {
+		/* A nested lock may write more rows */
+		SDL_RLEDirtyRows(surface, rect);
 	}
 
 	/* Increment the surface lock count, for recursive locks */
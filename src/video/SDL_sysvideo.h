@@ -258,6 +258,14 @@ struct SDL_VideoDevice {
 	/* Handle any queued OS events */
 	void (*PumpEvents)(_THIS);
 
+	/* Fill 'fds' with up to 'maxfds' file descriptors that become
+	   readable when PumpEvents() has new input, and return how many,
+	   or -1 if the driver can only be polled.  The driver may lower
+	   '*timeout' (milliseconds, -1 for none) if PumpEvents() has
+	   periodic work of its own to do.
+	 */
+	int (*GetEventFDs)(_THIS, int *fds, int maxfds, Sint32 *timeout);
+
 	/* * * */
 	/* Data common to all drivers */
 	SDL_Surface *screen;
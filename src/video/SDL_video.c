@@ -156,6 +156,11 @@ static SDL_GrabMode SDL_WM_GrabInputOff(void);
 static int lock_count = 0;
 #endif
 
+/* Update rectangle merging, see SDL_CoalesceRects() */
+static int SDL_update_merge = 1;
+static SDL_Rect *SDL_update_rects = NULL;
+static int SDL_update_maxrects = 0;
+
 
 /*
  * Initialize the video and event subsystems -- determine native pixel format
@@ -236,6 +241,12 @@ int SDL_VideoInit (const char *driver_name, Uint32 flags)
 	
 	video->displayformatalphapixel = NULL;
 
+	/* Merge update rectangles unless told otherwise */
+	{
+		const char *hint = SDL_getenv("SDL_VIDEO_UPDATE_MERGE");
+		SDL_update_merge = (!hint || SDL_atoi(hint) != 0);
+	}
+
 	/* Set some very sane GL defaults */
 	video->gl_config.driver_loaded = 0;
 	video->gl_config.dll_handle = NULL;
@@ -680,6 +691,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 		SDL_FreeSurface(ready_to_go);
 	}
 	if ( video->physpal ) {
+		SDL_InvalidateInverseMap(video->physpal);
 		SDL_free(video->physpal->colors);
 		SDL_free(video->physpal);
 		video->physpal = NULL;
@@ -735,6 +747,7 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 			SDL_DitherColors(vf->palette->colors, vf->BitsPerPixel);
 			video->SetColors(this, 0, vf->palette->ncolors,
 			                           vf->palette->colors);
+			SDL_InvalidateInverseMap(vf->palette);
 		}
 
 		/* Clear the surface to black */
@@ -1051,6 +1064,112 @@ void SDL_UpdateRect(SDL_Surface *screen, Sint32 x, Sint32 y, Uint32 w, Uint32 h)
 		SDL_UpdateRects(screen, 1, &rect);
 	}
 }
+/*
+ * Update rectangles are merged before they are handed to the driver,
+ * since every rectangle costs a separate blit and a separate request to
+ * the display.  Rectangles inside others are dropped, and rectangles
+ * that overlap or touch are replaced by their bounding box when that
+ * adds little area.  If the result still costs more than updating the
+ * bounding box of everything, that one rectangle is used instead.
+ * Set SDL_VIDEO_UPDATE_MERGE=0 to pass rectangles through untouched.
+ */
+#define SDL_UPDATE_RECT_COST	1024	/* overhead of one rect, in pixels */
+#define SDL_UPDATE_MERGE_MAX	512	/* more than this just uses the bbox */
+
+static Uint32 SDL_RectArea(const SDL_Rect *rect)
+{
+	return (Uint32)rect->w * rect->h;
+}
+
+static void SDL_RectUnion(const SDL_Rect *a, const SDL_Rect *b, SDL_Rect *u)
+{
+	int x1 = SDL_min(a->x, b->x);
+	int y1 = SDL_min(a->y, b->y);
+	int x2 = SDL_max(a->x + a->w, b->x + b->w);
+	int y2 = SDL_max(a->y + a->h, b->y + b->h);
+
+	u->x = x1;
+	u->y = y1;
+	u->w = x2 - x1;
+	u->h = y2 - y1;
+}
+
+/* Returns the merged rectangle list, which is valid until the next call */
+static SDL_Rect *SDL_CoalesceRects(int *numrects, SDL_Rect *rects)
+{
+	SDL_Rect *list, bbox;
+	Uint32 cost;
+	int i, j, n, merged;
+
+	if ( *numrects > SDL_update_maxrects ) {
+		list = (SDL_Rect *)SDL_realloc(SDL_update_rects,
+		                               *numrects * sizeof(*list));
+		if ( !list ) {
+			return rects;
+		}
+		SDL_update_rects = list;
+		SDL_update_maxrects = *numrects;
+	}
+	list = SDL_update_rects;
+
+	/* Copy the rectangles, dropping empty ones */
+	n = 0;
+	for ( i = 0; i < *numrects; ++i ) {
+		if ( rects[i].w && rects[i].h ) {
+			list[n++] = rects[i];
+		}
+	}
+
+	/* Combine pairs that overlap or touch while it doesn't waste much */
+	if ( n <= SDL_UPDATE_MERGE_MAX ) {
+		do {
+			merged = 0;
+			for ( i = 0; i < n; ++i ) {
+				for ( j = i+1; j < n; ++j ) {
+					SDL_Rect *a = &list[i];
+					SDL_Rect *b = &list[j];
+					SDL_Rect u;
+					Uint32 overlap = 0;
+					int ow, oh;
+
+					ow = SDL_min(a->x + a->w, b->x + b->w) - SDL_max(a->x, b->x);
+					oh = SDL_min(a->y + a->h, b->y + b->h) - SDL_max(a->y, b->y);
+					if ( ow < 0 || oh < 0 ) {
+						continue;
+					}
+					overlap = (Uint32)ow * oh;
+					SDL_RectUnion(a, b, &u);
+					if ( SDL_RectArea(&u) > SDL_RectArea(a) + SDL_RectArea(b) -
+					                        overlap + SDL_UPDATE_RECT_COST ) {
+						continue;
+					}
+					*a = u;
+					list[j] = list[--n];
+					j = i;
+					merged = 1;
+				}
+			}
+		} while ( merged );
+	}
+
+	/* See if one update of the bounding box is cheaper */
+	if ( n > 1 ) {
+		bbox = list[0];
+		cost = SDL_RectArea(&list[0]) + SDL_UPDATE_RECT_COST;
+		for ( i = 1; i < n; ++i ) {
+			SDL_RectUnion(&bbox, &list[i], &bbox);
+			cost += SDL_RectArea(&list[i]) + SDL_UPDATE_RECT_COST;
+		}
+		if ( n > SDL_UPDATE_MERGE_MAX ||
+		     SDL_RectArea(&bbox) + SDL_UPDATE_RECT_COST <= cost ) {
+			list[0] = bbox;
+			n = 1;
+		}
+	}
+	*numrects = n;
+	return list;
+}
+
 void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 {
 	int i;
@@ -1061,6 +1180,9 @@ void SDL_UpdateRects (SDL_Surface *screen, int numrects, SDL_Rect *rects)
 		SDL_SetError("OpenGL active, use SDL_GL_SwapBuffers()");
 		return;
 	}
+	if ( numrects > 1 && SDL_update_merge ) {
+		rects = SDL_CoalesceRects(&numrects, rects);
+	}
 	if ( screen == SDL_ShadowSurface ) {
 		/* Blit the shadow surface using saved mapping */
 		SDL_Palette *pal = screen->format->palette;
@@ -1345,6 +1467,16 @@ int SDL_SetPalette(SDL_Surface *screen, int which,
 			gotall = 0;
 		}
 	}
+
+	/* Forget the colour maps of every palette that may have changed,
+	   drivers write back the colours they really got */
+	SDL_InvalidateInverseMap(pal);
+	if ( current_video ) {
+		if ( SDL_VideoSurface ) {
+			SDL_InvalidateInverseMap(SDL_VideoSurface->format->palette);
+		}
+		SDL_InvalidateInverseMap(current_video->physpal);
+	}
 	return gotall;
 }
 
@@ -1394,6 +1526,7 @@ void SDL_VideoQuit (void)
 
 		/* Clean up miscellaneous memory */
 		if ( video->physpal ) {
+			SDL_InvalidateInverseMap(video->physpal);
 			SDL_free(video->physpal->colors);
 			SDL_free(video->physpal);
 			video->physpal = NULL;
@@ -1415,6 +1548,12 @@ void SDL_VideoQuit (void)
 			video->wm_icon = NULL;
 		}
 
+		if ( SDL_update_rects ) {
+			SDL_free(SDL_update_rects);
+			SDL_update_rects = NULL;
+			SDL_update_maxrects = 0;
+		}
+
 		/* Finish cleaning up video subsystem */
 		video->free(this);
 		current_video = NULL;
@@ -80,6 +80,16 @@ void SDL_UnlockYUVOverlay(SDL_Overlay *overlay)
 	overlay->hwfuncs->Unlock(current_video, overlay);
 }
 
+int SDL_SetYUVOverlayPlanes(SDL_Overlay *overlay,
+                            Uint8 **pixels, const Uint16 *pitches)
+{
+	if ( overlay == NULL ) {
+		SDL_SetError("Passed NULL overlay");
+		return -1;
+	}
+	return SDL_SetYUVPlanes_SW(current_video, overlay, pixels, pitches);
+}
+
 int SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect *dstrect)
 {
 	SDL_Rect src, dst;
@@ -123,7 +133,7 @@ int SDL_DisplayYUVOverlay(SDL_Overlay *overlay, SDL_Rect *dstrect)
 		dsth -= extra;
 	}
 	if ( srcw <= 0 || srch <= 0 ||
-	     srch <= 0 || dsth <= 0 ) {
+	     dstw <= 0 || dsth <= 0 ) {
 		return 0;
 	}
 	/* Ugh, I can't wait for SDL_Rect to be int values */
@@ -85,7 +85,7 @@
 
 #include "SDL_video.h"
 #include "SDL_cpuinfo.h"
-#include "SDL_stretch_c.h"
+#include "SDL_blit.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
 
@@ -99,7 +99,6 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 
 /* RGB conversion lookup tables */
 struct private_yuvhwdata {
-	SDL_Surface *stretch;
 	SDL_Surface *display;
 	Uint8 *pixels;
 	int *colortab;
@@ -113,9 +112,28 @@ struct private_yuvhwdata {
                           unsigned char *cb, unsigned char *out,
                           int rows, int cols, int mod );
 
+	/* Converts a row of samples for the scaled display path, with one
+	   chroma sample per pixel or, if halfchroma is set, per two pixels */
+	void (*ConvertRow)(struct private_yuvhwdata *swdata,
+	                   const Uint8 *lum, const Uint8 *cr, const Uint8 *cb,
+	                   Uint8 *out, int width, int halfchroma);
+	/* Copies every step'th byte of a packed row, step is 2 or 4 */
+	void (*ExtractRow)(Uint8 *dst, const Uint8 *src, int step, int count);
+	int simd;		/* ConvertRow beats Display1X and Display2X */
+	Uint8 loss[3];		/* bits dropped from r, g and b */
+	Uint8 shift[3];		/* and where they go in the pixel */
+
+	/* Line buffers and the source column of each output pixel */
+	Uint8 *lines;
+	int line_len;
+	int *xmap;
+	int map_x, map_srcw, map_w;
+
 	/* These are just so we don't have to allocate them separately */
 	Uint16 pitches[3];
 	Uint8 *planes[3];
+	int padded;		/* planes from SDL_SetYUVOverlayPlanes have
+				   rows longer than the overlay is wide */
 };
 
 
@@ -791,7 +809,7 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row++;
 
         }
-        row += next_row;
+        row += next_row + mod/2;
     }
 }
 
@@ -847,7 +865,7 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row += 2*3;
 
         }
-        row += next_row;
+        row += next_row + mod*3;
     }
 }
 
@@ -863,7 +881,6 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
-    mod+=mod;
     y = rows;
     while( y-- )
     {
@@ -895,10 +912,591 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
-        row += next_row;
+        row += next_row + mod;
     }
 }
 
+/*
+ * Scaled conversion.  Each output row is gathered from its nearest source
+ * row and columns into 4:4:4 line buffers, converted to pixels by a row
+ * function and written straight into the display, so clipping and any
+ * scale factor cost a single pass.  Unscaled rows skip the gather and are
+ * converted straight from the subsampled chroma.
+ */
+
+/* Fixed point (Q9) versions of the colortab coefficients */
+#define YUV_COEF(c)	((int)((c) * 512.0 + ((c) < 0 ? -0.5 : 0.5)))
+#define YUV_CR_R	YUV_COEF(0.419/0.299)
+#define YUV_CR_G	YUV_COEF(-(0.299/0.419))
+#define YUV_CB_G	YUV_COEF(-(0.114/0.331))
+#define YUV_CB_B	YUV_COEF(0.587/0.331)
+
+static void ConvertRowC(struct private_yuvhwdata *swdata,
+                        const Uint8 *lum, const Uint8 *cr, const Uint8 *cb,
+                        Uint8 *out, int width, int halfchroma)
+{
+	const int *colortab = swdata->colortab;
+	const Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+	int i;
+
+	for ( i = 0; i < width; ++i ) {
+		int L = lum[i];
+		int CR = cr[i >> halfchroma];
+		int CB = cb[i >> halfchroma];
+		Uint32 value;
+
+		value = rgb_2_pix[ L + 0*768+256 + colortab[ CR + 0*256 ] ] |
+		        rgb_2_pix[ L + 1*768+256 + colortab[ CR + 1*256 ]
+		                                 + colortab[ CB + 2*256 ] ] |
+		        rgb_2_pix[ L + 2*768+256 + colortab[ CB + 3*256 ] ];
+		switch (swdata->display->format->BytesPerPixel) {
+		    case 2:
+			((Uint16 *)out)[i] = (Uint16)value;
+			break;
+		    case 3:
+			out[3*i+0] = (value      ) & 0xFF;
+			out[3*i+1] = (value >>  8) & 0xFF;
+			out[3*i+2] = (value >> 16) & 0xFF;
+			break;
+		    default:
+			((Uint32 *)out)[i] = value;
+			break;
+		}
+	}
+}
+
+static void ExtractRowC(Uint8 *dst, const Uint8 *src, int step, int count)
+{
+	int i;
+
+	for ( i = 0; i < count; ++i ) {
+		dst[i] = src[i*step];
+	}
+}
+
+/* The SSE2 and NEON row functions make 24-bit pixels 32-bit first and
+   then pack them down */
+static void PackRow24(const Uint32 *pix, Uint8 *out, int width)
+{
+	int i;
+
+	for ( i = 0; i < width; ++i ) {
+		out[3*i+0] = (pix[i]      ) & 0xFF;
+		out[3*i+1] = (pix[i] >>  8) & 0xFF;
+		out[3*i+2] = (pix[i] >> 16) & 0xFF;
+	}
+}
+
+#if SDL_X86_SIMD_BLITTERS
+#include <immintrin.h>
+
+SDL_TARGET_SSE2
+static void ExtractRowSSE2(Uint8 *dst, const Uint8 *src, int step, int count)
+{
+	const __m128i mask = (step == 2) ? _mm_set1_epi16(0xFF) : _mm_set1_epi32(0xFF);
+	int i;
+
+	/* Stop a sample early, the loads run on to the end of a macropixel */
+	for ( i = 0; i + 16 < count; i += 16 ) {
+		const __m128i *p = (const __m128i *)(src + i*step);
+		__m128i a = _mm_and_si128(_mm_loadu_si128(p + 0), mask);
+		__m128i b = _mm_and_si128(_mm_loadu_si128(p + 1), mask);
+
+		if ( step == 4 ) {
+			__m128i c = _mm_and_si128(_mm_loadu_si128(p + 2), mask);
+			__m128i d = _mm_and_si128(_mm_loadu_si128(p + 3), mask);
+
+			a = _mm_packs_epi32(a, b);
+			b = _mm_packs_epi32(c, d);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+	}
+	ExtractRowC(dst + i, src + i*step, step, count - i);
+}
+
+SDL_TARGET_SSE2
+static void ConvertRowSSE2(struct private_yuvhwdata *swdata,
+                           const Uint8 *lum, const Uint8 *cr, const Uint8 *cb,
+                           Uint8 *out, int width, int halfchroma)
+{
+	const int bpp = swdata->display->format->BytesPerPixel;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i cr_r = _mm_set1_epi16(YUV_CR_R);
+	const __m128i cr_g = _mm_set1_epi16(YUV_CR_G);
+	const __m128i cb_g = _mm_set1_epi16(YUV_CB_G);
+	const __m128i cb_b = _mm_set1_epi16(YUV_CB_B);
+	const __m128i rloss = _mm_cvtsi32_si128(swdata->loss[0]);
+	const __m128i gloss = _mm_cvtsi32_si128(swdata->loss[1]);
+	const __m128i bloss = _mm_cvtsi32_si128(swdata->loss[2]);
+	const __m128i rshift = _mm_cvtsi32_si128(swdata->shift[0]);
+	const __m128i gshift = _mm_cvtsi32_si128(swdata->shift[1]);
+	const __m128i bshift = _mm_cvtsi32_si128(swdata->shift[2]);
+	Uint32 pix24[16];
+	int i, half;
+
+	for ( i = 0; i + 16 <= width; i += 16 ) {
+		Uint8 *dst = (bpp == 3) ? (Uint8 *)pix24 : out + i*bpp;
+		__m128i y8 = _mm_loadu_si128((const __m128i *)(lum + i));
+		__m128i v8, u8;
+		__m128i r8, g8, b8;
+
+		if ( halfchroma ) {
+			v8 = _mm_loadl_epi64((const __m128i *)(cr + i/2));
+			u8 = _mm_loadl_epi64((const __m128i *)(cb + i/2));
+			v8 = _mm_unpacklo_epi8(v8, v8);
+			u8 = _mm_unpacklo_epi8(u8, u8);
+		} else {
+			v8 = _mm_loadu_si128((const __m128i *)(cr + i));
+			u8 = _mm_loadu_si128((const __m128i *)(cb + i));
+		}
+
+		/* Chroma offsets, at 16 bits, (c-128) * coef */
+		{
+			__m128i vl = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(v8, zero), bias), 7);
+			__m128i vh = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(v8, zero), bias), 7);
+			__m128i ul = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(u8, zero), bias), 7);
+			__m128i uh = _mm_slli_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(u8, zero), bias), 7);
+			__m128i yl = _mm_unpacklo_epi8(y8, zero);
+			__m128i yh = _mm_unpackhi_epi8(y8, zero);
+
+			r8 = _mm_packus_epi16(
+				_mm_add_epi16(yl, _mm_mulhi_epi16(vl, cr_r)),
+				_mm_add_epi16(yh, _mm_mulhi_epi16(vh, cr_r)));
+			g8 = _mm_packus_epi16(
+				_mm_add_epi16(yl, _mm_add_epi16(_mm_mulhi_epi16(vl, cr_g),
+				                                _mm_mulhi_epi16(ul, cb_g))),
+				_mm_add_epi16(yh, _mm_add_epi16(_mm_mulhi_epi16(vh, cr_g),
+				                                _mm_mulhi_epi16(uh, cb_g))));
+			b8 = _mm_packus_epi16(
+				_mm_add_epi16(yl, _mm_mulhi_epi16(ul, cb_b)),
+				_mm_add_epi16(yh, _mm_mulhi_epi16(uh, cb_b)));
+		}
+
+		/* Reduce and place each channel, eight pixels at a time */
+		for ( half = 0; half < 2; ++half ) {
+			__m128i r, g, b;
+
+			if ( half == 0 ) {
+				r = _mm_unpacklo_epi8(r8, zero);
+				g = _mm_unpacklo_epi8(g8, zero);
+				b = _mm_unpacklo_epi8(b8, zero);
+			} else {
+				r = _mm_unpackhi_epi8(r8, zero);
+				g = _mm_unpackhi_epi8(g8, zero);
+				b = _mm_unpackhi_epi8(b8, zero);
+			}
+			r = _mm_srl_epi16(r, rloss);
+			g = _mm_srl_epi16(g, gloss);
+			b = _mm_srl_epi16(b, bloss);
+			if ( bpp == 2 ) {
+				__m128i p = _mm_or_si128(_mm_sll_epi16(r, rshift),
+				            _mm_or_si128(_mm_sll_epi16(g, gshift),
+				                         _mm_sll_epi16(b, bshift)));
+				_mm_storeu_si128((__m128i *)(dst + 2*8*half), p);
+			} else {
+				__m128i lo = _mm_or_si128(
+					_mm_sll_epi32(_mm_unpacklo_epi16(r, zero), rshift),
+					_mm_or_si128(
+					_mm_sll_epi32(_mm_unpacklo_epi16(g, zero), gshift),
+					_mm_sll_epi32(_mm_unpacklo_epi16(b, zero), bshift)));
+				__m128i hi = _mm_or_si128(
+					_mm_sll_epi32(_mm_unpackhi_epi16(r, zero), rshift),
+					_mm_or_si128(
+					_mm_sll_epi32(_mm_unpackhi_epi16(g, zero), gshift),
+					_mm_sll_epi32(_mm_unpackhi_epi16(b, zero), bshift)));
+				_mm_storeu_si128((__m128i *)(dst + 4*8*half), lo);
+				_mm_storeu_si128((__m128i *)(dst + 4*8*half + 16), hi);
+			}
+		}
+		if ( bpp == 3 ) {
+			PackRow24(pix24, out + 3*i, 16);
+		}
+	}
+	if ( i < width ) {
+		ConvertRowC(swdata, lum + i, cr + (i >> halfchroma),
+		            cb + (i >> halfchroma), out + i*bpp, width - i, halfchroma);
+	}
+}
+
+SDL_TARGET_AVX2
+static void ConvertRowAVX2(struct private_yuvhwdata *swdata,
+                           const Uint8 *lum, const Uint8 *cr, const Uint8 *cb,
+                           Uint8 *out, int width, int halfchroma)
+{
+	const int bpp = swdata->display->format->BytesPerPixel;
+	const __m256i bias = _mm256_set1_epi16(128);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(255);
+	const __m256i cr_r = _mm256_set1_epi16(YUV_CR_R);
+	const __m256i cr_g = _mm256_set1_epi16(YUV_CR_G);
+	const __m256i cb_g = _mm256_set1_epi16(YUV_CB_G);
+	const __m256i cb_b = _mm256_set1_epi16(YUV_CB_B);
+	const __m128i rloss = _mm_cvtsi32_si128(swdata->loss[0]);
+	const __m128i gloss = _mm_cvtsi32_si128(swdata->loss[1]);
+	const __m128i bloss = _mm_cvtsi32_si128(swdata->loss[2]);
+	const __m128i rshift = _mm_cvtsi32_si128(swdata->shift[0]);
+	const __m128i gshift = _mm_cvtsi32_si128(swdata->shift[1]);
+	const __m128i bshift = _mm_cvtsi32_si128(swdata->shift[2]);
+	/* Each 24-bit store writes four bytes past its pixels */
+	const int last = width - 16 - ((bpp == 3) ? 2 : 0);
+	const __m256i pack24 = _mm256_setr_epi8(
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	int i;
+
+	for ( i = 0; i <= last; i += 16 ) {
+		__m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(lum + i)));
+		__m128i v8, u8;
+		__m256i v, u, r, g, b;
+
+		if ( halfchroma ) {
+			v8 = _mm_loadl_epi64((const __m128i *)(cr + i/2));
+			u8 = _mm_loadl_epi64((const __m128i *)(cb + i/2));
+			v8 = _mm_unpacklo_epi8(v8, v8);
+			u8 = _mm_unpacklo_epi8(u8, u8);
+		} else {
+			v8 = _mm_loadu_si128((const __m128i *)(cr + i));
+			u8 = _mm_loadu_si128((const __m128i *)(cb + i));
+		}
+		v = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(v8), bias), 7);
+		u = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(u8), bias), 7);
+
+		r = _mm256_add_epi16(y, _mm256_mulhi_epi16(v, cr_r));
+		g = _mm256_add_epi16(y, _mm256_add_epi16(_mm256_mulhi_epi16(v, cr_g),
+		                                         _mm256_mulhi_epi16(u, cb_g)));
+		b = _mm256_add_epi16(y, _mm256_mulhi_epi16(u, cb_b));
+		r = _mm256_min_epi16(_mm256_max_epi16(r, zero), max);
+		g = _mm256_min_epi16(_mm256_max_epi16(g, zero), max);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), max);
+		r = _mm256_srl_epi16(r, rloss);
+		g = _mm256_srl_epi16(g, gloss);
+		b = _mm256_srl_epi16(b, bloss);
+
+		if ( bpp == 2 ) {
+			__m256i p = _mm256_or_si256(_mm256_sll_epi16(r, rshift),
+			            _mm256_or_si256(_mm256_sll_epi16(g, gshift),
+			                            _mm256_sll_epi16(b, bshift)));
+			_mm256_storeu_si256((__m256i *)(out + 2*i), p);
+		} else {
+			__m256i lo = _mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(r)), rshift),
+				_mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(g)), gshift),
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(b)), bshift)));
+			__m256i hi = _mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1)), rshift),
+				_mm256_or_si256(
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(g, 1)), gshift),
+				_mm256_sll_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(b, 1)), bshift)));
+			if ( bpp == 3 ) {
+				Uint8 *dst = out + 3*i;
+
+				lo = _mm256_shuffle_epi8(lo, pack24);
+				hi = _mm256_shuffle_epi8(hi, pack24);
+				_mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(lo));
+				_mm_storeu_si128((__m128i *)(dst + 12), _mm256_extracti128_si256(lo, 1));
+				_mm_storeu_si128((__m128i *)(dst + 24), _mm256_castsi256_si128(hi));
+				_mm_storeu_si128((__m128i *)(dst + 36), _mm256_extracti128_si256(hi, 1));
+			} else {
+				_mm256_storeu_si256((__m256i *)(out + 4*i), lo);
+				_mm256_storeu_si256((__m256i *)(out + 4*i + 32), hi);
+			}
+		}
+	}
+	if ( i < width ) {
+		ConvertRowC(swdata, lum + i, cr + (i >> halfchroma),
+		            cb + (i >> halfchroma), out + i*bpp, width - i, halfchroma);
+	}
+}
+#endif /* SDL_X86_SIMD_BLITTERS */
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SDL_NEON_YUV	1
+#include <arm_neon.h>
+
+static void ConvertRowNEON(struct private_yuvhwdata *swdata,
+                           const Uint8 *lum, const Uint8 *cr, const Uint8 *cb,
+                           Uint8 *out, int width, int halfchroma)
+{
+	const int bpp = swdata->display->format->BytesPerPixel;
+	const int16x8_t bias = vdupq_n_s16(128);
+	const int16x8_t rloss = vdupq_n_s16(-(int)swdata->loss[0]);
+	const int16x8_t gloss = vdupq_n_s16(-(int)swdata->loss[1]);
+	const int16x8_t bloss = vdupq_n_s16(-(int)swdata->loss[2]);
+	const int16x8_t rshift16 = vdupq_n_s16(swdata->shift[0]);
+	const int16x8_t gshift16 = vdupq_n_s16(swdata->shift[1]);
+	const int16x8_t bshift16 = vdupq_n_s16(swdata->shift[2]);
+	const int32x4_t rshift32 = vdupq_n_s32(swdata->shift[0]);
+	const int32x4_t gshift32 = vdupq_n_s32(swdata->shift[1]);
+	const int32x4_t bshift32 = vdupq_n_s32(swdata->shift[2]);
+	Uint32 pix24[8];
+	int i;
+
+	for ( i = 0; i + 8 <= width; i += 8 ) {
+		Uint8 *dst = (bpp == 3) ? (Uint8 *)pix24 : out + i*bpp;
+		int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(lum + i)));
+		uint8x8_t v8, u8;
+		int16x8_t v, u;
+		uint16x8_t r, g, b;
+
+		if ( halfchroma ) {
+			Uint32 v4, u4;
+
+			/* Only four samples left in the row, don't read past them */
+			SDL_memcpy(&v4, cr + i/2, 4);
+			SDL_memcpy(&u4, cb + i/2, 4);
+			v8 = vreinterpret_u8_u32(vdup_n_u32(v4));
+			u8 = vreinterpret_u8_u32(vdup_n_u32(u4));
+			v8 = vzip_u8(v8, v8).val[0];
+			u8 = vzip_u8(u8, u8).val[0];
+		} else {
+			v8 = vld1_u8(cr + i);
+			u8 = vld1_u8(cb + i);
+		}
+		v = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), bias), 6);
+		u = vshlq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), bias), 6);
+
+		/* vqdmulh doubles the product, hence the shift by 6 above */
+		r = vmovl_u8(vqmovun_s16(vaddq_s16(y, vqdmulhq_n_s16(v, YUV_CR_R))));
+		g = vmovl_u8(vqmovun_s16(vaddq_s16(y, vaddq_s16(
+			vqdmulhq_n_s16(v, YUV_CR_G), vqdmulhq_n_s16(u, YUV_CB_G)))));
+		b = vmovl_u8(vqmovun_s16(vaddq_s16(y, vqdmulhq_n_s16(u, YUV_CB_B))));
+		r = vshlq_u16(r, rloss);
+		g = vshlq_u16(g, gloss);
+		b = vshlq_u16(b, bloss);
+
+		if ( bpp == 2 ) {
+			vst1q_u16((Uint16 *)dst,
+			          vorrq_u16(vshlq_u16(r, rshift16),
+			          vorrq_u16(vshlq_u16(g, gshift16),
+			                    vshlq_u16(b, bshift16))));
+		} else {
+			vst1q_u32((Uint32 *)dst,
+			          vorrq_u32(vshlq_u32(vmovl_u16(vget_low_u16(r)), rshift32),
+			          vorrq_u32(vshlq_u32(vmovl_u16(vget_low_u16(g)), gshift32),
+			                    vshlq_u32(vmovl_u16(vget_low_u16(b)), bshift32))));
+			vst1q_u32((Uint32 *)(dst + 16),
+			          vorrq_u32(vshlq_u32(vmovl_u16(vget_high_u16(r)), rshift32),
+			          vorrq_u32(vshlq_u32(vmovl_u16(vget_high_u16(g)), gshift32),
+			                    vshlq_u32(vmovl_u16(vget_high_u16(b)), bshift32))));
+		}
+		if ( bpp == 3 ) {
+			PackRow24(pix24, out + 3*i, 8);
+		}
+	}
+	if ( i < width ) {
+		ConvertRowC(swdata, lum + i, cr + (i >> halfchroma),
+		            cb + (i >> halfchroma), out + i*bpp, width - i, halfchroma);
+	}
+}
+#endif /* NEON */
+
+/* Make sure the column map and line buffers fit this source and width */
+static int SetupScaledRows(struct private_yuvhwdata *swdata, SDL_Overlay *overlay,
+                           SDL_Rect *src, SDL_Rect *dst)
+{
+	int packed = (overlay->planes == 1);
+	Uint32 pos, inc;
+	int i, sx;
+
+	if ( dst->w > swdata->line_len ) {
+		int len = (dst->w + 16 + 3) & ~3;
+		Uint8 *lines = (Uint8 *)SDL_realloc(swdata->lines, len * 3);
+		int *xmap = (int *)SDL_realloc(swdata->xmap, len * 2 * sizeof(int));
+
+		if ( lines ) {
+			swdata->lines = lines;
+		}
+		if ( xmap ) {
+			swdata->xmap = xmap;
+		}
+		if ( !lines || !xmap ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		swdata->line_len = len;
+		swdata->map_w = 0;
+	}
+	if ( swdata->map_x == src->x && swdata->map_srcw == src->w &&
+	     swdata->map_w == dst->w ) {
+		return(0);
+	}
+
+	/* Sample at the middle of each destination pixel */
+	inc = ((Uint32)src->w << 16) / dst->w;
+	pos = inc / 2;
+	for ( i = 0; i < dst->w; ++i, pos += inc ) {
+		sx = src->x + (pos >> 16);
+		if ( sx >= src->x + src->w ) {
+			sx = src->x + src->w - 1;
+		}
+		if ( packed ) {
+			swdata->xmap[2*i] = sx * 2;
+			swdata->xmap[2*i+1] = (sx / 2) * 4;
+		} else {
+			swdata->xmap[2*i] = sx;
+			swdata->xmap[2*i+1] = sx / 2;
+		}
+	}
+	swdata->map_x = src->x;
+	swdata->map_srcw = src->w;
+	swdata->map_w = dst->w;
+	return(0);
+}
+
+static void DisplayScaledRows(struct private_yuvhwdata *swdata, SDL_Overlay *overlay,
+                              Uint8 *lum, Uint8 *Cr, Uint8 *Cb,
+                              SDL_Rect *src, SDL_Rect *dst,
+                              Uint8 *dstp, int pitch, Uint8 *lines,
+                              int row0, int row1)
+{
+	const int bpp = swdata->display->format->BytesPerPixel;
+	const int packed = (overlay->planes == 1);
+	const int iyuv = (overlay->format == SDL_IYUV_OVERLAY);
+	const int crpitch = overlay->pitches[iyuv ? 2 : 1];
+	const int cbpitch = overlay->pitches[iyuv ? 1 : 2];
+	const int *xmap = swdata->xmap;
+	const int width = dst->w;
+	Uint8 *ybuf = lines;
+	Uint8 *vbuf = ybuf + swdata->line_len;
+	Uint8 *ubuf = vbuf + swdata->line_len;
+	Uint32 inc = ((Uint32)src->h << 16) / dst->h;
+	Uint32 pos = (Uint32)row0 * inc + inc / 2;
+	int last_sy = -1;
+	int dy, sy, i;
+
+	for ( dy = row0; dy < row1; ++dy, pos += inc ) {
+		Uint8 *out = dstp + dy * pitch;
+		const Uint8 *lrow, *crrow, *cbrow, *y, *v, *u;
+
+		sy = src->y + (pos >> 16);
+		if ( sy >= src->y + src->h ) {
+			sy = src->y + src->h - 1;
+		}
+		if ( sy == last_sy ) {
+			/* Scaling up, this row is the same as the last one */
+			SDL_memcpy(out, out - pitch, width * bpp);
+			continue;
+		}
+		last_sy = sy;
+
+		lrow = lum + sy * overlay->pitches[0];
+		if ( packed ) {
+			crrow = Cr + sy * overlay->pitches[0];
+			cbrow = Cb + sy * overlay->pitches[0];
+		} else {
+			crrow = Cr + (sy / 2) * crpitch;
+			cbrow = Cb + (sy / 2) * cbpitch;
+		}
+		if ( src->w != dst->w ) {
+			for ( i = 0; i < width; ++i ) {
+				ybuf[i] = lrow[xmap[2*i]];
+				vbuf[i] = crrow[xmap[2*i+1]];
+				ubuf[i] = cbrow[xmap[2*i+1]];
+			}
+			swdata->ConvertRow(swdata, ybuf, vbuf, ubuf, out, width, 0);
+			continue;
+		}
+
+		/* Unscaled, convert straight from the 4:2:x chroma */
+		if ( packed ) {
+			const Uint8 *p = lrow + src->x * 2;
+			const int n = ((src->x & 1) + width + 1) / 2;
+
+			crrow += (src->x / 2) * 4;
+			cbrow += (src->x / 2) * 4;
+			swdata->ExtractRow(ybuf, p, 2, width);
+			swdata->ExtractRow(vbuf, crrow, 4, n);
+			swdata->ExtractRow(ubuf, cbrow, 4, n);
+			y = ybuf;
+			v = vbuf;
+			u = ubuf;
+		} else {
+			y = lrow + src->x;
+			v = crrow + src->x / 2;
+			u = cbrow + src->x / 2;
+		}
+		if ( src->x & 1 ) {
+			/* Starting on the second pixel of a chroma pair */
+			swdata->ConvertRow(swdata, y, v, u, out, 1, 0);
+			++y, ++v, ++u;
+			swdata->ConvertRow(swdata, y, v, u, out + bpp, width - 1, 1);
+		} else {
+			swdata->ConvertRow(swdata, y, v, u, out, width, 1);
+		}
+	}
+}
+
+/*
+ * Large displays are cut into bands of rows on the SDL_BLIT_THREADS
+ * worker pool.  Every band starts on a freshly converted row, so they
+ * share nothing but the column map; the first band uses the overlay's
+ * line buffers and the others bring their own.
+ */
+typedef struct {
+	struct private_yuvhwdata *swdata;
+	SDL_Overlay *overlay;
+	Uint8 *lum, *Cr, *Cb;
+	SDL_Rect *src, *dst;
+	Uint8 *dstp;
+	int pitch;
+	int status;
+} SDL_YUVBandJob;
+
+static void DisplayScaledBand(void *data, int first, int count)
+{
+	SDL_YUVBandJob *job = (SDL_YUVBandJob *)data;
+	struct private_yuvhwdata *swdata = job->swdata;
+	Uint8 *lines = swdata->lines;
+
+	if ( first > 0 ) {
+		lines = (Uint8 *)SDL_malloc(swdata->line_len * 3);
+		if ( !lines ) {
+			job->status = -1;
+			return;
+		}
+	}
+	DisplayScaledRows(swdata, job->overlay, job->lum, job->Cr, job->Cb,
+	                  job->src, job->dst, job->dstp, job->pitch, lines,
+	                  first, first + count);
+	if ( lines != swdata->lines ) {
+		SDL_free(lines);
+	}
+}
+
+/* Lay the overlay's planes out in its own pixel memory */
+static void SetupPlanes(SDL_Overlay *overlay)
+{
+	struct private_yuvhwdata *swdata = overlay->hwdata;
+
+	switch (overlay->format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+		overlay->pitches[0] = overlay->w;
+		overlay->pitches[1] = overlay->pitches[0] / 2;
+		overlay->pitches[2] = overlay->pitches[0] / 2;
+	        overlay->pixels[0] = swdata->pixels;
+	        overlay->pixels[1] = overlay->pixels[0] +
+		                     overlay->pitches[0] * overlay->h;
+	        overlay->pixels[2] = overlay->pixels[1] +
+		                     overlay->pitches[1] * overlay->h / 2;
+		overlay->planes = 3;
+		break;
+	    case SDL_YUY2_OVERLAY:
+	    case SDL_UYVY_OVERLAY:
+	    case SDL_YVYU_OVERLAY:
+		overlay->pitches[0] = overlay->w*2;
+	        overlay->pixels[0] = swdata->pixels;
+		overlay->planes = 1;
+		break;
+	    default:
+		/* We should never get here (caught above) */
+		break;
+	}
+	swdata->padded = 0;
+}
+
 /*
  * How many 1 bits are there in the Uint32.
  * Low performance, do not call often.
@@ -983,7 +1581,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
 	}
-	swdata->stretch = NULL;
+	SDL_memset(swdata, 0, (sizeof *swdata));
 	swdata->display = display;
 	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
@@ -1056,6 +1654,35 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		b_2_pix_alloc[i+512] = b_2_pix_alloc[511];
 	}
 
+	/* The SIMD row converters need each channel in at most 8 bits */
+	swdata->ConvertRow = ConvertRowC;
+	swdata->ExtractRow = ExtractRowC;
+	swdata->loss[0] = 8 - number_of_bits_set(Rmask);
+	swdata->loss[1] = 8 - number_of_bits_set(Gmask);
+	swdata->loss[2] = 8 - number_of_bits_set(Bmask);
+	swdata->shift[0] = free_bits_at_bottom(Rmask);
+	swdata->shift[1] = free_bits_at_bottom(Gmask);
+	swdata->shift[2] = free_bits_at_bottom(Bmask);
+	if ( number_of_bits_set(Rmask) <= 8 &&
+	     number_of_bits_set(Gmask) <= 8 &&
+	     number_of_bits_set(Bmask) <= 8 ) {
+#if SDL_X86_SIMD_BLITTERS
+		if ( SDL_HasAVX2() ) {
+			swdata->ConvertRow = ConvertRowAVX2;
+			swdata->ExtractRow = ExtractRowSSE2;
+			swdata->simd = 1;
+		} else if ( SDL_HasSSE2() ) {
+			swdata->ConvertRow = ConvertRowSSE2;
+			swdata->ExtractRow = ExtractRowSSE2;
+			swdata->simd = 1;
+		}
+#endif
+#if SDL_NEON_YUV
+		swdata->ConvertRow = ConvertRowNEON;
+		swdata->simd = 1;
+#endif
+	}
+
 	/* You have chosen wisely... */
 	switch (format) {
 	    case SDL_YV12_OVERLAY:
@@ -1125,35 +1752,57 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	/* Find the pitch and offset values for the overlay */
 	overlay->pitches = swdata->pitches;
 	overlay->pixels = swdata->planes;
-	switch (format) {
-	    case SDL_YV12_OVERLAY:
-	    case SDL_IYUV_OVERLAY:
-		overlay->pitches[0] = overlay->w;
-		overlay->pitches[1] = overlay->pitches[0] / 2;
-		overlay->pitches[2] = overlay->pitches[0] / 2;
-	        overlay->pixels[0] = swdata->pixels;
-	        overlay->pixels[1] = overlay->pixels[0] +
-		                     overlay->pitches[0] * overlay->h;
-	        overlay->pixels[2] = overlay->pixels[1] +
-		                     overlay->pitches[1] * overlay->h / 2;
-		overlay->planes = 3;
-		break;
-	    case SDL_YUY2_OVERLAY:
-	    case SDL_UYVY_OVERLAY:
-	    case SDL_YVYU_OVERLAY:
-		overlay->pitches[0] = overlay->w*2;
-	        overlay->pixels[0] = swdata->pixels;
-		overlay->planes = 1;
-		break;
-	    default:
-		/* We should never get here (caught above) */
-		break;
-	}
+	SetupPlanes(overlay);
 
 	/* We're all done.. */
 	return(overlay);
 }
 
+int SDL_SetYUVPlanes_SW(_THIS, SDL_Overlay *overlay,
+                        Uint8 **pixels, const Uint16 *pitches)
+{
+	struct private_yuvhwdata *swdata;
+	int i, minpitch;
+
+	if ( overlay->hwfuncs != &sw_yuvfuncs ) {
+		SDL_SetError("Overlay planes can't be replaced on hardware overlays");
+		return(-1);
+	}
+	swdata = overlay->hwdata;
+	if ( pixels == NULL ) {
+		SetupPlanes(overlay);
+		return(0);
+	}
+
+	/* Check everything before touching the overlay */
+	for ( i = 0; i < overlay->planes; ++i ) {
+		if ( overlay->planes == 1 ) {
+			minpitch = overlay->w * 2;
+		} else if ( i == 0 ) {
+			minpitch = overlay->w;
+		} else {
+			minpitch = overlay->w / 2;
+		}
+		if ( pixels[i] == NULL || pitches == NULL ||
+		     pitches[i] < minpitch ) {
+			SDL_SetError("Invalid overlay plane %d", i);
+			return(-1);
+		}
+	}
+	for ( i = 0; i < overlay->planes; ++i ) {
+		overlay->pixels[i] = pixels[i];
+		overlay->pitches[i] = pitches[i];
+	}
+	if ( overlay->planes == 1 ) {
+		swdata->padded = (pitches[0] != overlay->w * 2);
+	} else {
+		swdata->padded = (pitches[0] != overlay->w ||
+		                  pitches[1] != overlay->w / 2 ||
+		                  pitches[2] != overlay->w / 2);
+	}
+	return(0);
+}
+
 int SDL_LockYUV_SW(_THIS, SDL_Overlay *overlay)
 {
 	return(0);
@@ -1178,10 +1827,8 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 	stretch = 0;
 	scale_2x = 0;
 	if ( src->x || src->y || src->w < overlay->w || src->h < overlay->h ) {
-		/* The source rectangle has been clipped.
-		   Using a scratch surface is easier than adding clipped
-		   source support to all the blitters, plus that would
-		   slow them down in the general unclipped case.
+		/* The source rectangle has been clipped, which only the
+		   scaled row converters handle
 		*/
 		stretch = 1;
 	} else if ( (src->w != dst->w) || (src->h != dst->h) ) {
@@ -1192,24 +1839,14 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			stretch = 1;
 		}
 	}
-	if ( stretch ) {
-		if ( ! swdata->stretch ) {
-			display = swdata->display;
-			swdata->stretch = SDL_CreateRGBSurface(
-				SDL_SWSURFACE,
-				overlay->w, overlay->h,
-				display->format->BitsPerPixel,
-				display->format->Rmask,
-				display->format->Gmask,
-				display->format->Bmask, 0);
-			if ( ! swdata->stretch ) {
-				return(-1);
-			}
-		}
-		display = swdata->stretch;
-	} else {
-		display = swdata->display;
+	if ( swdata->simd || swdata->padded ) {
+		/* The table converters also assume tightly packed planes */
+		stretch = 1;
+	}
+	if ( stretch && SetupScaledRows(swdata, overlay, src, dst) < 0 ) {
+		return(-1);
 	}
+	display = swdata->display;
 	switch (overlay->format) {
 	    case SDL_YV12_OVERLAY:
 		lum = overlay->pixels[0];
@@ -1245,16 +1882,33 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			return(-1);
 		}
 	}
-	if ( stretch ) {
-		dstp = (Uint8 *)swdata->stretch->pixels;
-	} else {
-		dstp = (Uint8 *)display->pixels
-			+ dst->x * display->format->BytesPerPixel
-			+ dst->y * display->pitch;
-	}
+	dstp = (Uint8 *)display->pixels
+		+ dst->x * display->format->BytesPerPixel
+		+ dst->y * display->pitch;
 	mod = (display->pitch / display->format->BytesPerPixel);
 
-	if ( scale_2x ) {
+	if ( stretch ) {
+		SDL_YUVBandJob job;
+
+		job.swdata = swdata;
+		job.overlay = overlay;
+		job.lum = lum;
+		job.Cr = Cr;
+		job.Cb = Cb;
+		job.src = src;
+		job.dst = dst;
+		job.dstp = dstp;
+		job.pitch = display->pitch;
+		job.status = 0;
+		SDL_RunBlitBands(DisplayScaledBand, &job, dst->h, dst->w);
+		if ( job.status < 0 ) {
+			if ( SDL_MUSTLOCK(display) ) {
+				SDL_UnlockSurface(display);
+			}
+			SDL_OutOfMemory();
+			return(-1);
+		}
+	} else if ( scale_2x ) {
 		mod -= (overlay->w * 2);
 		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
 		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
@@ -1266,10 +1920,6 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 	if ( SDL_MUSTLOCK(display) ) {
 		SDL_UnlockSurface(display);
 	}
-	if ( stretch ) {
-		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
-	}
 	SDL_UpdateRects(display, 1, dst);
 
 	return(0);
@@ -1281,8 +1931,11 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 
 	swdata = overlay->hwdata;
 	if ( swdata ) {
-		if ( swdata->stretch ) {
-			SDL_FreeSurface(swdata->stretch);
+		if ( swdata->lines ) {
+			SDL_free(swdata->lines);
+		}
+		if ( swdata->xmap ) {
+			SDL_free(swdata->xmap);
 		}
 		if ( swdata->pixels ) {
 			SDL_free(swdata->pixels);
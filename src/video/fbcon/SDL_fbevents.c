@@ -1076,6 +1076,24 @@ void FB_PumpEvents(_THIS)
 	} while ( posted );
 }
 
+int FB_GetEventFDs(_THIS, int *fds, int maxfds, Sint32 *timeout)
+{
+	int numfds;
+
+	/* Switching back to our VT is noticed by polling VT_GETSTATE */
+	if ( switched_away && ((*timeout < 0) || (*timeout > 10)) ) {
+		*timeout = 10;
+	}
+	numfds = 0;
+	if ( (keyboard_fd >= 0) && (numfds < maxfds) ) {
+		fds[numfds++] = keyboard_fd;
+	}
+	if ( (mouse_fd >= 0) && (numfds < maxfds) ) {
+		fds[numfds++] = mouse_fd;
+	}
+	return(numfds);
+}
+
 void FB_InitOSKeymap(_THIS)
 {
 	int i;
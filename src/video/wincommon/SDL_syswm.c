@@ -129,6 +129,7 @@ void WIN_SetWMIcon(_THIS, SDL_Surface *icon, Uint8 *mask)
 		pal_256->colors[0].r = 0x00;
 		pal_256->colors[0].g = 0x00;
 		pal_256->colors[0].b = 0x00;
+		SDL_InvalidateInverseMap(pal_256);
 	} else {
 		SDL_DitherColors(pal_256->colors,
 					icon_256->format->BitsPerPixel);
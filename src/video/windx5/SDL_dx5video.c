@@ -2515,6 +2515,7 @@ void DX5_PaletteChanged(_THIS, HWND window)
 		palette->colors[i].g = entries[i].peGreen;
 		palette->colors[i].b = entries[i].peBlue;
 	}
+	SDL_InvalidateInverseMap(palette);
 	SDL_stack_free(entries);
 	if ( ! colorchange_expected ) {
 		Uint8 mapping[256];
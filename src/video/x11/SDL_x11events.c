@@ -1019,6 +1019,34 @@ void X11_PumpEvents(_THIS)
 	}
 }
 
+int X11_GetEventFDs(_THIS, int *fds, int maxfds, Sint32 *timeout)
+{
+	Sint32 wait = -1;
+
+	/* X11_PumpEvents() has timed work besides reading the connection */
+	if ( switch_waiting ) {
+		wait = (Sint32)(switch_time - SDL_GetTicks());
+		if ( wait < 0 ) {
+			wait = 0;
+		}
+	} else if ( !allow_screensaver ) {
+		wait = 5000;
+	}
+	/* Events Xlib already read off the connection won't make it
+	   readable again, so don't sleep on them */
+	if ( XEventsQueued(SDL_Display, QueuedAlready) ) {
+		wait = 0;
+	}
+	if ( (wait >= 0) && ((*timeout < 0) || (*timeout > wait)) ) {
+		*timeout = wait;
+	}
+	if ( maxfds < 1 ) {
+		return(-1);
+	}
+	fds[0] = ConnectionNumber(SDL_Display);
+	return(1);
+}
+
 void X11_InitKeymap(void)
 {
 	int i;
@@ -42,44 +42,97 @@ static int shm_errhandler(Display *d, XErrorEvent *e)
 		return(X_handler(d,e));
 }
 
-static void try_mitshm(_THIS, SDL_Surface *screen)
+static int attach_mitshm(_THIS, XShmSegmentInfo *info, int size)
 {
-	/* Dynamic X11 may not have SHM entry points on this box. */
-	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
-		use_mitshm = 0;
-
-	if(!use_mitshm)
-		return;
-	shminfo.shmid = shmget(IPC_PRIVATE, screen->h*screen->pitch,
-			       IPC_CREAT | 0777);
-	if ( shminfo.shmid >= 0 ) {
-		shminfo.shmaddr = (char *)shmat(shminfo.shmid, 0, 0);
-		shminfo.readOnly = False;
-		if ( shminfo.shmaddr != (char *)-1 ) {
+	info->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0777);
+	if ( info->shmid >= 0 ) {
+		info->shmaddr = (char *)shmat(info->shmid, 0, 0);
+		info->readOnly = False;
+		if ( info->shmaddr != (char *)-1 ) {
 			shm_error = False;
 			X_handler = XSetErrorHandler(shm_errhandler);
-			XShmAttach(SDL_Display, &shminfo);
+			XShmAttach(SDL_Display, info);
 			XSync(SDL_Display, False);
 			XSetErrorHandler(X_handler);
 			if ( shm_error )
-				shmdt(shminfo.shmaddr);
+				shmdt(info->shmaddr);
 		} else {
 			shm_error = True;
 		}
-		shmctl(shminfo.shmid, IPC_RMID, NULL);
+		shmctl(info->shmid, IPC_RMID, NULL);
 	} else {
 		shm_error = True;
 	}
-	if ( shm_error )
+	return(shm_error ? -1 : 0);
+}
+
+static void try_mitshm(_THIS, SDL_Surface *screen)
+{
+	/* Dynamic X11 may not have SHM entry points on this box. */
+	if ((use_mitshm) && (!SDL_X11_HAVE_SHM))
+		use_mitshm = 0;
+
+	if(!use_mitshm)
+		return;
+	if ( attach_mitshm(this, &shminfo, screen->h*screen->pitch) < 0 )
 		use_mitshm = 0;
 	if ( use_mitshm )
 		screen->pixels = shminfo.shmaddr;
 }
+
+/* Set up a second shared image for the X server to read updates from,
+   so drawing can go on while the previous update is still being put.
+ */
+static void try_mitshm_doublebuf(_THIS, SDL_Surface *screen)
+{
+	const char *hint = SDL_getenv("SDL_VIDEO_X11_SHM_DOUBLEBUF");
+
+	shm_doublebuf = 0;
+	if ( !hint || !SDL_atoi(hint) ) {
+		return;
+	}
+	if ( attach_mitshm(this, &shminfo_alt, screen->h*screen->pitch) < 0 ) {
+		return;
+	}
+	SDL_Ximage_alt = XShmCreateImage(SDL_Display, SDL_Visual,
+					 this->hidden->depth, ZPixmap,
+					 shminfo_alt.shmaddr, &shminfo_alt,
+					 screen->w, screen->h);
+	if ( !SDL_Ximage_alt ) {
+		XShmDetach(SDL_Display, &shminfo_alt);
+		XSync(SDL_Display, False);
+		shmdt(shminfo_alt.shmaddr);
+		return;
+	}
+	shm_completion = XShmGetEventBase(GFX_Display) + ShmCompletion;
+	shm_busy = 0;
+	shm_doublebuf = 1;
+}
+
+static Bool is_shm_completion(Display *display, XEvent *event, XPointer arg)
+{
+	return (event->type == *(int *)arg);
+}
+
+/* Wait until the X server is done with the image updates are put from */
+static void wait_mitshm(_THIS)
+{
+	XEvent event;
+
+	while ( shm_busy ) {
+		XIfEvent(GFX_Display, &event, is_shm_completion,
+		         (XPointer)&shm_completion);
+		if ( ((XShmCompletionEvent *)&event)->shmseg == shminfo_alt.shmseg ) {
+			shm_busy = 0;
+		}
+	}
+}
 #endif /* ! NO_SHARED_MEMORY */
 
 /* Various screen update functions available */
 static void X11_NormalUpdate(_THIS, int numrects, SDL_Rect *rects);
 static void X11_MITSHMUpdate(_THIS, int numrects, SDL_Rect *rects);
+static void X11_MITSHMDoubleUpdate(_THIS, int numrects, SDL_Rect *rects);
 
 int X11_SetupImage(_THIS, SDL_Surface *screen)
 {
@@ -98,6 +151,10 @@ int X11_SetupImage(_THIS, SDL_Surface *screen)
 			goto error;
 		}
 		this->UpdateRects = X11_MITSHMUpdate;
+		try_mitshm_doublebuf(this, screen);
+		if ( shm_doublebuf ) {
+			this->UpdateRects = X11_MITSHMDoubleUpdate;
+		}
 	}
 	if(!use_mitshm)
 #endif /* not NO_SHARED_MEMORY */
@@ -133,9 +190,27 @@ void X11_DestroyImage(_THIS, SDL_Surface *screen)
 		XDestroyImage(SDL_Ximage);
 #ifndef NO_SHARED_MEMORY
 		if ( use_mitshm ) {
+			if ( shm_doublebuf ) {
+				XEvent event;
+
+				/* Let outstanding puts finish, and drop
+				   their completion events */
+				XSync(GFX_Display, False);
+				while ( XCheckIfEvent(GFX_Display, &event,
+				                      is_shm_completion,
+				                      (XPointer)&shm_completion) )
+					;
+				XDestroyImage(SDL_Ximage_alt);
+				XShmDetach(SDL_Display, &shminfo_alt);
+			}
 			XShmDetach(SDL_Display, &shminfo);
 			XSync(SDL_Display, False);
 			shmdt(shminfo.shmaddr);
+			if ( shm_doublebuf ) {
+				shmdt(shminfo_alt.shmaddr);
+				SDL_Ximage_alt = NULL;
+				shm_doublebuf = 0;
+			}
 		}
 #endif /* ! NO_SHARED_MEMORY */
 		SDL_Ximage = NULL;
@@ -273,6 +348,63 @@ static void X11_MITSHMUpdate(_THIS, int numrects, SDL_Rect *rects)
 #endif /* ! NO_SHARED_MEMORY */
 }
 
+/* Copy the updated rectangles into the image the X server reads from
+   and put them from there without waiting for the server.  The screen
+   keeps drawing into the same image, so what isn't updated is kept.
+ */
+static void X11_MITSHMDoubleUpdate(_THIS, int numrects, SDL_Rect *rects)
+{
+#ifndef NO_SHARED_MEMORY
+	int bpp = SDL_VideoSurface->format->BytesPerPixel;
+	int pitch = SDL_Ximage->bytes_per_line;
+	int i, last;
+
+	last = -1;
+	for ( i=0; i<numrects; ++i ) {
+		if ( rects[i].w && rects[i].h ) {
+			last = i;
+		}
+	}
+	if ( last < 0 ) {
+		return;
+	}
+
+	/* The previous update was put a frame ago, so this rarely waits */
+	wait_mitshm(this);
+
+	for ( i=0; i<=last; ++i ) {
+		Uint8 *src, *dst;
+		int row, len;
+
+		if ( rects[i].w == 0 || rects[i].h == 0 ) { /* Clipped? */
+			continue;
+		}
+		src = (Uint8 *)SDL_Ximage->data + rects[i].y*pitch + rects[i].x*bpp;
+		dst = (Uint8 *)SDL_Ximage_alt->data + rects[i].y*pitch + rects[i].x*bpp;
+		len = rects[i].w*bpp;
+		for ( row = rects[i].h; row; --row ) {
+			SDL_memcpy(dst, src, len);
+			src += pitch;
+			dst += pitch;
+		}
+	}
+
+	/* Only the last put asks for a completion event; the server
+	   handles them in order, so that covers the whole update */
+	for ( i=0; i<=last; ++i ) {
+		if ( rects[i].w == 0 || rects[i].h == 0 ) { /* Clipped? */
+			continue;
+		}
+		XShmPutImage(GFX_Display, SDL_Window, SDL_GC, SDL_Ximage_alt,
+				rects[i].x, rects[i].y,
+				rects[i].x, rects[i].y, rects[i].w, rects[i].h,
+				(i == last));
+	}
+	XFlush(GFX_Display);
+	shm_busy = 1;
+#endif /* ! NO_SHARED_MEMORY */
+}
+
 /* There's a problem with the automatic refreshing of the display.
    Even though the XVideo code uses the GFX_Display to update the
    video memory, it appears that updating the window asynchronously
@@ -301,7 +433,8 @@ void X11_RefreshDisplay(_THIS)
 		return;
 	}
 #ifndef NO_SHARED_MEMORY
-	if ( this->UpdateRects == X11_MITSHMUpdate ) {
+	if ( this->UpdateRects == X11_MITSHMUpdate ||
+	     this->UpdateRects == X11_MITSHMDoubleUpdate ) {
 		XShmPutImage(SDL_Display, SDL_Window, SDL_GC, SDL_Ximage,
 				0, 0, 0, 0, this->screen->w, this->screen->h,
 				False);
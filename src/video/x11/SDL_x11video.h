@@ -75,6 +75,14 @@ struct SDL_PrivateVideoData {
     /* MIT shared memory extension information */
     int use_mitshm;
     XShmSegmentInfo shminfo;
+
+    /* Double-buffered presentation: the application draws into Ximage,
+       and updates are copied into Ximage_alt and put from there */
+    int shm_doublebuf;
+    int shm_completion;		/* event type of ShmCompletion events */
+    int shm_busy;		/* Ximage_alt has a put in flight */
+    XShmSegmentInfo shminfo_alt;
+    XImage *Ximage_alt;
 #endif
 
     /* The variables used for displaying graphics */
@@ -174,6 +182,11 @@ struct SDL_PrivateVideoData {
 #define using_dga		(this->hidden->using_dga)
 #define use_mitshm		(this->hidden->use_mitshm)
 #define shminfo			(this->hidden->shminfo)
+#define shm_doublebuf		(this->hidden->shm_doublebuf)
+#define shm_completion		(this->hidden->shm_completion)
+#define shm_busy		(this->hidden->shm_busy)
+#define shminfo_alt		(this->hidden->shminfo_alt)
+#define SDL_Ximage_alt		(this->hidden->Ximage_alt)
 #define SDL_Ximage		(this->hidden->Ximage)
 #define SDL_GC			(this->hidden->gc)
 #define window_w		(this->hidden->window_w)